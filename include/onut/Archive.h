@@ -0,0 +1,100 @@
+#ifndef ARCHIVE_H_INCLUDED
+#define ARCHIVE_H_INCLUDED
+
+// STL
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+// Forward
+#include <onut/ForwardDeclaration.h>
+OForwardDeclare(Archive)
+
+namespace onut
+{
+    /**
+    Read only pack of asset files (.onutpak), memory mapped. Files are found by
+    name only, like ContentManager does in its search paths. Each file is
+    stored as is or deflated, whichever is smaller, and stored files are
+    aligned so they can be used in place.
+    An archive can be a ContentManager search path. Its files then have paths
+    like "assets.onutpak/hero.png", that getFileData() and readFile() know how
+    to read.
+    */
+    class Archive final
+    {
+    public:
+        enum class Compression : uint8_t
+        {
+            Store,
+            Deflate
+        };
+
+        static constexpr uint32_t ALIGNMENT = 16;
+
+        /**
+        Archives are shared, opening an archive already opened returns it.
+        @return nullptr if the file is not an archive
+        */
+        static OArchiveRef open(const std::string& filename);
+
+        /**
+        Pack files in an archive. Files are named by their file name, the
+        first file found with a name wins.
+        @param compression Deflate only keeps the files that it makes smaller
+        */
+        static bool build(const std::string& filename, const std::vector<std::string>& files, Compression compression = Compression::Deflate);
+
+        /**
+        Split a path like "path/to/assets.onutpak/hero.png".
+        @return The open archive, nullptr if the path is not in one
+        */
+        static OArchiveRef findArchive(const std::string& path, std::string& outName);
+
+        static bool isArchive(const std::string& filename);
+
+        Archive();
+        ~Archive();
+
+        const std::string& getFilename() const { return m_filename; }
+        std::vector<std::string> getNames() const;
+        bool contains(const std::string& name) const;
+
+        /**
+        Uncompressed size, 0 if the file is not in the archive.
+        */
+        size_t getSize(const std::string& name) const;
+
+        /**
+        Straight in the mapped archive, no copy.
+        @return nullptr if the file is compressed or not in the archive
+        */
+        const uint8_t* getMappedData(const std::string& name, size_t& outSize) const;
+
+        /**
+        Copy or inflate a file.
+        */
+        bool read(const std::string& name, std::vector<uint8_t>& out) const;
+
+    private:
+        struct Header;
+        struct Entry;
+
+        const Entry* find(const std::string& name) const;
+        bool map(const std::string& filename);
+        void unmap();
+
+        std::string m_filename;
+        const uint8_t* m_pData = nullptr;
+        size_t m_size = 0;
+        const Entry* m_pEntries = nullptr;
+        uint32_t m_entryCount = 0;
+        const char* m_pNames = nullptr;
+#if defined(WIN32)
+        void* m_hFile = nullptr;
+        void* m_hMapping = nullptr;
+#endif
+    };
+}
+
+#endif
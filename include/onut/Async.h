@@ -1,13 +1,307 @@
 #ifndef ASYNC_H_INCLUDED
 #define ASYNC_H_INCLUDED
 
+// onut
+#include <onut/Dispatcher.h>
+#include <onut/ThreadPool.h>
+
 // STL
-#include <future>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
-template<typename ... Targs>
-inline auto OAsync(Targs... args) -> decltype(std::async(std::launch::async, args...))
+namespace onut
+{
+    class TaskStateBase
+    {
+    public:
+        using Listener = std::function<void()>;
+
+        bool isDone() const { return m_isDone.load(std::memory_order_acquire); }
+        bool isCancelled() const { return m_isCancelled.load(std::memory_order_acquire); }
+        void cancel() { m_isCancelled = true; }
+
+        /**
+        Called on the thread that completes the task. If the task is already
+        completed, it is called right away on the calling thread.
+        */
+        void addListener(const Listener& listener)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_isDone)
+                {
+                    m_listeners.push_back(listener);
+                    return;
+                }
+            }
+            listener();
+        }
+
+        void complete()
+        {
+            std::vector<Listener> listeners;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_isDone = true;
+                listeners.swap(m_listeners);
+            }
+            for (auto& listener : listeners) listener();
+        }
+
+        OThreadPool::JobHandle pJob;
+        std::exception_ptr pException; // Thrown by the task's function
+
+    private:
+        std::mutex m_mutex;
+        std::atomic<bool> m_isDone{false};
+        std::atomic<bool> m_isCancelled{false};
+        std::vector<Listener> m_listeners;
+    };
+
+    template<typename Tresult>
+    class TaskState final : public TaskStateBase
+    {
+    public:
+        std::optional<Tresult> value;
+    };
+
+    template<>
+    class TaskState<void> final : public TaskStateBase
+    {
+    };
+
+    template<typename Tresult, typename Tfn, typename ... Targs>
+    inline void resolveTask(TaskState<Tresult>& state, Tfn& fn, Targs&& ... args)
+    {
+        // Complete even if fn throws, or waiters would never return
+        try
+        {
+            if constexpr (std::is_void_v<Tresult>)
+            {
+                fn(std::forward<Targs>(args)...);
+            }
+            else
+            {
+                state.value.emplace(fn(std::forward<Targs>(args)...));
+            }
+        }
+        catch (...)
+        {
+            state.pException = std::current_exception();
+        }
+        state.complete();
+    }
+
+    template<typename Tresult, typename Tfn>
+    struct ContinuationResult
+    {
+        using type = std::invoke_result_t<Tfn, const Tresult&>;
+    };
+
+    template<typename Tfn>
+    struct ContinuationResult<void, Tfn>
+    {
+        using type = std::invoke_result_t<Tfn>;
+    };
+
+    /**
+    Handle to work running in the background. Copies share the same task.
+    Dropping the handle does not block, the work keeps going.
+    */
+    template<typename Tresult>
+    class Task final
+    {
+    public:
+        using State = TaskState<Tresult>;
+        using StateRef = std::shared_ptr<State>;
+
+        Task() = default;
+        explicit Task(const StateRef& pState) : m_pState(pState) {}
+
+        bool isValid() const { return m_pState != nullptr; }
+        bool isDone() const { return m_pState && m_pState->isDone(); }
+        bool isCancelled() const { return m_pState && m_pState->isCancelled(); }
+
+        /**
+        Work that hasn't started yet is skipped and continuations are not called.
+        Work already running finishes, but its result is discarded.
+        */
+        void cancel()
+        {
+            if (m_pState) m_pState->cancel();
+        }
+
+        /**
+        Block until the task is done. Background work is helped with on the calling thread.
+        Continuations need the main loop, waiting on them from the main thread pumps oDispatcher.
+        */
+        void wait() const
+        {
+            if (!m_pState) return;
+            if (m_pState->pJob && oThreadPool) oThreadPool->wait(m_pState->pJob);
+            while (!m_pState->isDone())
+            {
+                if (oDispatcher && oDispatcher->getThreadId() == std::this_thread::get_id())
+                {
+                    oDispatcher->processQueue();
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        /**
+        Wait for the result. Rethrows what the task threw.
+        Cancelled tasks, and invalid ones, have no result and throw std::bad_optional_access.
+        */
+        template<typename T = Tresult>
+        const std::enable_if_t<!std::is_void_v<T>, T>& get() const
+        {
+            if (!m_pState) throw std::bad_optional_access();
+            wait();
+            if (m_pState->pException) std::rethrow_exception(m_pState->pException);
+            return m_pState->value.value();
+        }
+
+        /**
+        Call fn on the main thread, through oDispatcher, once this task is done.
+        fn receives the result, unless the task returns void.
+        @return Task for the continuation, so they can be chained
+        */
+        template<typename Tfn>
+        auto then(Tfn fn) const
+        {
+            using Tnext = typename ContinuationResult<Tresult, Tfn>::type;
+
+            auto pNext = OMake<TaskState<Tnext>>();
+            auto pState = m_pState;
+            if (!pState)
+            {
+                pNext->cancel();
+                pNext->complete();
+                return Task<Tnext>(pNext);
+            }
+            pState->addListener([pState, pNext, fn]
+            {
+                OSync([pState, pNext, fn]() mutable
+                {
+                    if (pState->isCancelled() || pNext->isCancelled())
+                    {
+                        pNext->cancel();
+                        pNext->complete();
+                        return;
+                    }
+                    if (pState->pException)
+                    {
+                        // fn is skipped, the exception goes down the chain
+                        pNext->pException = pState->pException;
+                        pNext->complete();
+                        return;
+                    }
+                    if constexpr (std::is_void_v<Tresult>)
+                    {
+                        resolveTask(*pNext, fn);
+                    }
+                    else
+                    {
+                        resolveTask(*pNext, fn, *pState->value);
+                    }
+                });
+            });
+            return Task<Tnext>(pNext);
+        }
+
+        const StateRef& getState() const { return m_pState; }
+
+    private:
+        StateRef m_pState;
+    };
+}
+
+template<typename Tresult>
+using OTask = onut::Task<Tresult>;
+
+/**
+Run fn(args...) on oThreadPool. Without a pool (before onut::run creates it,
+or after it's destroyed) fn runs on a thread of its own.
+The pool has one worker per core, so work blocking for a long time, like
+network requests, should use OThread instead.
+@return Task that can be waited, cancelled or continued on the main thread with then()
+*/
+template<typename Tfn, typename ... Targs>
+inline auto OAsync(Tfn fn, Targs... args)
+{
+    using Tresult = std::invoke_result_t<Tfn, Targs...>;
+
+    auto pState = OMake<onut::TaskState<Tresult>>();
+    auto task = [pState, fn, args...]() mutable
+    {
+        if (pState->isCancelled())
+        {
+            pState->complete();
+            return;
+        }
+        auto bound = [&fn, &args...]() -> Tresult { return fn(args...); };
+        onut::resolveTask(*pState, bound);
+    };
+    if (oThreadPool)
+    {
+        pState->pJob = oThreadPool->doWork(task);
+    }
+    else
+    {
+        std::thread(task).detach();
+    }
+    return OTask<Tresult>(pState);
+}
+
+/**
+@return Task completing once all the given tasks are done, cancelled or not.
+Invalid tasks count as done.
+*/
+template<typename ... Tresults>
+inline OTask<void> OWhenAll(const OTask<Tresults>& ... tasks)
+{
+    auto pState = OMake<onut::TaskState<void>>();
+    auto pRemaining = OMake<std::atomic<int>>((int)sizeof...(tasks) + 1);
+    auto onTaskDone = [pState, pRemaining]
+    {
+        if (pRemaining->fetch_sub(1) == 1) pState->complete();
+    };
+    auto addListener = [&onTaskDone](const auto& task)
+    {
+        if (task.getState()) task.getState()->addListener(onTaskDone);
+        else onTaskDone();
+    };
+    (addListener(tasks), ...);
+    onTaskDone();
+    return OTask<void>(pState);
+}
+
+template<typename Tresult>
+inline OTask<void> OWhenAll(const std::vector<OTask<Tresult>>& tasks)
 {
-    return std::async(std::launch::async, args...);
+    auto pState = OMake<onut::TaskState<void>>();
+    auto pRemaining = OMake<std::atomic<int>>((int)tasks.size() + 1);
+    auto onTaskDone = [pState, pRemaining]
+    {
+        if (pRemaining->fetch_sub(1) == 1) pState->complete();
+    };
+    for (auto& task : tasks)
+    {
+        if (task.getState()) task.getState()->addListener(onTaskDone);
+        else onTaskDone();
+    }
+    onTaskDone();
+    return OTask<void>(pState);
 }
 
 template<typename ... Targs>
@@ -0,0 +1,92 @@
+#ifndef BUFFERARENA_H_INCLUDED
+#define BUFFERARENA_H_INCLUDED
+
+// STL
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Forward
+#include <onut/ForwardDeclaration.h>
+OForwardDeclare(BufferArena)
+OForwardDeclare(IndexBuffer)
+OForwardDeclare(VertexBuffer)
+
+namespace onut
+{
+    /**
+    Sub-allocates ranges from a few big static buffers, so lots of small
+    meshes share the same vertex or index buffer and draw one after the other
+    without rebinding. Draw a vertex range with its first element as the base
+    vertex of drawIndexed(), and an index range with it as the start offset.
+    Pages are first-fit free lists. Released ranges are merged with their free
+    neighbours, and pages left empty are given back on the next allocation.
+    Main thread only, like the buffers themselves.
+    */
+    class BufferArena final
+    {
+    public:
+        enum class Type
+        {
+            Vertex,
+            Index16,
+            Index32
+        };
+
+        static constexpr uint32_t DEFAULT_PAGE_SIZE = 4 * 1024 * 1024;
+
+        struct Page;
+
+        /**
+        Range of a page. It goes back to the arena when the last reference is released.
+        */
+        class Range final
+        {
+        public:
+            Range(const std::shared_ptr<Page>& pPage, uint32_t offset, uint32_t size, uint32_t elementSize);
+            ~Range();
+
+            /**
+            Upload data in the range. offset is in bytes from the start of the range.
+            */
+            void setData(const void* pData, uint32_t size, uint32_t offset = 0);
+
+            const OVertexBufferRef& getVertexBuffer() const;
+            const OIndexBufferRef& getIndexBuffer() const;
+            uint32_t getOffset() const { return m_offset; } // Bytes from the start of the buffer
+            uint32_t getSize() const { return m_size; }
+            uint32_t getFirstElement() const { return m_offset / m_elementSize; } // Base vertex or start index
+
+        private:
+            std::shared_ptr<Page> m_pPage;
+            uint32_t m_offset;
+            uint32_t m_size;
+            uint32_t m_elementSize;
+        };
+        using RangeRef = std::shared_ptr<Range>;
+
+        static OBufferArenaRef create(Type type, uint32_t pageSize = DEFAULT_PAGE_SIZE);
+
+        BufferArena(Type type, uint32_t pageSize);
+        ~BufferArena();
+
+        /**
+        @param size Bytes
+        @param elementSize Vertex stride, ranges start on a whole vertex. Ignored for index arenas.
+        @return nullptr if bigger than a page, use a buffer of its own then
+        */
+        RangeRef allocate(uint32_t size, uint32_t elementSize = 0);
+
+        Type getType() const { return m_type; }
+        uint32_t getPageSize() const { return m_pageSize; }
+        size_t getPageCount() const { return m_pages.size(); }
+        uint32_t getUsedSize() const;
+
+    private:
+        Type m_type;
+        uint32_t m_pageSize;
+        std::vector<std::shared_ptr<Page>> m_pages;
+    };
+}
+
+#endif
@@ -1,16 +1,22 @@
 #ifndef CONTENTMANAGER_H_INCLUDED
 #define CONTENTMANAGER_H_INCLUDED
 
+// Onut
+#include <onut/Async.h>
+
 // STL
 #include <mutex>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
 // Forward
 #include <onut/ForwardDeclaration.h>
+OForwardDeclare(Archive);
 OForwardDeclare(ContentManager);
 OForwardDeclare(Resource);
+OForwardDeclare(TextureAtlas);
 
 namespace onut
 {
@@ -33,51 +39,258 @@ namespace onut
         size_t size();
         void clear();
         OResourceRef getResource(const std::string& name);
+
+        /**
+        Load a resource now, or wait for it if it's already loading. Resources
+        are created on the main thread, so a pool worker waiting here needs the
+        main thread to keep running frames. Don't call it from jobs the main
+        thread is blocked on with OWait() or parallel_for().
+        */
         template<typename Tresource> std::shared_ptr<Tresource> getResourceAs(const std::string& name);
 
+        /**
+        Load a resource in the background. Asking for a resource already loading
+        returns the same load. Higher priorities are loaded first.
+        Resource types with a decodeFile() step (textures) decode on oThreadPool.
+        GPU objects are created on the main thread, within the upload budget of
+        each frame.
+        Cancelling the task cancels the load for everyone waiting on it.
+        */
+        template<typename Tresource> OTask<std::shared_ptr<Tresource>> getResourceAsync(const std::string& name, int priority = 0);
+
+        /**
+        Reprioritize a resource still loading, so level streaming can bring in
+        first what the camera is approaching.
+        */
+        void setLoadPriority(const std::string& name, int priority);
+        size_t getLoadingCount();
+
+        /**
+        Time the main thread can spend per frame creating loaded resources, in seconds.
+        At least one resource is created each frame.
+        */
+        void setUploadBudget(double seconds);
+        double getUploadBudget() const;
+
         // Search Paths
         void addDefaultSearchPaths();
-        void addSearchPath(const std::string& path);
+        void addSearchPath(const std::string& path); // A folder or an .onutpak archive
         void clearSearchPaths();
         std::string findResourceFile(const std::string& name);
         const SearchPaths& getSearchPaths() const;
 
+        /**
+        Search paths are scanned once, on their first lookup, and then looked up
+        by file name. Call this after adding or removing asset files so they are
+        scanned again.
+        */
+        void invalidateFileIndex();
+
+        /**
+        Atlas uploaded every frame before rendering. Loaded textures are not
+        packed in it, only the ones added with TextureAtlas::add, addFile and addFolder.
+        */
+        void setTextureAtlas(const OTextureAtlasRef& pTextureAtlas);
+        const OTextureAtlasRef& getTextureAtlas() const;
+
     private:
+        class Load
+        {
+        public:
+            virtual ~Load() {}
+
+            virtual bool decode(const OContentManagerRef& pContentManager) = 0; // Any thread
+            virtual OResourceRef create(const OContentManagerRef& pContentManager) = 0; // Main thread
+            virtual void resolve(const OResourceRef& pResource) = 0;
+            virtual bool isCancelled() const = 0;
+            virtual bool isDone() const = 0;
+
+            std::string name;
+            std::string filename;
+            int priority = 0;
+            uint64_t order = 0; // First asked, first loaded, at equal priority
+            bool isDecoded = false;
+        };
+        using LoadRef = std::shared_ptr<Load>;
+
+        template<typename Tresource> class TypedLoad;
+
         ContentManager();
 
+        LoadRef queueLoad(const LoadRef& pLoad);
+        LoadRef claimLoad(const LoadRef& pLoad);
+        void removeLoad(const LoadRef& pLoad);
+        static LoadRef popHighestPriority(std::vector<LoadRef>& queue);
+        void decodeNext();
+        void decode(const LoadRef& pLoad);
+        void waitForLoad(const LoadRef& pLoad);
+        void processLoads();
+        void finishLoad(const LoadRef& pLoad);
+
         using ResourceMap = std::unordered_map<std::string, OResourceRef>;
+        using FileIndex = std::unordered_map<std::string, std::string>; // File name -> path
+
+        const FileIndex& getFileIndex(const std::string& path);
 
         ResourceMap m_resources;
         SearchPaths m_searchPaths;
+        std::unordered_map<std::string, FileIndex> m_fileIndices; // By search path
+        std::unordered_map<std::string, OArchiveRef> m_archives; // Search paths that are archives, kept mapped
+        OTextureAtlasRef m_pTextureAtlas;
+        std::unordered_map<std::string, LoadRef> m_loads; // In flight, by name
+        std::vector<LoadRef> m_decodeQueue; // Short, searched for the highest priority
+        std::vector<LoadRef> m_createQueue;
+        uint64_t m_loadCount = 0;
+        bool m_isProcessLoadsQueued = false;
+        double m_uploadBudget = 0.002;
         std::mutex m_mutex;
     };
 
+    /**
+    Resource types opt in to decoding on worker threads by having a Decoded
+    type, with decodeFile() and createFromDecoded(). See Texture.
+    */
+    template<typename Tresource, typename = void>
+    struct HasDecodeStep : std::false_type {};
+
+    template<typename Tresource>
+    struct HasDecodeStep<Tresource, std::void_t<typename Tresource::Decoded>> : std::true_type {};
+
+    template<typename Tresource>
+    class ContentManager::TypedLoad final : public ContentManager::Load
+    {
+    public:
+        using State = TaskState<std::shared_ptr<Tresource>>;
+
+        bool decode(const OContentManagerRef& pContentManager) override
+        {
+            if constexpr (HasDecodeStep<Tresource>::value)
+            {
+                return Tresource::decodeFile(filename, pContentManager, m_decoded);
+            }
+            else
+            {
+                return true;
+            }
+        }
+
+        OResourceRef create(const OContentManagerRef& pContentManager) override
+        {
+            if constexpr (HasDecodeStep<Tresource>::value)
+            {
+                return Tresource::createFromDecoded(filename, m_decoded, pContentManager);
+            }
+            else
+            {
+                return Tresource::createFromFile(filename, pContentManager);
+            }
+        }
+
+        void resolve(const OResourceRef& pResource) override
+        {
+            pState->value.emplace(std::dynamic_pointer_cast<Tresource>(pResource));
+            pState->complete();
+        }
+
+        bool isCancelled() const override
+        {
+            return pState->isCancelled();
+        }
+
+        bool isDone() const override
+        {
+            return pState->isDone();
+        }
+
+        std::shared_ptr<State> pState = OMake<State>();
+
+    private:
+        template<typename T, typename = void> struct DecodedOf { struct type {}; };
+        template<typename T> struct DecodedOf<T, std::void_t<typename T::Decoded>> { using type = typename T::Decoded; };
+
+        typename DecodedOf<Tresource>::type m_decoded;
+    };
+
     template<typename Tresource>
     inline std::shared_ptr<Tresource> ContentManager::getResourceAs(const std::string& name)
     {
         auto pRet = std::dynamic_pointer_cast<Tresource>(getResource(name));
-        if (!pRet)
+        if (pRet) return pRet;
+
+        // Register the load before doing it, so other threads asking for it wait on this one
+        auto pNewLoad = OMake<TypedLoad<Tresource>>();
+        pNewLoad->name = name;
+        auto pLoad = claimLoad(pNewLoad);
+        while (pLoad != pNewLoad)
         {
-            auto searchName = name;
-            auto pos = name.find_last_of("\\/");
-            if (pos != std::string::npos)
+            if (!pLoad) return std::dynamic_pointer_cast<Tresource>(getResource(name)); // Loaded in the meantime
+            waitForLoad(pLoad);
+            pRet = std::dynamic_pointer_cast<Tresource>(getResource(name));
+            if (pRet) return pRet;
+
+            // That load failed or was cancelled, load it here
+            pLoad = claimLoad(pNewLoad);
+        }
+
+        auto searchName = name;
+        auto pos = name.find_last_of("\\/");
+        if (pos != std::string::npos)
+        {
+            searchName = name.substr(pos + 1);
+        }
+        auto filename = findResourceFile(searchName);
+        if (!filename.empty())
+        {
+            try
             {
-                searchName = name.substr(pos + 1);
+                pRet = Tresource::createFromFile(filename, shared_from_this());
             }
-            auto filename = findResourceFile(searchName);
-            if (!filename.empty())
+            catch (...)
             {
-                pRet = Tresource::createFromFile(filename, shared_from_this());
-                if (pRet)
-                {
-                    pRet->setName(name);
-                    pRet->setFilename(filename);
-                }
-                addResource(name, pRet);
+                removeLoad(pNewLoad);
+                pNewLoad->resolve(nullptr);
+                throw;
             }
+            if (pRet)
+            {
+                pRet->setName(name);
+                pRet->setFilename(filename);
+            }
+            addResource(name, pRet);
         }
+        removeLoad(pNewLoad);
+        pNewLoad->resolve(pRet);
         return pRet;
     }
+
+    template<typename Tresource>
+    inline OTask<std::shared_ptr<Tresource>> ContentManager::getResourceAsync(const std::string& name, int priority)
+    {
+        using State = typename TypedLoad<Tresource>::State;
+
+        auto pResource = std::dynamic_pointer_cast<Tresource>(getResource(name));
+        if (pResource)
+        {
+            auto pState = OMake<State>();
+            pState->value.emplace(pResource);
+            pState->complete();
+            return OTask<std::shared_ptr<Tresource>>(pState);
+        }
+
+        auto pNewLoad = OMake<TypedLoad<Tresource>>();
+        pNewLoad->name = name;
+        pNewLoad->priority = priority;
+        auto pLoad = std::dynamic_pointer_cast<TypedLoad<Tresource>>(queueLoad(pNewLoad));
+        if (!pLoad)
+        {
+            // Already loading as another type
+            auto pState = OMake<State>();
+            pState->value.emplace(nullptr);
+            pState->complete();
+            return OTask<std::shared_ptr<Tresource>>(pState);
+        }
+        return OTask<std::shared_ptr<Tresource>>(pLoad->pState);
+    }
 }
 
 extern OContentManagerRef oContentManager;
@@ -39,6 +39,8 @@ namespace onut
             OVertexBufferRef pVertexBuffer;
             uint32_t elementCount;
             Matrix transform;
+            uint32_t startIndex = 0;
+            uint32_t baseVertex = 0;
         };
 
         using RenderCallback = std::function<void()>;
@@ -2,10 +2,14 @@
 #define DISPATCHER_H_INCLUDED
 
 // STL
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
-#include <mutex>
-#include <queue>
+#include <new>
 #include <thread>
+#include <type_traits>
+#include <utility>
 
 // Forward
 #include <onut/ForwardDeclaration.h>
@@ -19,44 +23,93 @@ namespace onut
         static ODispatcherRef create();
 
         Dispatcher();
+        ~Dispatcher();
 
         /**
         Synchronise to the calling thread.
-        The function and arguments passed here, will be queued and called next time invokeQueue() is called.
+        The function passed here will be queued and called next time processQueue() is called.
+        Safe to call from any thread, without locking. Small callables are stored inline, no heap allocation.
         @param callback Function or your usual lambda
-        @param args arguments
         */
-        void dispatch(const std::function<void()>& fn)
+        template<typename Tfn>
+        void dispatch(Tfn&& fn)
         {
-            m_mutex.lock();
-            m_callbackQueue.push(fn);
-            m_mutex.unlock();
+            using Tcallable = std::decay_t<Tfn>;
+
+            auto pNode = allocNode();
+            if constexpr (sizeof(Tcallable) <= INLINE_SIZE && alignof(Tcallable) <= alignof(std::max_align_t))
+            {
+                new(pNode->storage) Tcallable(std::forward<Tfn>(fn));
+                pNode->invoke = [](Node* pNode) { (*reinterpret_cast<Tcallable*>(pNode->storage))(); };
+                pNode->destroy = [](Node* pNode) { reinterpret_cast<Tcallable*>(pNode->storage)->~Tcallable(); };
+            }
+            else
+            {
+                // Too big, the callable lives on the heap
+                *reinterpret_cast<Tcallable**>(pNode->storage) = new Tcallable(std::forward<Tfn>(fn));
+                pNode->invoke = [](Node* pNode) { (**reinterpret_cast<Tcallable**>(pNode->storage))(); };
+                pNode->destroy = [](Node* pNode) { delete *reinterpret_cast<Tcallable**>(pNode->storage); };
+            }
+            push(pNode);
         }
 
         /**
-        Call all currently queued callbacks set using sync() calls.
+        Call all currently queued callbacks set using dispatch() calls.
+        The whole queue is taken in one swap, callbacks dispatched while draining are called next time.
+        If a callback throws, the exception is passed on and the rest of the batch is called next time.
         */
         void processQueue();
 
         /**
         Get the count of callbacks currently in the queue
         */
-        size_t size();
+        size_t size() const;
+
+        /**
+        @return Count of callbacks called by the last processQueue()
+        */
+        size_t getLastDrainCount() const;
+
+        /**
+        @return Time spent calling callbacks in the last processQueue(), in seconds
+        */
+        double getLastDrainTime() const;
 
         std::thread::id getThreadId() const;
 
     private:
-        std::mutex m_mutex;
-        std::queue<std::function<void()>> m_callbackQueue;
+        static constexpr size_t INLINE_SIZE = 64;
+
+        struct Node
+        {
+            Node* pNext = nullptr;
+            void(*invoke)(Node*) = nullptr;
+            void(*destroy)(Node*) = nullptr;
+            alignas(std::max_align_t) uint8_t storage[INLINE_SIZE];
+        };
+
+        static Node* allocNode();
+        static void freeNode(Node* pNode);
+
+        void push(Node* pNode);
+
+        static std::atomic<Node*> s_pFreedNodes;
+
+        std::atomic<Node*> m_pHead{nullptr};
+        Node* m_pLeftOver = nullptr; // Rest of a batch interrupted by an exception, in call order
+        std::atomic<size_t> m_size{0};
+        size_t m_lastDrainCount = 0;
+        double m_lastDrainTime = 0.0;
         std::thread::id m_threadId;
     };
 }
 
 extern ODispatcherRef oDispatcher;
 
-inline void OSync(const std::function<void()>& callback)
+template<typename Tfn>
+inline void OSync(Tfn&& callback)
 {
-    oDispatcher->dispatch(callback);
+    oDispatcher->dispatch(std::forward<Tfn>(callback));
 }
 
 #endif
@@ -3,6 +3,7 @@
 
 // STL
 #include <cinttypes>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -35,6 +36,13 @@ namespace onut
     std::string makeRelativePath(const std::string& path, const std::string& relativeTo);
     std::vector<uint8_t> getFileData(const std::string& filename);
     std::string getFileString(const std::string& filename);
+
+    /**
+    Read a whole file, from the disk or from an archive (see Archive). Files
+    stored uncompressed in an archive are passed straight from its memory.
+    @return false if the file can't be read, then callback isn't called
+    */
+    bool readFile(const std::string& filename, const std::function<void(const uint8_t* pData, size_t size)>& callback);
     bool fileExists(const std::string& filename);
     std::string showOpenDialog(const std::string& caption, const FileTypes& extensions, const std::string& defaultFilename = "");
     std::string showSaveAsDialog(const std::string& caption, const FileTypes& extensions, const std::string& defaultFilename = "");
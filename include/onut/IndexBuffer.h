@@ -19,6 +19,14 @@ namespace onut
         virtual ~IndexBuffer();
 
         virtual void setData(const void* pIndexData, uint32_t size, int typeSize = 16) = 0;
+
+        /**
+        Update part of a static buffer, in place. offset and size are in bytes.
+        Static buffers created with initial data may be immutable, create them
+        with nullptr data to update them this way.
+        */
+        virtual void setSubData(const void* pIndexData, uint32_t offset, uint32_t size) = 0;
+
         virtual void* map() = 0;
         virtual void unmap(uint32_t size) = 0;
         virtual uint32_t size() = 0;
@@ -3,6 +3,7 @@
 
 // Onut
 #include <onut/Axis.h>
+#include <onut/BufferArena.h>
 #include <onut/Matrix.h>
 #include <onut/Resource.h>
 #include <onut/Vector3.h>
@@ -52,10 +53,15 @@ namespace onut
 
         struct Mesh
         {
-            OIndexBufferRef pIndexBuffer;
-            OVertexBufferRef pVertexBuffer;
+            OIndexBufferRef pIndexBuffer; // Shared with other meshes, draw from startIndex
+            OVertexBufferRef pVertexBuffer; // Shared with other meshes, draw from baseVertex
+            uint32_t startIndex = 0;
+            uint32_t baseVertex = 0;
+            BufferArena::RangeRef pIndexRange;
+            BufferArena::RangeRef pVertexRange;
             OShaderRef pVS;
             OShaderRef pPS;
+            int bonesUniformId = -1; // Into pVS
             OTextureRef pTexture;
             uint32_t elementCount;
             std::vector<Matrix> bones;
@@ -11,6 +11,7 @@
 #include <rapidjson/document.h>
 
 // STL
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -24,6 +25,20 @@ OForwardDeclare(Texture);
 
 namespace onut
 {
+    /**
+    How much of the global particle budget a system can use. Lower priorities
+    are throttled and refused first when the particle count gets high.
+    */
+    enum class ParticlePriority : uint8_t
+    {
+        Low,
+        Normal,
+        High,
+        Critical,
+
+        COUNT
+    };
+
     enum class PfxFinalValueType
     {
         MULT,
@@ -254,8 +269,12 @@ namespace onut
 
         const Emitters& getEmitters() const;
 
+        void setPriority(ParticlePriority priority);
+        ParticlePriority getPriority() const;
+
     private:
         Emitters m_emitters;
+        ParticlePriority m_priority = ParticlePriority::Normal;
     };
 }
 
@@ -1,6 +1,12 @@
 #ifndef PARTICLESYSTEMMANAGER_H_INCLUDED
 #define PARTICLESYSTEMMANAGER_H_INCLUDED
 
+// STL
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
 // Forward
 #include <onut/ForwardDeclaration.h>
 OForwardDeclare(ParticleSystem)
@@ -9,7 +15,10 @@ OForwardDeclare(Pool)
 
 namespace onut
 {
-    class Particle;
+    enum class ParticlePriority : uint8_t;
+    class ParticleEmitter;
+    class RadixSort;
+    template<typename Ttype> class TypedPool;
 
     class ParticleSystemManager : public std::enable_shared_from_this<ParticleSystemManager>
     {
@@ -18,6 +27,17 @@ namespace onut
 
         ParticleSystemManager(uintptr_t TmaxPFX = 100, uintptr_t TmaxParticles = 2000, bool TsortEmitters = false);
 
+        /**
+        Counters for the last update(). Particles spawned by emit() in between are counted in the next one.
+        */
+        struct Stats
+        {
+            size_t spawned = 0;         // Particles spawned
+            size_t throttled = 0;       // Particles not spawned because of the budget
+            size_t culled = 0;          // Emitters culled
+            size_t particleCount = 0;   // Particles alive after the update
+        };
+
         class EmitterInstance
         {
         public:
@@ -43,20 +63,120 @@ namespace onut
         bool hasAliveParticles() const;
         void render();
 
-        Particle* allocParticle();
-        void deallocParticle(Particle* pParticle);
-        void renderParticle(Particle* pParticle, const Vector3& camRight, const Vector3& camUp);
+        /**
+        Update emitters in parallel on oThreadPool. update() returns once they are all done,
+        so rendering after it is safe. Off by default.
+        */
+        void setParallelUpdate(bool parallelUpdate);
+        bool getParallelUpdate() const;
+
+        /**
+        Camera used for depth sorting. Depth is the distance along dir from position.
+        */
+        void setCamera(const Vector3& position, const Vector3& dir, const Vector3& up);
+        const Vector3& getCameraPosition() const;
+        const Vector3& getCameraDir() const;
+        const Vector3& getCameraUp() const;
+        const Vector3& getCameraRight() const;
+
+        /**
+        Render emitters back to front, by the depth of their position.
+        */
+        void setSortEmitters(bool sortEmitters);
+        bool getSortEmitters() const;
+
+        /**
+        Render the particles of each emitter back to front.
+        */
+        void setSortParticles(bool sortParticles);
+        bool getSortParticles() const;
+
+        /**
+        Fraction of the maximum particle count a priority can fill. Defaults are
+        0.5 for Low, 0.8 for Normal, 0.95 for High and 1 for Critical.
+        */
+        void setPriorityBudget(ParticlePriority priority, float fraction);
+        float getPriorityBudget(ParticlePriority priority) const;
+
+        /**
+        Once the particle count reaches this fraction of a priority's budget, spawn
+        rates of that priority scale down linearly, down to 0 at the budget.
+        Critical is never throttled. Default is 0.75.
+        */
+        void setThrottleThreshold(float threshold);
+        float getThrottleThreshold() const;
+        float getSpawnRateScale(ParticlePriority priority) const;
+
+        /**
+        Emitters outside the rect, or farther than the distance from the camera
+        position, don't spawn and are not rendered. Their particles still live out
+        their life. Particles travel away from their emitter, so give the rect a
+        margin. Critical emitters are never culled. Both are off by default, a
+        distance of 0 disables distance culling.
+        */
+        void setCullRect(const Rect& rect);
+        const Rect& getCullRect() const;
+        void setCullRectEnabled(bool cullRectEnabled);
+        bool getCullRectEnabled() const;
+        void setCullDistance(float distance);
+        float getCullDistance() const;
+        bool isCulled(const Vector3& position, ParticlePriority priority) const;
+
+        const Stats& getStats() const;
+
+        /**
+        Reserve room for one particle in the global particle count. Thread safe.
+        @return false if the budget of that priority is reached
+        */
+        bool allocParticle(ParticlePriority priority);
+        void deallocParticles(size_t count);
+        size_t getParticleCount() const;
 
     private:
         friend class EmitterInstance;
+        friend class ParticleEmitter;
 
-        void updateEmitters();
+        using InstanceEmitters = std::vector<ParticleEmitter*>;
 
-        OPoolRef m_pEmitterPool;
-        OPoolRef m_pParticlePool;
+        void updateEmitters();
+        void addStats(size_t spawned, size_t throttled, size_t culled);
+        void deallocEmitter(ParticleEmitter* pEmitter);
+        InstanceEmitters* getInstanceEmitters(uint32_t id);
+        const uint32_t* sortBackToFront(RadixSort& sorter, const float* pX, const float* pY, const float* pZ, size_t count);
+        const uint32_t* sortParticles(const float* pX, const float* pY, const float* pZ, size_t count);
+
+        std::shared_ptr<TypedPool<ParticleEmitter>> m_pEmitterPool;
+        std::unordered_map<uint32_t, InstanceEmitters> m_instances; // Alive emitters of each EmitterInstance
+        size_t m_maxParticles;
+        std::atomic<size_t> m_particleCount{0};
+        bool m_parallelUpdate = false;
+        Vector3 m_camPosition;
+        Vector3 m_camDir = -Vector3::UnitZ;
+        Vector3 m_camUp = -Vector3::UnitY;
         Vector3 m_camRight;
-        Vector3 m_camUp;
         bool m_sortEmitters;
+        bool m_sortParticles = false;
+
+        // Budget
+        float m_priorityBudgets[4] = {.5f, .8f, .95f, 1.f}; // Indexed by ParticlePriority
+        float m_throttleThreshold = .75f;
+        Rect m_cullRect;
+        bool m_cullRectEnabled = false;
+        float m_cullDistance = 0.f;
+        std::atomic<size_t> m_spawnedCount{0};
+        std::atomic<size_t> m_throttledCount{0};
+        std::atomic<size_t> m_culledCount{0};
+        Stats m_stats;
+
+        // Sorting scratch, reused between frames
+        std::shared_ptr<RadixSort> m_pEmitterSort;
+        std::shared_ptr<RadixSort> m_pParticleSort;
+        std::vector<float> m_sortX;
+        std::vector<float> m_sortY;
+        std::vector<float> m_sortZ;
+        std::vector<float> m_depths;
+        std::vector<uint16_t> m_depthKeys;
+        std::vector<ParticleEmitter*> m_sortedEmitters;
     };
 }
 
@@ -4,6 +4,10 @@
 // STL
 #include <cassert>
 #include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
 
 // Forward
 #include <onut/ForwardDeclaration.h>
@@ -11,9 +15,46 @@ OForwardDeclare(Pool);
 
 namespace onut
 {
+    /**
+    32 bits handle to a pooled object. The low bits are the slot index, the
+    high bits the generation of the slot when the object was allocated.
+    Once the object is freed, the slot generation changes and the handle
+    resolves to nullptr. 0 is never a valid handle.
+    */
+    using PoolHandle = uint32_t;
+
+    static const PoolHandle INVALID_POOL_HANDLE = 0;
+    static const uint32_t POOL_INDEX_BITS = 20;
+    static const uint32_t POOL_MAX_OBJ_COUNT = 1 << POOL_INDEX_BITS;
+    static const uint32_t POOL_GENERATION_MASK = (1 << (32 - POOL_INDEX_BITS)) - 1;
+
+    inline PoolHandle makePoolHandle(uint32_t index, uint32_t generation)
+    {
+        return (generation << POOL_INDEX_BITS) | index;
+    }
+
+    inline uint32_t getPoolHandleIndex(PoolHandle handle)
+    {
+        return handle & (POOL_MAX_OBJ_COUNT - 1);
+    }
+
+    inline uint32_t getPoolHandleGeneration(PoolHandle handle)
+    {
+        return handle >> POOL_INDEX_BITS;
+    }
+
+    inline uint32_t nextPoolGeneration(uint32_t generation)
+    {
+        // Skip 0 so a handle is never 0
+        generation = (generation + 1) & POOL_GENERATION_MASK;
+        return generation ? generation : 1;
+    }
+
     class Pool final
     {
     public:
+        using Handle = PoolHandle;
+
         enum class FailAction
         {
             AllocateOnHeap,
@@ -29,24 +70,8 @@ namespace onut
         template<typename Ttype, typename ... Targs>
         Ttype* alloc(Targs... args)
         {
-            // Are there still room?
-            if (m_allocCount == m_objCount)
-            {
-                switch (m_failAction)
-                {
-                    case FailAction::AllocateOnHeap:
-                        return new Ttype(args...);
-                    case FailAction::ReturnNull:
-                        return nullptr;
-                    case FailAction::Assert:
-                        assert(false); // No more memory available in the pool. Use bigger pool
-                        return nullptr;
-                }
-            }
-
-            // Make sure we are not trying to allocate an object too big
-            auto objSize = sizeof(Ttype);
-            if (objSize > m_objSize)
+            // Are there still room? Make sure we are not trying to allocate an object too big
+            if (m_firstFree == INVALID_INDEX || sizeof(Ttype) > m_objSize)
             {
                 switch (m_failAction)
                 {
@@ -60,41 +85,13 @@ namespace onut
                 }
             }
 
-            // Loop the pool from the last time.
-            auto startPoint = m_currentObjIndex;
-            do
-            {
-                ++m_currentObjIndex;
-                // Wrap
-                if (m_currentObjIndex >= m_objCount)
-                {
-                    m_currentObjIndex = 0;
-                }
-                auto pObj = m_pFirstObj + m_currentObjIndex * m_objTotalSize;
-                auto used = pObj + m_objSize;
-
-                if (!*used)
-                {
-                    // Found one!
-                    *used = 1;
-                    Ttype* pRet = new(pObj)Ttype(args...);
-                    ++m_allocCount;
-                    return pRet;
-                }
-            } while (startPoint != m_currentObjIndex);
-
-            switch (m_failAction)
-            {
-                case FailAction::AllocateOnHeap:
-                    return new Ttype(args...);
-                case FailAction::ReturnNull:
-                    return nullptr;
-                case FailAction::Assert:
-                    assert(false); // No more memory available in the pool. Use bigger pool
-                    return nullptr;
-            }
-
-            return nullptr;
+            // Pop the free list. The next free index is stored in the free object itself
+            auto index = m_firstFree;
+            auto pObj = m_pFirstObj + index * m_objTotalSize;
+            m_firstFree = *reinterpret_cast<uint32_t*>(pObj);
+            getHeader(index)->used = 1;
+            ++m_allocCount;
+            return new(pObj)Ttype(args...);
         }
 
         template<typename Ttype>
@@ -108,13 +105,17 @@ namespace onut
             if (ptr >= m_pMemory &&
                 ptr < m_pMemory + m_memorySize)
             {
-                pObj->~Ttype();
-                auto used = ptr + m_objSize;
-                if (!*used)
+                auto index = static_cast<uint32_t>((ptr - m_pFirstObj) / m_objTotalSize);
+                auto pHeader = getHeader(index);
+                if (!pHeader->used)
                 {
                     return false;
                 }
-                *used = 0;
+                pObj->~Ttype();
+                pHeader->used = 0;
+                pHeader->generation = nextPoolGeneration(pHeader->generation);
+                *reinterpret_cast<uint32_t*>(ptr) = m_firstFree;
+                m_firstFree = index;
                 --m_allocCount;
                 return true;
             }
@@ -135,10 +136,43 @@ namespace onut
             return reinterpret_cast<Ttype*>(m_pFirstObj + index * m_objTotalSize);
         }
 
+        /**
+        @return Handle for an object allocated in this pool, INVALID_POOL_HANDLE if it's not from this pool
+        */
+        Handle getHandle(const void* pObject) const;
+
+        /**
+        @return The object the handle refers to, or nullptr if it has been freed since
+        */
+        template<typename Ttype>
+        Ttype* get(Handle handle) const
+        {
+            auto index = getPoolHandleIndex(handle);
+            if (handle == INVALID_POOL_HANDLE || index >= m_objCount) return nullptr;
+            auto pHeader = getHeader(index);
+            if (!pHeader->used || pHeader->generation != getPoolHandleGeneration(handle)) return nullptr;
+            return at<Ttype>(index);
+        }
+
     protected:
+        static const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+        struct Header
+        {
+            uint32_t generation;
+            uint8_t used;
+        };
+
+        Header* getHeader(size_t index) const
+        {
+            return reinterpret_cast<Header*>(m_pFirstObj + index * m_objTotalSize + m_objSize);
+        }
+
+        void resetFreeList();
+
         size_t m_allocCount = 0;
         size_t m_objCount = 0;
-        size_t m_currentObjIndex = 0;
+        uint32_t m_firstFree = INVALID_INDEX;
         uint8_t* m_pFirstObj = nullptr;
         size_t m_objTotalSize = 0;
         size_t m_objSize = 0;
@@ -146,6 +180,150 @@ namespace onut
         uint8_t* m_pMemory = nullptr;
         size_t m_memorySize = 0;
     };
+
+    /**
+    Pool of a single type. Allocation and deallocation are O(1) and the live
+    objects are kept in a dense list that can be iterated with a range for.
+    Deallocating swaps the last live object in the freed spot of that list,
+    so when deallocating while iterating, iterate by index and don't advance
+    after a dealloc.
+    */
+    template<typename Ttype>
+    class TypedPool final
+    {
+    public:
+        using Handle = PoolHandle;
+        using Alive = std::vector<Ttype*>;
+
+        TypedPool(size_t objCount = 256)
+            : m_objCount(objCount)
+            , m_slots(new Slot[objCount])
+            , m_generations(objCount, 1)
+            , m_links(objCount)
+        {
+            assert(objCount <= POOL_MAX_OBJ_COUNT);
+            m_alive.reserve(objCount);
+            resetFreeList();
+        }
+
+        ~TypedPool()
+        {
+            clear();
+        }
+
+        TypedPool(const TypedPool&) = delete;
+        TypedPool& operator=(const TypedPool&) = delete;
+
+        template<typename ... Targs>
+        Ttype* alloc(Targs&& ... args)
+        {
+            if (m_firstFree == INVALID_INDEX) return nullptr;
+            auto index = m_firstFree;
+            m_firstFree = m_links[index];
+            auto pObj = new(m_slots[index].storage) Ttype(std::forward<Targs>(args)...);
+            m_links[index] = static_cast<uint32_t>(m_alive.size());
+            m_alive.push_back(pObj);
+            return pObj;
+        }
+
+        bool dealloc(Ttype* pObj)
+        {
+            auto index = getIndex(pObj);
+            if (index == INVALID_INDEX || !isAlive(index)) return false;
+
+            // Swap remove from the alive list
+            auto aliveIndex = m_links[index];
+            auto pLast = m_alive.back();
+            m_alive[aliveIndex] = pLast;
+            m_links[getIndex(pLast)] = aliveIndex;
+            m_alive.pop_back();
+
+            pObj->~Ttype();
+            m_generations[index] = nextPoolGeneration(m_generations[index]);
+            m_links[index] = m_firstFree;
+            m_firstFree = index;
+            return true;
+        }
+
+        bool dealloc(Handle handle)
+        {
+            return dealloc(get(handle));
+        }
+
+        void clear()
+        {
+            for (auto pObj : m_alive)
+            {
+                auto index = getIndex(pObj);
+                pObj->~Ttype();
+                m_generations[index] = nextPoolGeneration(m_generations[index]);
+            }
+            m_alive.clear();
+            resetFreeList();
+        }
+
+        Handle getHandle(const Ttype* pObj) const
+        {
+            auto index = getIndex(pObj);
+            if (index == INVALID_INDEX || !isAlive(index)) return INVALID_POOL_HANDLE;
+            return makePoolHandle(index, m_generations[index]);
+        }
+
+        Ttype* get(Handle handle) const
+        {
+            auto index = getPoolHandleIndex(handle);
+            if (handle == INVALID_POOL_HANDLE || index >= m_objCount) return nullptr;
+            if (m_generations[index] != getPoolHandleGeneration(handle) || !isAlive(index)) return nullptr;
+            return reinterpret_cast<Ttype*>(m_slots[index].storage);
+        }
+
+        size_t getAllocCount() const { return m_alive.size(); }
+        size_t size() const { return m_objCount; }
+        const Alive& getAlive() const { return m_alive; }
+        Ttype* operator[](size_t aliveIndex) const { return m_alive[aliveIndex]; }
+        typename Alive::const_iterator begin() const { return m_alive.begin(); }
+        typename Alive::const_iterator end() const { return m_alive.end(); }
+
+    private:
+        static const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+        struct Slot
+        {
+            alignas(Ttype) uint8_t storage[sizeof(Ttype)];
+        };
+
+        uint32_t getIndex(const Ttype* pObj) const
+        {
+            auto pSlot = reinterpret_cast<const Slot*>(pObj);
+            if (pSlot < m_slots.get() || pSlot >= m_slots.get() + m_objCount) return INVALID_INDEX;
+            return static_cast<uint32_t>(pSlot - m_slots.get());
+        }
+
+        bool isAlive(uint32_t index) const
+        {
+            auto aliveIndex = m_links[index];
+            return aliveIndex < m_alive.size() && m_alive[aliveIndex] == reinterpret_cast<const Ttype*>(m_slots[index].storage);
+        }
+
+        void resetFreeList()
+        {
+            for (size_t i = 0; i < m_objCount; ++i)
+            {
+                m_links[i] = (i + 1 < m_objCount) ? static_cast<uint32_t>(i + 1) : INVALID_INDEX;
+            }
+            m_firstFree = m_objCount ? 0 : INVALID_INDEX;
+        }
+
+        size_t m_objCount = 0;
+        std::unique_ptr<Slot[]> m_slots;
+        std::vector<uint32_t> m_generations;
+        std::vector<uint32_t> m_links; // Next free index for free slots, index in m_alive for used ones
+        Alive m_alive;
+        uint32_t m_firstFree = INVALID_INDEX;
+    };
 }
 
+template<typename Ttype>
+using OTypedPool = onut::TypedPool<Ttype>;
+
 #endif
@@ -6,6 +6,7 @@
 
 // STL
 #include <algorithm>
+#include <cstdint>
 #include <vector>
 
 namespace onut
@@ -15,6 +16,34 @@ namespace onut
     void setSeed(unsigned int seed);
     unsigned int randomizeSeed();
 
+    /**
+    Random numbers with their own state, in the same range as rand().
+    */
+    class RandomGenerator final
+    {
+    public:
+        explicit RandomGenerator(unsigned int seed);
+        int next();
+
+    private:
+        uint32_t m_state;
+    };
+
+    /**
+    While alive, the rand functions called on this thread draw from
+    generator instead of the shared rand() state. Lets worker threads get
+    their own sequence, seeded from the main one so setSeed() still holds.
+    */
+    class ScopedRandomGenerator final
+    {
+    public:
+        explicit ScopedRandomGenerator(RandomGenerator& generator);
+        ~ScopedRandomGenerator();
+
+    private:
+        RandomGenerator* m_pPrevious;
+    };
+
     int randi();
     int randi(int max);
     int randi(int min, int max);
@@ -0,0 +1,133 @@
+#ifndef RENDERCOMMANDLIST_H_INCLUDED
+#define RENDERCOMMANDLIST_H_INCLUDED
+
+// Onut
+#include <onut/BlendMode.h>
+#include <onut/Maths.h>
+#include <onut/PrimitiveMode.h>
+#include <onut/SampleMode.h>
+
+// STL
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Forward
+#include <onut/ForwardDeclaration.h>
+OForwardDeclare(IndexBuffer)
+OForwardDeclare(RenderCommandList)
+OForwardDeclare(Renderer)
+OForwardDeclare(Resource)
+OForwardDeclare(Shader)
+OForwardDeclare(Texture)
+OForwardDeclare(VertexBuffer)
+
+namespace onut
+{
+    /**
+    Render state changes, uniforms and draw calls recorded in a compact binary
+    stream, executed later with Renderer::execute() on the main thread. A list
+    can be recorded on any thread, one thread per list. States that are not
+    recorded are left as they are when the list executes.
+    Lists are kept after execution, reset() them before recording again. The
+    stream memory is reused from one recording to the next.
+    */
+    class RenderCommandList final
+    {
+    public:
+        enum class CommandType : uint8_t
+        {
+            Texture,
+            BlendMode,
+            SampleFiltering,
+            SampleAddressMode,
+            PrimitiveMode,
+            DepthEnabled,
+            DepthWrite,
+            BackFaceCull,
+            ScissorEnabled,
+            Scissor,
+            Viewport,
+            World,
+            View,
+            Projection,
+            VertexShader,
+            PixelShader,
+            VertexBuffer,
+            IndexBuffer,
+            UniformVector,
+            UniformMatrix,
+            Draw,
+            DrawIndexed,
+            UniformMatrixArray,
+
+            COUNT
+        };
+
+        static ORenderCommandListRef create();
+
+        void reset();
+
+        // States
+        void setTexture(int slot, const OTextureRef& pTexture);
+        void setBlendMode(BlendMode blendMode);
+        void setSampleFiltering(sample::Filtering filtering);
+        void setSampleAddressMode(sample::AddressMode addressMode);
+        void setPrimitiveMode(PrimitiveMode primitiveMode);
+        void setDepthEnabled(bool depthEnabled);
+        void setDepthWrite(bool depthWrite);
+        void setBackFaceCull(bool backFaceCull);
+        void setScissorEnabled(bool scissorEnabled);
+        void setScissor(const iRect& scissor);
+        void setViewport(const iRect& viewport);
+        void setWorld(const Matrix& world);
+        void setView(const Matrix& view);
+        void setProjection(const Matrix& projection);
+        void setVertexShader(const OShaderRef& pShader);
+        void setPixelShader(const OShaderRef& pShader);
+        void setVertexBuffer(const OVertexBufferRef& pVertexBuffer);
+        void setIndexBuffer(const OIndexBufferRef& pIndexBuffer);
+
+        // Uniforms. Use Shader::getUniformId() to get varId.
+        void setFloat(const OShaderRef& pShader, int varId, float value);
+        void setVector2(const OShaderRef& pShader, int varId, const Vector2& value);
+        void setVector3(const OShaderRef& pShader, int varId, const Vector3& value);
+        void setVector4(const OShaderRef& pShader, int varId, const Vector4& value);
+        void setMatrix(const OShaderRef& pShader, int varId, const Matrix& value);
+        void setMatrixArray(const OShaderRef& pShader, int varId, const Matrix* pValues, int count); // Skinning bones
+
+        // Draws
+        void draw(uint32_t vertexCount);
+        void drawIndexed(uint32_t indexCount, uint32_t startOffset = 0, uint32_t baseVertex = 0);
+
+        size_t getCommandCount() const { return m_commandCount; }
+        size_t getDrawCount() const { return m_drawCount; }
+        const std::vector<uint8_t>& getStream() const { return m_stream; }
+        const std::vector<OResourceRef>& getResources() const { return m_resources; }
+
+        /**
+        Write the list for offline analysis. The stream is followed by the
+        names of the resources it refers to, in order.
+        */
+        bool save(const std::string& filename) const;
+
+    private:
+        friend class Renderer;
+
+        static const uint32_t NO_RESOURCE = 0xFFFFFFFF;
+
+        template<typename Tpayload> void write(CommandType type, const Tpayload& payload);
+        uint32_t addResource(const OResourceRef& pResource);
+        void setUniform(const OShaderRef& pShader, int varId, const float* pValues, uint8_t count);
+        void execute(Renderer& renderer) const;
+
+        std::vector<uint8_t> m_stream;
+        std::vector<OResourceRef> m_resources;
+        std::unordered_map<Resource*, uint32_t> m_resourceIndices;
+        size_t m_commandCount = 0;
+        size_t m_drawCount = 0;
+    };
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 // Onut
 #include <onut/BlendMode.h>
+#include <onut/BufferArena.h>
 #include <onut/Maths.h>
 #include <onut/Point.h>
 #include <onut/PrimitiveMode.h>
@@ -14,6 +15,7 @@
 // Forward
 #include <onut/ForwardDeclaration.h>
 OForwardDeclare(IndexBuffer)
+OForwardDeclare(RenderCommandList)
 OForwardDeclare(Renderer)
 OForwardDeclare(Shader)
 OForwardDeclare(Texture)
@@ -153,6 +155,47 @@ namespace onut
         RenderState<Color> clearColor;
     };
 
+    /**
+    Renderer counters for one frame, broken down by the subsystem that caused
+    them. Subsystems tag their work with Renderer::setStatsSource().
+    */
+    struct FrameStats
+    {
+        enum class Source
+        {
+            Other,
+            SpriteBatch,
+            PrimitiveBatch,
+            TiledMap,
+            Model,
+            Imgui,
+
+            COUNT
+        };
+
+        enum class Counter
+        {
+            DrawCalls,
+            Vertices, // Vertices or indices drawn
+            TextureBinds,
+            ShaderChanges,
+            StateChanges,
+            UniformUploads,
+            UploadedBytes, // Vertex, index and texture data sent to the GPU
+
+            COUNT
+        };
+
+        static const char* getSourceName(Source source);
+        static const char* getCounterName(Counter counter);
+
+        uint32_t get(Counter counter) const { return totals[(int)counter]; }
+        uint32_t get(Source source, Counter counter) const { return counters[(int)source][(int)counter]; }
+
+        uint32_t counters[(int)Source::COUNT][(int)Counter::COUNT] = {};
+        uint32_t totals[(int)Counter::COUNT] = {};
+    };
+
     class Renderer
     {
     public:
@@ -180,7 +223,17 @@ namespace onut
         virtual void beginFrame() = 0;
         virtual void endFrame() = 0;
         virtual void draw(uint32_t vertexCount) = 0;
-        virtual void drawIndexed(uint32_t indexCount, uint32_t startOffset = 0) = 0;
+        /**
+        @param startOffset First index to read
+        @param baseVertex Added to every index, to draw from a range of a shared vertex buffer
+        */
+        virtual void drawIndexed(uint32_t indexCount, uint32_t startOffset = 0, uint32_t baseVertex = 0) = 0;
+
+        /**
+        Replay a recorded command list in order. Must be called from the main thread,
+        once the recording thread is done with the list.
+        */
+        void execute(const ORenderCommandListRef& pCommandList);
 
         Point getResolution() const;
         virtual Point getTrueResolution() const = 0;
@@ -215,16 +268,85 @@ namespace onut
         OShaderRef get3DVSForInput(bool hasColor, bool hasTexture, bool hasWeights);
         OShaderRef get3DPSForInput(bool hasTexture);
 
+        /**
+        2D shaders picking their texture from a per-vertex index, see SpriteBatch::setMultiTexture
+        */
+        const OShaderRef& get2DMultiTextureVS() const { return m_p2DMultiTextureVertexShader; }
+        const OShaderRef& get2DMultiTexturePS() const { return m_p2DMultiTexturePixelShader; }
+
+        /**
+        2D vertex shaders reading colors as 4 normalized bytes. They go with the regular 2D pixel shaders.
+        */
+        const OShaderRef& get2DPackedColorVS() const { return m_p2DPackedColorVertexShader; }
+        const OShaderRef& get2DMultiTexturePackedColorVS() const { return m_p2DMultiTexturePackedColorVertexShader; }
+
+        // Quads
+        static constexpr uint32_t QUAD_INDEX_BUFFER_QUAD_COUNT = 0x10000 / 4; // All 16 bits indices
+
+        /**
+        Static index buffer drawing quads of 4 vertices as 2 triangles, (0, 1, 2, 2, 3, 0) + 4 * quad.
+        Shared by everything drawing quads, so it stays bound from one system to the next.
+        */
+        const OIndexBufferRef& getQuadIndexBuffer() const { return m_pQuadIndexBuffer; }
+
+        /**
+        Same pattern as getQuadIndexBuffer(), 32 bits indices when 16 bits can't address all the quads.
+        */
+        static OIndexBufferRef createQuadIndexBuffer(uint32_t quadCount);
+
+        /**
+        Arenas shared by static geometry (tile map chunks, models), so it draws from a few big buffers.
+        */
+        const OBufferArenaRef& getBufferArena(BufferArena::Type type) const { return m_pBufferArenas[(int)type]; }
+
+        // Stats
+        /**
+        Counters of the last completed frame.
+        */
+        const FrameStats& getFrameStats() const { return m_frameStats; }
+
+        /**
+        Attribute the following renderer work to a subsystem.
+        @return The previous source, to restore when done
+        */
+        FrameStats::Source setStatsSource(FrameStats::Source source);
+        FrameStats::Source getStatsSource() const { return m_statsSource; }
+
+        void addStat(FrameStats::Counter counter, uint32_t amount = 1)
+        {
+            m_currentFrameStats.counters[(int)m_statsSource][(int)counter] += amount;
+        }
+
     protected:
         Renderer();
 
         void loadShaders();
         void setupEffectRenderStates();
 
+        /**
+        Count the dirty render states, before the backend applies them.
+        */
+        void addDirtyStateStats();
+
+        /**
+        Called by backends at the end of the frame.
+        */
+        void endFrameStats();
+
+        FrameStats m_frameStats;
+        FrameStats m_currentFrameStats;
+        FrameStats::Source m_statsSource = FrameStats::Source::Other;
+
         OVertexBufferRef m_pEffectsVertexBuffer;
+        OIndexBufferRef m_pQuadIndexBuffer;
+        OBufferArenaRef m_pBufferArenas[3]; // By BufferArena::Type
 
         OShaderRef m_p2DVertexShader;
         OShaderRef m_p2DPixelShader;
+        OShaderRef m_p2DMultiTextureVertexShader;
+        OShaderRef m_p2DMultiTexturePixelShader;
+        OShaderRef m_p2DPackedColorVertexShader;
+        OShaderRef m_p2DMultiTexturePackedColorVertexShader;
         OShaderRef m_p3DVertexShaderPNCT;
         OShaderRef m_p3DVertexShaderPNT;
         OShaderRef m_p3DVertexShaderPNC;
@@ -80,6 +80,10 @@ namespace onut
         bool getShowFPS() const { return m_showFPS; }
         void setShowFPS(bool showFPS);
 
+        /** Draw the renderer frame stats under the FPS */
+        bool getShowRenderStats() const { return m_showRenderStats; }
+        void setShowRenderStats(bool showRenderStats);
+
         bool getAutoLoadScripts() const { return m_autoLoadScripts; }
         void setAutoLoadScripts(bool autoLoadScripts);
 
@@ -105,6 +109,7 @@ namespace onut
         std::string m_matchMakingAddress = "192.168.1.112";
         int m_matchMakingPort = 4444;
         bool m_showFPS = true;
+        bool m_showRenderStats = false;
         bool m_autoLoadScripts = true;
         bool m_antiAliasing = false;
 
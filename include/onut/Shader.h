@@ -33,6 +33,7 @@ namespace onut
             Float3 = 3,
             Float4 = 4,
             UInt = 5,
+            UByte4 = 6, // Vertex input only. 4 normalized unsigned bytes, seen as a float4 by the shader
             Matrix = 16
         };
 
@@ -221,6 +222,13 @@ namespace onut
     protected:
         friend class RendererGL;
 
+        /**
+        Lay out the uniforms in a single block, std140 rules. GL uses the
+        layout as is and D3D11 with packoffset, so both see the same data.
+        @return Size of the block, a multiple of 16
+        */
+        static uint32_t packUniforms(const ParsedUniforms& uniforms, std::vector<uint32_t>& offsets);
+
         Type m_type;
         uint32_t m_vertexSize = 0;
 
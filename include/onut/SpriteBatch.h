@@ -7,6 +7,8 @@
 #include <onut/SampleMode.h>
 
 // STL
+#include <cstdint>
+#include <unordered_map>
 #include <vector>
 
 // Forward
@@ -19,8 +21,23 @@ OForwardDeclare(VertexBuffer);
 
 namespace onut
 {
+    class RadixSort;
     class RenderStates;
 
+    /**
+    How sprites are ordered between begin() and end(). Immediate draws in
+    call order and flushes on every texture or state change. The other modes
+    record the sprites and sort them at end() or flush(), so sprites sharing
+    a texture and states go out in one draw call. Sorting is stable.
+    */
+    enum class SpriteSortMode
+    {
+        Immediate,
+        Texture,        // By blend mode, filtering then texture
+        BackToFront,    // By layer, 1 first, then as Texture
+        FrontToBack     // By layer, 0 first, then as Texture
+    };
+
     class SpriteBatch : public std::enable_shared_from_this<SpriteBatch>
     {
     public:
@@ -31,13 +48,94 @@ namespace onut
             Color   color;
         };
 
-        static OSpriteBatchRef create();
+        struct SVertexP2T2C4T1
+        {
+            Vector2 position;
+            Vector2 texCoord;
+            Color   color;
+            float   textureIndex;
+        };
+
+        /**
+        Same as above with the color packed in 4 normalized bytes, RGBA in memory order.
+        The layout of ImDrawVert, and 20 bytes instead of 32.
+        */
+        struct SVertexP2T2C4ub
+        {
+            Vector2  position;
+            Vector2  texCoord;
+            uint32_t color;
+        };
+
+        struct SVertexP2T2C4ubT1
+        {
+            Vector2  position;
+            Vector2  texCoord;
+            uint32_t color;
+            float    textureIndex;
+        };
+
+        /**
+        One sprite of drawSprites(). The size is the texture size times the UV
+        rect size times scale. Rotation is in degrees.
+        */
+        struct SpriteInstance
+        {
+            Vector2 position;
+            float   rotation = 0.f;
+            Vector2 scale = Vector2::One;
+            Vector2 origin = OCenter;
+            Vector4 uvs = {0, 0, 1, 1};
+            Color   color = Color::White;
+        };
+
+        static constexpr uint32_t DEFAULT_SPRITE_COUNT = 4096;
+        static constexpr uint32_t MAX_SPRITE_COUNT = 65536;
+        static constexpr uint32_t DEFAULT_BUFFER_COUNT = 3;
+        static const int MAX_BATCH_TEXTURES = 8; // RenderStates::MAX_TEXTURES
+
+        /**
+        Why the batch was drawn. Counted in FlushStats.
+        */
+        enum class FlushReason
+        {
+            Full,           // Reached the sprite count of the batch
+            TextureChange,
+            StateChange,    // Blend mode or sampling changed
+            Explicit,       // flush() called from outside or end()
+            COUNT
+        };
+
+        struct FlushStats
+        {
+            uint32_t reasons[(int)FlushReason::COUNT] = {0};
+            uint32_t drawCalls = 0;
+            uint32_t spriteCount = 0;
+        };
+
+        /**
+        @param maxSpriteCount Sprites drawn in one draw call at most, up to MAX_SPRITE_COUNT.
+                              Indices switch to 32 bits above 16384 sprites.
+        @param bufferCount Dynamic vertex buffers used in turn, so filling one doesn't wait
+                           on the GPU still reading from the previous ones. 0 makes a recorder.
+        */
+        static OSpriteBatchRef create(uint32_t maxSpriteCount = DEFAULT_SPRITE_COUNT, uint32_t bufferCount = DEFAULT_BUFFER_COUNT);
+
+        /**
+        A recorder is a sprite batch without GPU resources. Between begin() and
+        end() it only records quads, so recorders can be filled on worker
+        threads, one recorder per thread. Their blend mode and filtering are set
+        through getRecordStates(). drawRecorded() then draws them from the
+        render thread, in the order it's called. begin() clears the previous
+        recording. Create recorders on the main thread, and keep them around.
+        */
+        static OSpriteBatchRef createRecorder();
 
-        SpriteBatch();
+        SpriteBatch(uint32_t maxSpriteCount = DEFAULT_SPRITE_COUNT, uint32_t bufferCount = DEFAULT_BUFFER_COUNT);
         virtual ~SpriteBatch();
 
-        void begin();
-        void begin(const Matrix& transform);
+        void begin(SpriteSortMode sortMode = SpriteSortMode::Immediate);
+        void begin(const Matrix& transform, SpriteSortMode sortMode = SpriteSortMode::Immediate);
         void drawAbsoluteRect(const OTextureRef& pTexture, const Rect& rect, const Color& color = Color::White);
         void drawRect(const OTextureRef& pTexture, const Rect& rect, const Color& color = Color::White);
         void drawInclinedRect(const OTextureRef& pTexture, const Rect& rect, float inclinedRatio = -1.f, const Color& color = Color::White);
@@ -54,6 +152,13 @@ namespace onut
         void drawSpriteWithUVs(const OTextureRef& pTexture, const Vector2& position, const Vector4& uvs, const Color& color, float rotation, float scale = 1.f, const Vector2& origin = OCenter);
         void drawSpriteWithUVs(const OTextureRef& pTexture, const Matrix& transform, const Vector4& uvs, const Color& color, const Vector2& origin = OCenter);
         void drawSpriteWithUVs(const OTextureRef& pTexture, const Matrix& transform, const Vector2& scale, const Vector4& uvs, const Color& color, const Vector2& origin = OCenter);
+
+        /**
+        Draw a lot of sprites using the same texture. Vertices are generated 4
+        sprites at a time with SIMD, which is much faster than drawSprite() in a loop.
+        */
+        void drawSprites(const OTextureRef& pTexture, const SpriteInstance* pSprites, size_t count);
+        void drawSprites(const OTextureRef& pTexture, const std::vector<SpriteInstance>& sprites);
         void drawBeam(const OTextureRef& pTexture, const Vector2& from, const Vector2& to, float size, const Color& color, float uOffset = 0.f, float uScale = 1.f);
         void drawCross(const Vector2& position, float size, const Color& color = Color::White, float thickness = 2.f);
         void drawInnerOutlineRect(const Rect& rect, float thickness, const Color& color = Color::White);
@@ -75,18 +180,81 @@ namespace onut
                               bool snapPixels = true);
         void end();
 
+        /**
+        Draw what a recorder holds, as if it was drawn here. Sorted batches sort
+        the recorded sprites with their own. The recording is kept.
+        */
+        void drawRecorded(const OSpriteBatchRef& pRecorder);
+        bool isRecorder() const { return m_pRecordStates != nullptr; }
+        size_t getRecordedCount() const { return m_commands.size(); }
+        RenderStates& getRecordStates() { return *m_pRecordStates; }
+
         const Matrix& getTransform() const { return m_currentTransform; }
 
         bool isInBatch() const { return m_isDrawing; };
+        SpriteSortMode getSortMode() const { return m_sortMode; }
+
+        /**
+        Layer depth, from 0 to 1, given to the next sprites. Only used by the
+        BackToFront and FrontToBack sort modes. Reset to 0 by begin().
+        */
+        void setLayer(float layer);
+        float getLayer() const { return m_layer; }
+
+        /**
+        Bind up to MAX_BATCH_TEXTURES textures per draw call. Each vertex carries
+        the slot of its texture and the batch draws with the multi-texture 2D
+        shaders, so custom shaders can't be used in that mode. A flush happens
+        when a 9th texture shows up. Takes effect at the next begin().
+        */
+        void setMultiTexture(bool multiTexture);
+        bool getMultiTexture() const { return m_multiTexture; }
+
+        /**
+        Send colors as 4 bytes per vertex instead of 4 floats. Colors are
+        clamped to [0, 1]. The batch draws with the packed color 2D vertex
+        shaders, so custom vertex shaders can't be used in that mode. Takes
+        effect at the next begin().
+        */
+        void setPackedColors(bool packedColors);
+        bool getPackedColors() const { return m_packedColors; }
 
         void flush();
 
+        uint32_t getMaxSpriteCount() const { return m_maxSpriteCount; }
+        uint32_t getBufferCount() const { return static_cast<uint32_t>(m_vertexBuffers.size()); }
+
+        /**
+        Counters accumulate until resetFlushStats() is called, once per frame usually.
+        */
+        const FlushStats& getFlushStats() const { return m_flushStats; }
+        void resetFlushStats();
+
     private:
-        static const int MAX_SPRITE_COUNT = 300;
+        struct SpriteCommand
+        {
+            uint32_t textureIndex;
+            uint16_t layer;
+            uint8_t blendMode;
+            uint8_t filtering;
+        };
+
+        void flush(FlushReason reason);
+        uint32_t getVertexSize() const;
+        void replay(const SpriteBatch& source, const uint32_t* pOrder);
+        void clearCommands();
+        void generateSprites(const SpriteInstance* pSprites, size_t count, SVertexP2T2C4* pVerts, bool isFinal);
+        SVertexP2T2C4* nextQuad();
+        void commitQuad();
+        void drawSorted();
 
+        uint32_t m_maxSpriteCount = DEFAULT_SPRITE_COUNT;
+        std::vector<OVertexBufferRef> m_vertexBuffers;
+        size_t m_currentVertexBuffer = 0;
         OVertexBufferRef m_pVertexBuffer;
         OIndexBufferRef m_pIndexBuffer;
-        SVertexP2T2C4* m_pMappedVertexBuffer = nullptr;
+        FlushStats m_flushStats;
+        uint8_t* m_pMappedVertexBuffer = nullptr;
 
         bool m_isDrawing = false;
         bool m_snapToPixel = false;
@@ -97,8 +265,41 @@ namespace onut
 
         OTextureRef m_pTexture = nullptr;
         unsigned int m_spriteCount = 0;
+
+        // Texture bound for the draw. It's the atlas page for packed textures, which have their UVs remapped.
+        OTextureRef m_pPageTexture = nullptr;
+        bool m_remapUVs = false;
+        Vector4 m_uvRect;
+        SVertexP2T2C4* m_pQuad = nullptr;
         Matrix m_currentTransform;
         RenderStates *m_pRenderStates = nullptr;
+
+        // Sorted modes record here until end() or flush()
+        SpriteSortMode m_sortMode = SpriteSortMode::Immediate;
+        float m_layer = 0.f;
+        std::vector<SpriteCommand> m_commands;
+        std::vector<SVertexP2T2C4> m_commandVertices;
+        std::vector<OTextureRef> m_commandTextures;
+        std::unordered_map<Texture*, uint32_t> m_commandTextureIndices;
+        Texture* m_pLastCommandTexture = nullptr;
+        uint32_t m_lastCommandTextureIndex = 0;
+        std::vector<uint64_t> m_sortKeys;
+        std::shared_ptr<RadixSort> m_pSort;
+
+        // Multi-texture mode
+        bool m_multiTexture = false;
+        bool m_isMultiTexturing = false;
+        OTextureRef m_slotTextures[MAX_BATCH_TEXTURES];
+        int m_slotCount = 0;
+        float m_textureSlot = 0.f;
+        SVertexP2T2C4 m_quad[4];
+
+        // Recorders draw in their own states
+        std::shared_ptr<RenderStates> m_pRecordStates;
+
+        // Packed color mode, vertices are also completed in commitQuad()
+        bool m_packedColors = false;
+        bool m_isPackingColors = false;
     };
 }
 
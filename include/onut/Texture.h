@@ -33,7 +33,23 @@ namespace onut
     class Texture : public Resource, public std::enable_shared_from_this<Texture>
     {
     public:
+        /**
+        Image decoded from a file, RGBA. Nothing is created on the GPU yet.
+        */
+        struct Decoded
+        {
+            std::shared_ptr<uint8_t> pData;
+            Point size;
+        };
+
         static OTextureRef createFromFile(const std::string& filename, const OContentManagerRef& pContentManager = nullptr, bool generateMipmaps = oGenerateMipmaps);
+
+        /**
+        createFromFile() in two steps. decodeFile() only reads and decodes, it
+        can run on any thread. createFromDecoded() has to run on the main thread.
+        */
+        static bool decodeFile(const std::string& filename, const OContentManagerRef& pContentManager, Decoded& out);
+        static OTextureRef createFromDecoded(const std::string& filename, const Decoded& decoded, const OContentManagerRef& pContentManager = nullptr, bool generateMipmaps = oGenerateMipmaps);
         static OTextureRef createFromFileData(const uint8_t* pData, uint32_t size, bool generateMipmaps = oGenerateMipmaps);
         static OTextureRef createFromData(const uint8_t* pData, const Point& size, bool generateMipmaps = oGenerateMipmaps);
         static OTextureRef createFromDataWithFormat(const uint8_t* pData, const Point& size, RenderTargetFormat format, bool generateMipmaps = oGenerateMipmaps);
@@ -63,6 +79,13 @@ namespace onut
         virtual void setData(const uint8_t* pData) = 0;
         virtual void resizeTarget(const Point& size) = 0;
 
+        /**
+        Textures packed in a TextureAtlas keep their own size, but are drawn
+        from a page of the atlas. UVs are the region in the page (u1, v1, u2, v2).
+        */
+        const OTextureRef& getAtlasPage() const { return m_pAtlasPage; }
+        const Vector4& getAtlasUVs() const { return m_atlasUVs; }
+
     protected:
         Texture() :
             m_type{}
@@ -80,6 +103,8 @@ namespace onut
         Type m_type;
         bool m_isScreenRenderTarget = false;
         RenderTargetFormat m_format = onut::RenderTargetFormat::RGBA8;
+        OTextureRef m_pAtlasPage;
+        Vector4 m_atlasUVs = {0, 0, 1, 1};
     };
 }
 
@@ -0,0 +1,80 @@
+#ifndef TEXTUREATLAS_H_INCLUDED
+#define TEXTUREATLAS_H_INCLUDED
+
+// Onut
+#include <onut/Point.h>
+
+// STL
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Forward
+#include <onut/ForwardDeclaration.h>
+OForwardDeclare(ContentManager);
+OForwardDeclare(Texture);
+OForwardDeclare(TextureAtlas);
+
+namespace onut
+{
+    /**
+    Packs small textures into big pages, so sprites using different textures
+    can still be drawn together. Packed textures are light references to a
+    region of a page. They keep their own size and SpriteBatch remaps their
+    UVs. They can only be drawn with SpriteBatch, binding one directly in
+    renderStates.textures asserts. UVs outside [0, 1] (wrap) are not
+    supported on packed textures.
+    Pixels are sent to the GPU by upload(), which is called every frame before
+    rendering. Textures packed while rendering show up the frame after.
+    */
+    class TextureAtlas final
+    {
+    public:
+        static OTextureAtlasRef create(const Point& pageSize = {2048, 2048}, int padding = 2, int maxTextureSize = 256);
+
+        TextureAtlas(const Point& pageSize, int padding, int maxTextureSize);
+        ~TextureAtlas();
+
+        /**
+        Pack premultiplied RGBA pixels. Border pixels are extruded in the padding
+        so filtering doesn't bleed neighbours in.
+        @return The packed texture, nullptr if it's bigger than maxTextureSize
+        */
+        OTextureRef add(const std::string& name, const uint8_t* pData, const Point& size);
+        OTextureRef addFile(const std::string& filename);
+
+        /**
+        Pack all the png files of a folder, and register them as resources in the content manager.
+        @return Count of textures packed
+        */
+        size_t addFolder(const std::string& folder, const OContentManagerRef& pContentManager = nullptr, bool deepSearch = true);
+
+        OTextureRef get(const std::string& name);
+
+        /**
+        Send modified pages to the GPU. Must be called from the main thread.
+        */
+        void upload();
+
+        const Point& getPageSize() const { return m_pageSize; }
+        int getPadding() const { return m_padding; }
+        int getMaxTextureSize() const { return m_maxTextureSize; }
+        size_t getPageCount();
+        OTextureRef getPage(size_t index);
+
+    private:
+        struct Page;
+
+        std::vector<std::unique_ptr<Page>> m_pages;
+        std::unordered_map<std::string, OTextureRef> m_textures;
+        std::mutex m_mutex;
+        Point m_pageSize;
+        int m_padding;
+        int m_maxTextureSize;
+    };
+}
+
+#endif
@@ -1,12 +1,11 @@
 #ifndef THREADPOOL_H_INCLUDED
 #define THREADPOOL_H_INCLUDED
 
-// onut
-#include <onut/Dispatcher.h>
-
 // STL
 #include <atomic>
 #include <condition_variable>
+#include <deque>
+#include <functional>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -20,40 +19,121 @@ namespace onut
     class ThreadPool final
     {
     public:
+        /**
+        Counter shared by a job and its children. A job is complete when
+        itself and all the jobs that were started with it as parent are done.
+        */
+        struct Job
+        {
+            std::atomic<int> pending{1};
+            std::shared_ptr<Job> pParent;
+
+            bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+        };
+        using JobHandle = std::shared_ptr<Job>;
+
         static OThreadPoolRef create();
 
         ~ThreadPool();
 
-        template<typename ... Targs>
-        void doWork(Targs ... args)
+        /**
+        Queue fn(args...). When called from a worker, the job goes in that
+        worker's deque and idle workers will steal it.
+        @return Handle that can be passed to wait()
+        */
+        template<typename Tfn, typename ... Targs>
+        JobHandle doWork(Tfn fn, Targs ... args)
         {
-            auto pWorker = m_workers[m_nextWorker];
-            std::unique_lock<std::mutex> lock(pWorker->mutex);
-            pWorker->pDispatcher->dispatch(args ...);
-            pWorker->waitForWork.notify_one();
-            m_nextWorker = (m_nextWorker + 1) % m_workers.size();
+            return doChildWork(nullptr, [fn, args...]() mutable { fn(args...); });
         }
 
+        /**
+        Queue a job as a child of pParent. The parent won't be done until this job is done.
+        */
+        JobHandle doChildWork(const JobHandle& pParent, const std::function<void()>& fn);
+
+        /**
+        Create an empty job that can be used as a parent to group jobs.
+        Call finish() on it once all children are queued.
+        */
+        JobHandle createJob(const JobHandle& pParent = nullptr);
+        void finish(const JobHandle& pJob);
+
+        /**
+        Split [begin, end) in chunks of grain size and run fn(index) for each index across all workers.
+        The calling thread helps and returns once every index has been processed.
+        */
+        template<typename Tfn>
+        void parallel_for(size_t begin, size_t end, size_t grain, Tfn fn)
+        {
+            if (begin >= end) return;
+            if (grain == 0) grain = 1;
+
+            auto pJob = createJob();
+            auto chunkBegin = begin;
+            while (end - chunkBegin > grain)
+            {
+                auto chunkEnd = chunkBegin + grain;
+                doChildWork(pJob, [chunkBegin, chunkEnd, &fn]
+                {
+                    for (auto i = chunkBegin; i < chunkEnd; ++i) fn(i);
+                });
+                chunkBegin = chunkEnd;
+            }
+
+            // Last chunk runs on the calling thread
+            for (auto i = chunkBegin; i < end; ++i) fn(i);
+            finish(pJob);
+            wait(pJob);
+        }
+
+        /**
+        Wait for a job and all its children. The calling thread runs queued jobs while waiting.
+        */
+        void wait(const JobHandle& pJob);
+
+        /**
+        Wait for all queued jobs. The calling thread runs queued jobs while waiting.
+        Called from a job, it doesn't wait for the jobs running on the calling
+        thread, itself included. Two jobs calling it would still wait on each other.
+        */
         void wait();
 
+        size_t getWorkerCount() const;
+
     private:
+        struct Task
+        {
+            std::function<void()> fn;
+            JobHandle pJob;
+        };
+
         struct Worker
         {
             std::mutex mutex;
-            std::condition_variable waitForWork;
+            std::deque<Task> tasks;
             std::thread thread;
-            bool isRunning = true;
-            ODispatcherRef pDispatcher;
         };
         using WorkerRef = std::shared_ptr<Worker>;
         using Workers = std::vector<WorkerRef>;
 
         ThreadPool();
 
-        static void workerThread(WorkerRef pWorker);
+        void workerThread(size_t index);
+        void push(Task&& task);
+        bool pop(size_t index, Task& task);
+        bool steal(size_t index, Task& task);
+        bool runOne();
+        void run(Task& task);
 
-        Workers::size_type m_nextWorker;
         Workers m_workers;
+        std::atomic<size_t> m_nextWorker{0};
+        std::atomic<int> m_queuedCount{0};
+        std::atomic<int> m_pendingCount{0};
+        std::atomic<int> m_sleepingCount{0};
+        std::atomic<bool> m_isRunning{true};
+        std::mutex m_sleepMutex;
+        std::condition_variable m_waitForWork;
     };
 }
 
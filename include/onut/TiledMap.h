@@ -2,6 +2,7 @@
 #define TILEDMAP_H_INCLUDED
 
 // Onut
+#include <onut/BufferArena.h>
 #include <onut/Point.h>
 #include <onut/Maths.h>
 #include <onut/Resource.h>
@@ -137,8 +138,7 @@ namespace onut
 
         struct Chunk
         {
-            OVertexBufferRef pVertexBuffer;
-            OIndexBufferRef pIndexBuffer;
+            BufferArena::RangeRef pVertices; // Drawn with the renderer's quad indices
             TileSet *pTileset = nullptr;
             int tileCount = 0;
             bool isDirty = true;
@@ -1124,7 +1124,9 @@ declare namespace Renderer {
     function clearDepth();
     function getResolution(): Vector2;
     function draw(vertexCount: number);
-    function drawIndexed(indexCount: number);
+    function drawIndexed(indexCount: number, startOffset?: number, baseVertex?: number);
+    /** Counters of the last frame. sources has the same counters per subsystem (SpriteBatch, TiledMap, ...) */
+    function getFrameStats(): {drawCalls: number, vertices: number, textureBinds: number, shaderChanges: number, stateChanges: number, uniformUploads: number, uploadedBytes: number, sources: any};
 
     // 2D stuff
     function setupFor2D(transform: Matrix);
@@ -1281,6 +1283,7 @@ declare namespace SpriteBatch {
     function drawRectScaled9RepeatCenters(texture: Texture, rect: Rect, padding: Vector4, color: Color);
     function drawSprite(texture: Texture, position: Vector2, color: Color, rotation: number, scale: number, origin: Vector2);
     function drawSpriteWithUVs(texture: Texture, position: Vector2, uvs: Vector4, color: Color, rotation: number, scale: number, origin: Vector2);
+    function drawSprites(texture: Texture, xyRotationScales: Float32Array | number[], color: Color);
     function drawSpriteAnim(spriteAnim: SpriteAnimInstance, position: Vector2, color: Color, rotation: number, scale: number);
     function drawTransformedSprite(texture: Texture, transform: Matrix, color: Color, scale: Vector2, origin: Vector2);
     function drawTransformedSpriteAnim(spriteAnim: SpriteAnimInstance, transform: Matrix, color: Color, scale: Vector2);
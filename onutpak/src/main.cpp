@@ -0,0 +1,77 @@
+// Packs a folder in an .onutpak archive, usable as a ContentManager search path.
+// Usage: onutpak <folder> <output.onutpak> [--store]
+
+// Onut
+#include <onut/Archive.h>
+
+// STL
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Third party
+#if defined(WIN32)
+#include <dirent/dirent.h>
+#else
+#include <dirent.h>
+#endif
+
+// Same walk as onut::findAllFiles, so the first file found with a name is the
+// one ContentManager would have found in the folder.
+static void findAllFiles(const std::string& lookIn, std::vector<std::string>& files)
+{
+    DIR* dir = opendir(lookIn.c_str());
+    if (!dir) return;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL)
+    {
+        if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, "..")) continue;
+        if (ent->d_type & DT_DIR)
+        {
+            findAllFiles(lookIn + "/" + ent->d_name, files);
+        }
+        else
+        {
+            files.push_back(lookIn + "/" + ent->d_name);
+        }
+    }
+    closedir(dir);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        printf("Usage: onutpak <folder> <output.onutpak> [--store]\n");
+        return 1;
+    }
+
+    std::string folder = argv[1];
+    std::string output = argv[2];
+    auto compression = onut::Archive::Compression::Deflate;
+    if (argc > 3 && !strcmp(argv[3], "--store")) compression = onut::Archive::Compression::Store;
+
+    std::vector<std::string> files;
+    findAllFiles(folder, files);
+    if (files.empty())
+    {
+        printf("No files found in %s\n", folder.c_str());
+        return 1;
+    }
+
+    if (!onut::Archive::build(output, files, compression))
+    {
+        printf("Failed to write %s\n", output.c_str());
+        return 1;
+    }
+
+    auto pArchive = onut::Archive::open(output);
+    if (!pArchive)
+    {
+        printf("Failed to open %s\n", output.c_str());
+        return 1;
+    }
+    printf("%s: %d files\n", output.c_str(), static_cast<int>(pArchive->getNames().size()));
+    return 0;
+}
@@ -20,7 +20,7 @@ void initSettings()
 
 void init()
 {
-    // Start loading
+    // Start loading. This runs on the thread pool, init returns right away
     OAsync([]
     {
         OGetTexture("img2.png");
@@ -30,11 +30,9 @@ void init()
 
         // Since this is going to be very fast, force a sleep here so we can see the loading screen
         std::this_thread::sleep_for(std::chrono::seconds(5));
-
-        OSync([] // Sync back to main loop
-        {
-            loaded = true; // We could have used an std::atomic here. Its for showing you can trigger events safely from there
-        });
+    }).then([] // Continuations are called back on the main loop
+    {
+        loaded = true; // We could have used an std::atomic here. Its for showing you can trigger events safely from there
     });
 }
 
@@ -0,0 +1,368 @@
+// Onut
+#include <onut/Archive.h>
+
+// STL
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+// Third party
+#include <zlib/zlib.h>
+#if defined(WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace onut
+{
+    // Layout: header, aligned file data, table of content sorted by hash, names
+    struct Archive::Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t reserved;
+        uint64_t tocOffset;
+        uint64_t namesOffset;
+    };
+
+    struct Archive::Entry
+    {
+        uint64_t hash;
+        uint64_t offset;
+        uint32_t storedSize;
+        uint32_t size;
+        uint32_t nameOffset;
+        uint16_t nameLength;
+        Compression compression;
+        uint8_t reserved;
+    };
+
+    static const char MAGIC[4] = {'O', 'P', 'A', 'K'};
+    static const uint32_t VERSION = 1;
+    static const char* EXTENSION = ".onutpak";
+
+    static uint64_t hashName(const char* szName, size_t length)
+    {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= static_cast<uint8_t>(szName[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static std::mutex g_archivesMutex;
+    static std::unordered_map<std::string, OArchiveWeak> g_archives;
+
+    OArchiveRef Archive::open(const std::string& filename)
+    {
+        std::unique_lock<std::mutex> locker(g_archivesMutex);
+        auto& pWeakArchive = g_archives[filename];
+        auto pRet = pWeakArchive.lock();
+        if (pRet) return pRet;
+
+        pRet = OMake<Archive>();
+        if (!pRet->map(filename)) return nullptr;
+        pWeakArchive = pRet;
+        return pRet;
+    }
+
+    bool Archive::isArchive(const std::string& filename)
+    {
+        auto extLen = strlen(EXTENSION);
+        if (filename.size() <= extLen) return false;
+        auto ext = filename.substr(filename.size() - extLen);
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        return ext == EXTENSION;
+    }
+
+    OArchiveRef Archive::findArchive(const std::string& path, std::string& outName)
+    {
+        auto pos = path.find_last_of("\\/");
+        if (pos == std::string::npos) return nullptr;
+        auto archiveFilename = path.substr(0, pos);
+        if (!isArchive(archiveFilename)) return nullptr;
+        outName = path.substr(pos + 1);
+        return open(archiveFilename);
+    }
+
+    Archive::Archive()
+    {
+    }
+
+    Archive::~Archive()
+    {
+        unmap();
+    }
+
+    bool Archive::map(const std::string& filename)
+    {
+        m_filename = filename;
+#if defined(WIN32)
+        m_hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+        if (m_hFile == INVALID_HANDLE_VALUE)
+        {
+            m_hFile = nullptr;
+            return false;
+        }
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(m_hFile, &fileSize);
+        m_size = static_cast<size_t>(fileSize.QuadPart);
+        m_hMapping = CreateFileMappingA(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_hMapping) return false;
+        m_pData = static_cast<const uint8_t*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+#else
+        auto fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd == -1) return false;
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) == -1)
+        {
+            close(fd);
+            return false;
+        }
+        m_size = static_cast<size_t>(fileStat.st_size);
+        auto pMapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd); // The mapping keeps the file
+        m_pData = pMapped == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(pMapped);
+#endif
+        if (!m_pData || m_size < sizeof(Header)) return false;
+
+        auto pHeader = reinterpret_cast<const Header*>(m_pData);
+        if (memcmp(pHeader->magic, MAGIC, sizeof(MAGIC)) || pHeader->version != VERSION) return false;
+        if (pHeader->tocOffset > m_size || static_cast<uint64_t>(pHeader->entryCount) * sizeof(Entry) > m_size - pHeader->tocOffset) return false;
+        if (pHeader->namesOffset > m_size) return false;
+
+        // Check every entry once, reads can then trust them
+        auto pEntries = reinterpret_cast<const Entry*>(m_pData + pHeader->tocOffset);
+        uint64_t namesSize = m_size - pHeader->namesOffset;
+        for (uint32_t i = 0; i < pHeader->entryCount; ++i)
+        {
+            auto& entry = pEntries[i];
+            if (entry.offset > m_size || entry.storedSize > m_size - entry.offset) return false;
+            if (static_cast<uint64_t>(entry.nameOffset) + entry.nameLength > namesSize) return false;
+            switch (entry.compression)
+            {
+                case Compression::Store:
+                    if (entry.storedSize != entry.size) return false;
+                    break;
+                case Compression::Deflate:
+                    break;
+                default:
+                    return false;
+            }
+        }
+
+        m_entryCount = pHeader->entryCount;
+        m_pEntries = pEntries;
+        m_pNames = reinterpret_cast<const char*>(m_pData + pHeader->namesOffset);
+        return true;
+    }
+
+    void Archive::unmap()
+    {
+#if defined(WIN32)
+        if (m_pData) UnmapViewOfFile(m_pData);
+        if (m_hMapping) CloseHandle(m_hMapping);
+        if (m_hFile) CloseHandle(m_hFile);
+        m_hMapping = nullptr;
+        m_hFile = nullptr;
+#else
+        if (m_pData) munmap(const_cast<uint8_t*>(m_pData), m_size);
+#endif
+        m_pData = nullptr;
+        m_size = 0;
+        m_pEntries = nullptr;
+        m_entryCount = 0;
+    }
+
+    const Archive::Entry* Archive::find(const std::string& name) const
+    {
+        auto hash = hashName(name.c_str(), name.size());
+        auto pEnd = m_pEntries + m_entryCount;
+        auto pEntry = std::lower_bound(m_pEntries, pEnd, hash, [](const Entry& entry, uint64_t hash)
+        {
+            return entry.hash < hash;
+        });
+        for (; pEntry != pEnd && pEntry->hash == hash; ++pEntry)
+        {
+            if (pEntry->nameLength == name.size() && !memcmp(m_pNames + pEntry->nameOffset, name.c_str(), name.size()))
+            {
+                return pEntry;
+            }
+        }
+        return nullptr;
+    }
+
+    std::vector<std::string> Archive::getNames() const
+    {
+        std::vector<std::string> names;
+        names.reserve(m_entryCount);
+        for (uint32_t i = 0; i < m_entryCount; ++i)
+        {
+            names.emplace_back(m_pNames + m_pEntries[i].nameOffset, m_pEntries[i].nameLength);
+        }
+        return names;
+    }
+
+    bool Archive::contains(const std::string& name) const
+    {
+        return find(name) != nullptr;
+    }
+
+    size_t Archive::getSize(const std::string& name) const
+    {
+        auto pEntry = find(name);
+        return pEntry ? pEntry->size : 0;
+    }
+
+    const uint8_t* Archive::getMappedData(const std::string& name, size_t& outSize) const
+    {
+        auto pEntry = find(name);
+        if (!pEntry || pEntry->compression != Compression::Store) return nullptr;
+        outSize = pEntry->size;
+        return m_pData + pEntry->offset;
+    }
+
+    bool Archive::read(const std::string& name, std::vector<uint8_t>& out) const
+    {
+        auto pEntry = find(name);
+        if (!pEntry) return false;
+
+        out.resize(pEntry->size);
+        auto pStored = m_pData + pEntry->offset;
+        switch (pEntry->compression)
+        {
+            case Compression::Store:
+                memcpy(out.data(), pStored, pEntry->size);
+                return true;
+            case Compression::Deflate:
+            {
+                uLongf size = static_cast<uLongf>(pEntry->size);
+                auto ret = uncompress(out.data(), &size, pStored, static_cast<uLong>(pEntry->storedSize));
+                return ret == Z_OK && size == pEntry->size;
+            }
+        }
+        return false;
+    }
+
+    bool Archive::build(const std::string& filename, const std::vector<std::string>& files, Compression compression)
+    {
+        FILE* pFile = nullptr;
+#if defined(WIN32)
+        fopen_s(&pFile, filename.c_str(), "wb");
+#else
+        pFile = fopen(filename.c_str(), "wb");
+#endif
+        if (!pFile) return false;
+
+        Header header;
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.entryCount = 0;
+        header.reserved = 0;
+        fwrite(&header, sizeof(header), 1, pFile);
+
+        std::vector<Entry> entries;
+        std::string names;
+        std::unordered_set<std::string> usedNames;
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> deflated;
+        uint64_t offset = sizeof(Header);
+        static const uint8_t PADDING[ALIGNMENT] = {0};
+        for (auto& path : files)
+        {
+            auto name = path.substr(path.find_last_of("\\/") + 1);
+            if (!usedNames.insert(name).second) continue;
+
+            // Read
+            FILE* pSrc = nullptr;
+#if defined(WIN32)
+            fopen_s(&pSrc, path.c_str(), "rb");
+#else
+            pSrc = fopen(path.c_str(), "rb");
+#endif
+            if (!pSrc)
+            {
+                fclose(pFile);
+                return false;
+            }
+            fseek(pSrc, 0, SEEK_END);
+            data.resize(static_cast<size_t>(ftell(pSrc)));
+            fseek(pSrc, 0, SEEK_SET);
+            auto readSize = fread(data.data(), 1, data.size(), pSrc);
+            fclose(pSrc);
+            if (readSize != data.size())
+            {
+                fclose(pFile);
+                return false;
+            }
+
+            Entry entry;
+            entry.hash = hashName(name.c_str(), name.size());
+            entry.size = static_cast<uint32_t>(data.size());
+            entry.nameOffset = static_cast<uint32_t>(names.size());
+            entry.nameLength = static_cast<uint16_t>(name.size());
+            entry.compression = Compression::Store;
+            entry.reserved = 0;
+            names += name;
+
+            // Only keep compressed the files it's worth it for. Images and sounds usually aren't.
+            const uint8_t* pStored = data.data();
+            entry.storedSize = entry.size;
+            if (compression == Compression::Deflate && !data.empty())
+            {
+                auto deflatedSize = compressBound(static_cast<uLong>(data.size()));
+                deflated.resize(deflatedSize);
+                if (compress2(deflated.data(), &deflatedSize, data.data(), static_cast<uLong>(data.size()), Z_BEST_COMPRESSION) == Z_OK &&
+                    deflatedSize < data.size() - data.size() / 8)
+                {
+                    entry.compression = Compression::Deflate;
+                    entry.storedSize = static_cast<uint32_t>(deflatedSize);
+                    pStored = deflated.data();
+                }
+            }
+
+            // Aligned, so stored files can be used in place
+            auto padding = (ALIGNMENT - offset % ALIGNMENT) % ALIGNMENT;
+            fwrite(PADDING, 1, static_cast<size_t>(padding), pFile);
+            offset += padding;
+            entry.offset = offset;
+            fwrite(pStored, 1, entry.storedSize, pFile);
+            offset += entry.storedSize;
+
+            entries.push_back(entry);
+        }
+
+        // Table of content, sorted for binary search
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b)
+        {
+            return a.hash < b.hash;
+        });
+        auto padding = (ALIGNMENT - offset % ALIGNMENT) % ALIGNMENT;
+        fwrite(PADDING, 1, static_cast<size_t>(padding), pFile);
+        offset += padding;
+        header.entryCount = static_cast<uint32_t>(entries.size());
+        header.tocOffset = offset;
+        fwrite(entries.data(), sizeof(Entry), entries.size(), pFile);
+        offset += sizeof(Entry) * entries.size();
+        header.namesOffset = offset;
+        fwrite(names.data(), 1, names.size(), pFile);
+
+        fseek(pFile, 0, SEEK_SET);
+        fwrite(&header, sizeof(header), 1, pFile);
+        auto ret = ferror(pFile) == 0;
+        fclose(pFile);
+        return ret;
+    }
+}
@@ -0,0 +1,172 @@
+// Onut
+#include <onut/BufferArena.h>
+#include <onut/IndexBuffer.h>
+#include <onut/VertexBuffer.h>
+
+// STL
+#include <algorithm>
+#include <cassert>
+#include <map>
+
+namespace onut
+{
+    struct BufferArena::Page
+    {
+        OVertexBufferRef pVertexBuffer;
+        OIndexBufferRef pIndexBuffer;
+        std::map<uint32_t, uint32_t> freeBlocks; // Offset -> size, ordered so neighbours can be merged
+        uint32_t usedSize = 0;
+
+        bool allocate(uint32_t size, uint32_t alignment, uint32_t& outOffset)
+        {
+            for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+            {
+                auto blockOffset = it->first;
+                auto blockSize = it->second;
+                auto offset = (blockOffset + alignment - 1) / alignment * alignment;
+                auto padding = offset - blockOffset;
+                if (padding + size > blockSize) continue;
+
+                // Keep what's left on both sides
+                freeBlocks.erase(it);
+                if (padding) freeBlocks[blockOffset] = padding;
+                if (padding + size < blockSize) freeBlocks[offset + size] = blockSize - padding - size;
+
+                usedSize += size;
+                outOffset = offset;
+                return true;
+            }
+            return false;
+        }
+
+        void release(uint32_t offset, uint32_t size)
+        {
+            usedSize -= size;
+            auto it = freeBlocks.emplace(offset, size).first;
+
+            auto next = std::next(it);
+            if (next != freeBlocks.end() && offset + it->second == next->first)
+            {
+                it->second += next->second;
+                freeBlocks.erase(next);
+            }
+            if (it != freeBlocks.begin())
+            {
+                auto prev = std::prev(it);
+                if (prev->first + prev->second == it->first)
+                {
+                    prev->second += it->second;
+                    freeBlocks.erase(it);
+                }
+            }
+        }
+    };
+
+    BufferArena::Range::Range(const std::shared_ptr<Page>& pPage, uint32_t offset, uint32_t size, uint32_t elementSize)
+        : m_pPage(pPage)
+        , m_offset(offset)
+        , m_size(size)
+        , m_elementSize(elementSize)
+    {
+    }
+
+    BufferArena::Range::~Range()
+    {
+        m_pPage->release(m_offset, m_size);
+    }
+
+    void BufferArena::Range::setData(const void* pData, uint32_t size, uint32_t offset)
+    {
+        assert(offset + size <= m_size);
+        if (m_pPage->pVertexBuffer)
+        {
+            m_pPage->pVertexBuffer->setSubData(pData, m_offset + offset, size);
+        }
+        else
+        {
+            m_pPage->pIndexBuffer->setSubData(pData, m_offset + offset, size);
+        }
+    }
+
+    const OVertexBufferRef& BufferArena::Range::getVertexBuffer() const
+    {
+        return m_pPage->pVertexBuffer;
+    }
+
+    const OIndexBufferRef& BufferArena::Range::getIndexBuffer() const
+    {
+        return m_pPage->pIndexBuffer;
+    }
+
+    OBufferArenaRef BufferArena::create(Type type, uint32_t pageSize)
+    {
+        return OMake<BufferArena>(type, pageSize);
+    }
+
+    BufferArena::BufferArena(Type type, uint32_t pageSize)
+        : m_type(type)
+        , m_pageSize(pageSize)
+    {
+    }
+
+    BufferArena::~BufferArena()
+    {
+    }
+
+    BufferArena::RangeRef BufferArena::allocate(uint32_t size, uint32_t elementSize)
+    {
+        switch (m_type)
+        {
+            case Type::Index16: elementSize = sizeof(uint16_t); break;
+            case Type::Index32: elementSize = sizeof(uint32_t); break;
+            default: break;
+        }
+        assert(elementSize > 0);
+        if (size == 0 || size > m_pageSize) return nullptr;
+
+        std::shared_ptr<Page> pPage;
+        uint32_t offset = 0;
+        for (auto& pCandidate : m_pages)
+        {
+            if (pCandidate->allocate(size, elementSize, offset))
+            {
+                pPage = pCandidate;
+                break;
+            }
+        }
+
+        // Give back the pages nothing uses anymore
+        m_pages.erase(std::remove_if(m_pages.begin(), m_pages.end(), [&pPage](const std::shared_ptr<Page>& pCandidate)
+        {
+            return pCandidate != pPage && pCandidate->usedSize == 0;
+        }), m_pages.end());
+
+        if (!pPage)
+        {
+            pPage = std::make_shared<Page>();
+            if (m_type == Type::Vertex)
+            {
+                pPage->pVertexBuffer = OVertexBuffer::createStatic(nullptr, m_pageSize);
+            }
+            else
+            {
+                pPage->pIndexBuffer = OIndexBuffer::createStatic(nullptr, m_pageSize, m_type == Type::Index16 ? 16 : 32);
+            }
+            pPage->freeBlocks[0] = m_pageSize;
+            pPage->allocate(size, elementSize, offset);
+            m_pages.push_back(pPage);
+        }
+
+        return std::make_shared<Range>(pPage, offset, size, elementSize);
+    }
+
+    uint32_t BufferArena::getUsedSize() const
+    {
+        uint32_t usedSize = 0;
+        for (auto& pPage : m_pages)
+        {
+            usedSize += pPage->usedSize;
+        }
+        return usedSize;
+    }
+}
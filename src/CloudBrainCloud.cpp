@@ -280,7 +280,7 @@ namespace onut
             {
                 if (!event.json["data"].isNull() && event.json["data"]["achievements"].isArray())
                 {
-                    OAsync([event, callback]
+                    OThread([event, callback]
                     {
                         Achievements achievements;
                         auto& jsonAchivements = event.json["data"]["achievements"];
@@ -1,10 +1,14 @@
 // Onut
+#include <onut/Archive.h>
 #include <onut/ContentManager.h>
 #include <onut/Files.h>
 #include <onut/Resource.h>
 
 // STL
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <thread>
 
 OContentManagerRef oContentManager;
 
@@ -34,6 +38,8 @@ namespace onut
     {
         std::unique_lock<std::mutex> locker(m_mutex);
         m_searchPaths.clear();
+        m_fileIndices.clear();
+        m_archives.clear();
     }
 
     const ContentManager::SearchPaths& ContentManager::getSearchPaths() const
@@ -49,17 +55,65 @@ namespace onut
 
     std::string ContentManager::findResourceFile(const std::string& name)
     {
-        std::string filename;
         std::unique_lock<std::mutex> locker(m_mutex);
         for (auto& path : m_searchPaths)
         {
-            filename = findFile(name, path, true);
-            if (!filename.empty())
+            auto& fileIndex = getFileIndex(path);
+            auto it = fileIndex.find(name);
+            if (it != fileIndex.end())
             {
-                break;
+                return it->second;
+            }
+        }
+        return "";
+    }
+
+    void ContentManager::invalidateFileIndex()
+    {
+        std::unique_lock<std::mutex> locker(m_mutex);
+        m_fileIndices.clear();
+    }
+
+    const ContentManager::FileIndex& ContentManager::getFileIndex(const std::string& path)
+    {
+        auto it = m_fileIndices.find(path);
+        if (it != m_fileIndices.end()) return it->second;
+
+        auto& fileIndex = m_fileIndices[path];
+
+        // Archive files are read through paths like "assets.onutpak/name"
+        if (Archive::isArchive(path))
+        {
+            auto pArchive = Archive::open(path);
+            if (!pArchive) return fileIndex;
+            m_archives[path] = pArchive;
+            auto names = pArchive->getNames();
+            fileIndex.reserve(names.size());
+            for (auto& name : names)
+            {
+                fileIndex[name] = path + "/" + name;
             }
+            return fileIndex;
+        }
+
+        // Same order as findFile, the first file found with a name wins
+        auto filenames = findAllFiles(path, "*", true);
+        fileIndex.reserve(filenames.size());
+        for (auto& filename : filenames)
+        {
+            fileIndex.emplace(getFilename(filename), std::move(filename));
         }
-        return filename;
+        return fileIndex;
+    }
+
+    void ContentManager::setTextureAtlas(const OTextureAtlasRef& pTextureAtlas)
+    {
+        m_pTextureAtlas = pTextureAtlas;
+    }
+
+    const OTextureAtlasRef& ContentManager::getTextureAtlas() const
+    {
+        return m_pTextureAtlas;
     }
 
     void ContentManager::addResource(const std::string& name, const OResourceRef& pResource)
@@ -125,4 +179,192 @@ namespace onut
         }
         return nullptr;
     }
+
+    ContentManager::LoadRef ContentManager::queueLoad(const LoadRef& pLoad)
+    {
+        {
+            std::unique_lock<std::mutex> locker(m_mutex);
+            auto it = m_loads.find(pLoad->name);
+            if (it != m_loads.end() && !it->second->isCancelled())
+            {
+                auto& pInFlight = it->second;
+                pInFlight->priority = std::max(pInFlight->priority, pLoad->priority);
+                return pInFlight;
+            }
+            pLoad->order = m_loadCount++;
+            m_loads[pLoad->name] = pLoad;
+            m_decodeQueue.push_back(pLoad);
+        }
+
+        // Each job decodes whatever has the highest priority when it runs, not necessarily this one
+        auto pThis = shared_from_this();
+        OWork([pThis] { pThis->decodeNext(); });
+        return pLoad;
+    }
+
+    ContentManager::LoadRef ContentManager::claimLoad(const LoadRef& pLoad)
+    {
+        // Checked under the same lock as the loads, a load finishing adds its resource before leaving m_loads
+        std::unique_lock<std::mutex> locker(m_mutex);
+        auto itResource = m_resources.find(pLoad->name);
+        if (itResource != m_resources.end() && itResource->second) return nullptr;
+        auto it = m_loads.find(pLoad->name);
+        if (it != m_loads.end() && !it->second->isCancelled()) return it->second;
+        pLoad->order = m_loadCount++;
+        m_loads[pLoad->name] = pLoad;
+        return pLoad;
+    }
+
+    void ContentManager::removeLoad(const LoadRef& pLoad)
+    {
+        std::unique_lock<std::mutex> locker(m_mutex);
+        auto it = m_loads.find(pLoad->name);
+        if (it != m_loads.end() && it->second == pLoad) m_loads.erase(it);
+    }
+
+    ContentManager::LoadRef ContentManager::popHighestPriority(std::vector<LoadRef>& queue)
+    {
+        auto it = std::max_element(queue.begin(), queue.end(), [](const LoadRef& pA, const LoadRef& pB)
+        {
+            if (pA->priority != pB->priority) return pA->priority < pB->priority;
+            return pA->order > pB->order;
+        });
+        auto pLoad = *it;
+        *it = queue.back();
+        queue.pop_back();
+        return pLoad;
+    }
+
+    void ContentManager::decodeNext()
+    {
+        LoadRef pLoad;
+        {
+            std::unique_lock<std::mutex> locker(m_mutex);
+            if (m_decodeQueue.empty()) return;
+            pLoad = popHighestPriority(m_decodeQueue);
+        }
+        decode(pLoad);
+    }
+
+    void ContentManager::waitForLoad(const LoadRef& pLoad)
+    {
+        // Not started yet, decode it here. Waiting for a pool worker could
+        // deadlock if the workers are all waiting on loads like this one.
+        bool isQueued = false;
+        {
+            std::unique_lock<std::mutex> locker(m_mutex);
+            auto it = std::find(m_decodeQueue.begin(), m_decodeQueue.end(), pLoad);
+            if (it != m_decodeQueue.end())
+            {
+                m_decodeQueue.erase(it);
+                isQueued = true;
+            }
+        }
+        if (isQueued) decode(pLoad);
+
+        // What's left is another thread finishing the decode, and the creation on the main thread
+        while (!pLoad->isDone())
+        {
+            if (oDispatcher && oDispatcher->getThreadId() == std::this_thread::get_id())
+            {
+                oDispatcher->processQueue();
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void ContentManager::decode(const LoadRef& pLoad)
+    {
+        if (!pLoad->isCancelled())
+        {
+            pLoad->filename = findResourceFile(getFilename(pLoad->name));
+            pLoad->isDecoded = !pLoad->filename.empty() && pLoad->decode(shared_from_this());
+        }
+
+        // Cancelled and failed loads go through the main thread too, that's where they are resolved
+        {
+            std::unique_lock<std::mutex> locker(m_mutex);
+            m_createQueue.push_back(pLoad);
+            if (m_isProcessLoadsQueued) return;
+            m_isProcessLoadsQueued = true;
+        }
+        auto pThis = shared_from_this();
+        OSync([pThis] { pThis->processLoads(); });
+    }
+
+    void ContentManager::processLoads()
+    {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        while (true)
+        {
+            LoadRef pLoad;
+            {
+                std::unique_lock<std::mutex> locker(m_mutex);
+                if (m_createQueue.empty())
+                {
+                    m_isProcessLoadsQueued = false;
+                    return;
+                }
+                pLoad = popHighestPriority(m_createQueue);
+            }
+            finishLoad(pLoad);
+
+            // Over budget, the rest waits for the next frame
+            if (std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count() >= m_uploadBudget)
+            {
+                break;
+            }
+        }
+        auto pThis = shared_from_this();
+        OSync([pThis] { pThis->processLoads(); });
+    }
+
+    void ContentManager::finishLoad(const LoadRef& pLoad)
+    {
+        OResourceRef pResource;
+        if (pLoad->isDecoded && !pLoad->isCancelled())
+        {
+            // It might have been loaded synchronously in the meantime
+            pResource = getResource(pLoad->name);
+            if (!pResource)
+            {
+                pResource = pLoad->create(shared_from_this());
+                if (pResource)
+                {
+                    pResource->setName(pLoad->name);
+                    pResource->setFilename(pLoad->filename);
+                    addResource(pLoad->name, pResource);
+                }
+            }
+        }
+
+        removeLoad(pLoad);
+        pLoad->resolve(pResource);
+    }
+
+    void ContentManager::setLoadPriority(const std::string& name, int priority)
+    {
+        std::unique_lock<std::mutex> locker(m_mutex);
+        auto it = m_loads.find(name);
+        if (it != m_loads.end()) it->second->priority = priority;
+    }
+
+    size_t ContentManager::getLoadingCount()
+    {
+        std::unique_lock<std::mutex> locker(m_mutex);
+        return m_loads.size();
+    }
+
+    void ContentManager::setUploadBudget(double seconds)
+    {
+        m_uploadBudget = seconds;
+    }
+
+    double ContentManager::getUploadBudget() const
+    {
+        return m_uploadBudget;
+    }
 }
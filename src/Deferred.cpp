@@ -157,7 +157,9 @@ namespace onut
                pMesh->pIndexBuffer,
                pMesh->pVertexBuffer,
                pMesh->elementCount,
-               transform
+               transform,
+               pMesh->startIndex,
+               pMesh->baseVertex
             });
         }
     }
@@ -175,7 +177,9 @@ namespace onut
             pMesh->pIndexBuffer,
             pMesh->pVertexBuffer,
             pMesh->elementCount,
-            transform
+            transform,
+            pMesh->startIndex,
+            pMesh->baseVertex
         });
     }
 
@@ -211,7 +215,9 @@ namespace onut
                pMesh->pIndexBuffer,
                pMesh->pVertexBuffer,
                pMesh->elementCount,
-               transform
+               transform,
+               pMesh->startIndex,
+               pMesh->baseVertex
             });
         }
     }
@@ -229,7 +235,9 @@ namespace onut
             pMesh->pIndexBuffer,
             pMesh->pVertexBuffer,
             pMesh->elementCount,
-            transform
+            transform,
+            pMesh->startIndex,
+            pMesh->baseVertex
         });
     }
 
@@ -266,7 +274,9 @@ namespace onut
                    pMesh->pIndexBuffer,
                    pMesh->pVertexBuffer,
                    pMesh->elementCount,
-                   transform
+                   transform,
+                   pMesh->startIndex,
+                   pMesh->baseVertex
                 }
             });
         }
@@ -286,7 +296,9 @@ namespace onut
                 pMesh->pIndexBuffer,
                 pMesh->pVertexBuffer,
                 pMesh->elementCount,
-                transform
+                transform,
+                pMesh->startIndex,
+                pMesh->baseVertex
             }
         });
     }
@@ -362,7 +374,7 @@ namespace onut
             rs.vertexBuffer = solid.pVertexBuffer;
             rs.indexBuffer = solid.pIndexBuffer;
             rs.world = solid.transform;
-            pRenderer->drawIndexed(solid.elementCount);
+            pRenderer->drawIndexed(solid.elementCount, solid.startIndex, solid.baseVertex);
         }
         for (const auto& callback : m_solidCallbacks) callback();
 
@@ -376,7 +388,7 @@ namespace onut
             rs.vertexBuffer = alphaTest.pVertexBuffer;
             rs.indexBuffer = alphaTest.pIndexBuffer;
             rs.world = alphaTest.transform;
-            pRenderer->drawIndexed(alphaTest.elementCount);
+            pRenderer->drawIndexed(alphaTest.elementCount, alphaTest.startIndex, alphaTest.baseVertex);
         }
         for (const auto& callback : m_alphaTestCallbacks) callback();
 
@@ -454,7 +466,7 @@ namespace onut
             rs.vertexBuffer = transparent.mesh.pVertexBuffer;
             rs.indexBuffer = transparent.mesh.pIndexBuffer;
             rs.world = transparent.mesh.transform;
-            pRenderer->drawIndexed(transparent.mesh.elementCount);
+            pRenderer->drawIndexed(transparent.mesh.elementCount, transparent.mesh.startIndex, transparent.mesh.baseVertex);
         }
         for (const auto& callback : m_transparentCallbacks) callback();
 
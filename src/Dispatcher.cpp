@@ -1,10 +1,59 @@
 // Onut
 #include <onut/Dispatcher.h>
 
+// STL
+#include <chrono>
+
 ODispatcherRef oDispatcher;
 
 namespace onut
 {
+    // Nodes are recycled instead of going back to the heap. The consumer pushes
+    // used nodes on a shared stack and producers take the whole stack at once
+    // into their own thread local list. Nothing ever pops a single node from a
+    // shared stack, so there is no ABA problem.
+    std::atomic<Dispatcher::Node*> Dispatcher::s_pFreedNodes{nullptr};
+
+    Dispatcher::Node* Dispatcher::allocNode()
+    {
+        struct ThreadCache
+        {
+            Node* pHead = nullptr;
+            ~ThreadCache()
+            {
+                while (pHead)
+                {
+                    auto pNext = pHead->pNext;
+                    delete pHead;
+                    pHead = pNext;
+                }
+            }
+        };
+        static thread_local ThreadCache cache;
+
+        if (!cache.pHead)
+        {
+            cache.pHead = s_pFreedNodes.exchange(nullptr, std::memory_order_acquire);
+        }
+        if (cache.pHead)
+        {
+            auto pNode = cache.pHead;
+            cache.pHead = pNode->pNext;
+            pNode->pNext = nullptr;
+            return pNode;
+        }
+        return new Node();
+    }
+
+    void Dispatcher::freeNode(Node* pNode)
+    {
+        auto pHead = s_pFreedNodes.load(std::memory_order_relaxed);
+        do
+        {
+            pNode->pNext = pHead;
+        } while (!s_pFreedNodes.compare_exchange_weak(pHead, pNode, std::memory_order_release, std::memory_order_relaxed));
+    }
+
     ODispatcherRef Dispatcher::create()
     {
         return OMake<Dispatcher>();
@@ -15,27 +64,122 @@ namespace onut
         m_threadId = std::this_thread::get_id();
     }
 
+    Dispatcher::~Dispatcher()
+    {
+        for (auto pNode : {m_pHead.exchange(nullptr), m_pLeftOver})
+        {
+            while (pNode)
+            {
+                auto pNext = pNode->pNext;
+                pNode->destroy(pNode);
+                delete pNode;
+                pNode = pNext;
+            }
+        }
+    }
+
+    void Dispatcher::push(Node* pNode)
+    {
+        m_size.fetch_add(1, std::memory_order_relaxed);
+        auto pHead = m_pHead.load(std::memory_order_relaxed);
+        do
+        {
+            pNode->pNext = pHead;
+        } while (!m_pHead.compare_exchange_weak(pHead, pNode, std::memory_order_release, std::memory_order_relaxed));
+    }
+
     void Dispatcher::processQueue()
     {
         m_threadId = std::this_thread::get_id();
-        m_mutex.lock();
-        while (!m_callbackQueue.empty())
-        {
-            auto callback = m_callbackQueue.front();
-            m_callbackQueue.pop();
-            m_mutex.unlock();
-            callback();
-            m_mutex.lock();
+
+        // Take the whole batch, it is in LIFO order so reverse it
+        auto pNode = m_pHead.exchange(nullptr, std::memory_order_acquire);
+        Node* pFirst = nullptr;
+        size_t count = 0;
+        while (pNode)
+        {
+            auto pNext = pNode->pNext;
+            pNode->pNext = pFirst;
+            pFirst = pNode;
+            pNode = pNext;
+            ++count;
+        }
+
+        // What's left of a batch that threw was queued before, it goes first
+        if (m_pLeftOver)
+        {
+            auto pLast = m_pLeftOver;
+            ++count;
+            while (pLast->pNext)
+            {
+                pLast = pLast->pNext;
+                ++count;
+            }
+            pLast->pNext = pFirst;
+            pFirst = m_pLeftOver;
+            m_pLeftOver = nullptr;
+        }
+
+        if (!pFirst)
+        {
+            m_lastDrainCount = 0;
+            m_lastDrainTime = 0.0;
+            return;
         }
-        m_mutex.unlock();
+        m_size.fetch_sub(count, std::memory_order_relaxed);
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        pNode = pFirst;
+        while (pNode)
+        {
+            auto pNext = pNode->pNext;
+            try
+            {
+                pNode->invoke(pNode);
+            }
+            catch (...)
+            {
+                pNode->destroy(pNode);
+                freeNode(pNode);
+
+                // Keep the rest for next time instead of leaking it. A nested
+                // processQueue() that threw may have left newer callbacks already.
+                if (pNext)
+                {
+                    auto pLast = pNext;
+                    size_t leftOverCount = 1;
+                    while (pLast->pNext)
+                    {
+                        pLast = pLast->pNext;
+                        ++leftOverCount;
+                    }
+                    pLast->pNext = m_pLeftOver;
+                    m_pLeftOver = pNext;
+                    m_size.fetch_add(leftOverCount, std::memory_order_relaxed);
+                }
+                throw;
+            }
+            pNode->destroy(pNode);
+            freeNode(pNode);
+            pNode = pNext;
+        }
+        m_lastDrainCount = count;
+        m_lastDrainTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+    }
+
+    size_t Dispatcher::size() const
+    {
+        return m_size.load(std::memory_order_relaxed);
+    }
+
+    size_t Dispatcher::getLastDrainCount() const
+    {
+        return m_lastDrainCount;
     }
 
-    size_t Dispatcher::size()
+    double Dispatcher::getLastDrainTime() const
     {
-        m_mutex.lock();
-        auto ret = m_callbackQueue.size();
-        m_mutex.unlock();
-        return ret;
+        return m_lastDrainTime;
     }
 
     std::thread::id Dispatcher::getThreadId() const
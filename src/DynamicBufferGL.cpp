@@ -0,0 +1,97 @@
+// Private
+#include "DynamicBufferGL.h"
+#include "RendererGL.h"
+
+// STL
+#include <cassert>
+
+namespace onut
+{
+    bool DynamicBufferGL::hasPersistentMapping()
+    {
+#if defined(GL_MAP_PERSISTENT_BIT)
+        static int hasPersistentMapping = -1;
+        if (hasPersistentMapping == -1)
+        {
+            hasPersistentMapping = RendererGL::hasExtension("GL_ARB_buffer_storage") ? 1 : 0;
+        }
+        return hasPersistentMapping == 1;
+#else
+        return false;
+#endif
+    }
+
+    DynamicBufferGL::DynamicBufferGL(GLenum target, uint32_t size)
+        : m_target(target)
+        , m_size(size)
+    {
+        glGenBuffers(1, &m_handle);
+        glBindBuffer(m_target, m_handle);
+#if defined(GL_MAP_PERSISTENT_BIT)
+        if (hasPersistentMapping())
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(m_target, (GLsizeiptr)m_size * SEGMENT_COUNT, nullptr, flags);
+            m_pPersistentData = (uint8_t*)glMapBufferRange(m_target, 0, (GLsizeiptr)m_size * SEGMENT_COUNT, flags);
+            assert(m_pPersistentData);
+            return;
+        }
+#endif
+        glBufferData(m_target, m_size, nullptr, GL_STREAM_DRAW);
+    }
+
+    DynamicBufferGL::~DynamicBufferGL()
+    {
+        for (auto& fence : m_fences)
+        {
+            if (fence) glDeleteSync(fence);
+        }
+        glDeleteBuffers(1, &m_handle); // Unmaps it
+    }
+
+    void* DynamicBufferGL::map()
+    {
+        assert(!m_isMapped);
+        m_isMapped = true;
+
+        if (m_pPersistentData)
+        {
+            // Draws reading the current segment are all issued by now
+            auto& fence = m_fences[m_segment];
+            if (fence) glDeleteSync(fence);
+            fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+            // Move to the next one, making sure the GPU is done with it
+            m_segment = (m_segment + 1) % SEGMENT_COUNT;
+            auto& nextFence = m_fences[m_segment];
+            if (nextFence)
+            {
+                while (glClientWaitSync(nextFence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+                glDeleteSync(nextFence);
+                nextFence = nullptr;
+            }
+            return m_pPersistentData + m_segment * m_size;
+        }
+
+        // Orphan, the driver gives us fresh memory while the GPU keeps reading the old one
+        glBindBuffer(m_target, m_handle);
+        glBufferData(m_target, m_size, nullptr, GL_STREAM_DRAW);
+        return glMapBuffer(m_target, GL_WRITE_ONLY);
+    }
+
+    void DynamicBufferGL::unmap()
+    {
+        assert(m_isMapped);
+        m_isMapped = false;
+
+        if (m_pPersistentData)
+        {
+            // Coherent mapping, nothing to flush
+            m_offset = m_segment * m_size;
+            return;
+        }
+
+        glBindBuffer(m_target, m_handle);
+        glUnmapBuffer(m_target);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef DYNAMICBUFFERGL_H_INCLUDED
+#define DYNAMICBUFFERGL_H_INCLUDED
+
+// STL
+#include <cstdint>
+
+// Third party
+#include "gl_includes.h"
+
+namespace onut
+{
+    /**
+    GL buffer rewritten by the CPU on every map()/unmap(), for dynamic vertex
+    and index buffers. With ARB_buffer_storage it's mapped once, persistently,
+    and split in segments written in turn. A fence keeps a segment from being
+    written again before the GPU is done reading it. Otherwise the buffer is
+    orphaned and mapped on each map(), so the driver never waits on the GPU.
+    Draws must read from getOffset(), where the last unmapped data starts.
+    */
+    class DynamicBufferGL final
+    {
+    public:
+        DynamicBufferGL(GLenum target, uint32_t size);
+        ~DynamicBufferGL();
+
+        void* map();
+        void unmap();
+
+        GLuint getHandle() const { return m_handle; }
+        uint32_t getOffset() const { return m_offset; }
+
+    private:
+        static const int SEGMENT_COUNT = 3;
+
+        static bool hasPersistentMapping();
+
+        GLenum m_target;
+        GLuint m_handle = 0;
+        uint32_t m_size;
+        uint32_t m_offset = 0;
+        uint8_t* m_pPersistentData = nullptr;
+        GLsync m_fences[SEGMENT_COUNT] = {};
+        int m_segment = 0;
+        bool m_isMapped = false;
+    };
+};
+
+#endif
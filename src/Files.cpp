@@ -1,4 +1,5 @@
 // Onut
+#include <onut/Archive.h>
 #include <onut/Files.h>
 #include <onut/Settings.h>
 #include <onut/Strings.h>
@@ -200,11 +201,46 @@ namespace onut
 
     std::vector<uint8_t> getFileData(const std::string& filename)
     {
+        std::string name;
+        auto pArchive = Archive::findArchive(filename, name);
+        if (pArchive)
+        {
+            std::vector<uint8_t> data;
+            pArchive->read(name, data);
+            return std::move(data);
+        }
+
         std::ifstream file(filename, std::ios::binary);
         std::vector<uint8_t> data = { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
         return std::move(data);
     }
 
+    bool readFile(const std::string& filename, const std::function<void(const uint8_t* pData, size_t size)>& callback)
+    {
+        std::vector<uint8_t> data;
+        std::string name;
+        auto pArchive = Archive::findArchive(filename, name);
+        if (pArchive)
+        {
+            size_t size = 0;
+            auto pMappedData = pArchive->getMappedData(name, size);
+            if (pMappedData)
+            {
+                callback(pMappedData, size);
+                return true;
+            }
+            if (!pArchive->read(name, data)) return false;
+        }
+        else
+        {
+            std::ifstream file(filename, std::ios::binary);
+            if (!file.is_open()) return false;
+            data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+        callback(data.data(), data.size());
+        return true;
+    }
+
     std::string getFileString(const std::string& filename)
     {
         auto data = getFileData(filename);
@@ -263,6 +299,10 @@ namespace onut
 #if defined(WIN32)
     bool fileExists(const std::string& filename)
     {
+        std::string name;
+        auto pArchive = Archive::findArchive(filename, name);
+        if (pArchive) return pArchive->contains(name);
+
         WIN32_FIND_DATAA FindFileData;
         HANDLE handle = FindFirstFileA(filename.c_str(), &FindFileData);
         bool found = handle != INVALID_HANDLE_VALUE;
@@ -386,6 +426,10 @@ namespace onut
 #else
     bool fileExists(const std::string& filename)
     {
+        std::string name;
+        auto pArchive = Archive::findArchive(filename, name);
+        if (pArchive) return pArchive->contains(name);
+
         int res = access(filename.c_str(), R_OK);
         if (res < 0) {
             return false;
@@ -13,7 +13,6 @@
 // STL
 #include <cassert>
 #include <sstream>
-#include <fstream>
 
 namespace onut
 {
@@ -86,10 +85,9 @@ namespace onut
         // Load config json.font (optional)
         if (onut::getExtension(assetFilename) == "FONT")
         {
-            std::ifstream fic(assetFilename);
             Json::Value json;
-            fic >> json;
-            fic.close();
+            Json::Reader reader;
+            reader.parse(onut::getFileString(assetFilename), json);
 
             if (json["name"].isString())
             {
@@ -106,10 +104,10 @@ namespace onut
             }
         }
 
-        std::ifstream in(assetFilename);
-        if (in.fail()) 
+        if (!onut::fileExists(assetFilename))
             OLogE("Failed to open " + assetFilename);
-        assert(!in.fail());
+        assert(onut::fileExists(assetFilename));
+        std::istringstream in(onut::getFileString(assetFilename));
 
         auto pFont = std::make_shared<OFont>();
 
@@ -169,7 +167,6 @@ namespace onut
 
             getline(in, line);
         }
-        in.close();
 
         return pFont;
     }
@@ -53,7 +53,7 @@ namespace onut
     void Http::postAsync(const std::string& url, const Body& body, const PostCallback& onSuccess, const ErrorCallback& onError)
     {
         auto pThis = OThis;
-        OAsync([url, body, onSuccess, onError, pThis]
+        OThread([url, body, onSuccess, onError, pThis]
         {
             auto ret = pThis->post(url, body, [onError](long errCode, std::string message)
             {
@@ -106,7 +106,7 @@ namespace onut
     void Http::getAsync(const std::string& url, const Arguments& arguments, const GetCallback& onSuccess, const ErrorCallback& onError)
     {
         auto pThis = OThis;
-        OAsync([url, arguments, onSuccess, onError, pThis]
+        OThread([url, arguments, onSuccess, onError, pThis]
         {
             auto ret = pThis->get(url, arguments, [onError](long errCode, std::string message)
             {
@@ -136,7 +136,7 @@ namespace onut
     void Http::getStringAsync(const std::string& url, const Arguments& arguments, const GetStringCallback& onSuccess, const ErrorCallback& onError)
     {
         auto pThis = OThis;
-        OAsync([url, arguments, onSuccess, onError, pThis]
+        OThread([url, arguments, onSuccess, onError, pThis]
         {
             auto ret = pThis->getString(url, arguments, [onError](long errCode, std::string message)
             {
@@ -176,7 +176,7 @@ OTextureRef OHTTPGetTexture(const std::string& url, const onut::Http::Arguments&
 
 void OHTTPGetTextureAsync(const std::string& url, const onut::Http::Arguments& arguments, const onut::Http::TextureCallback& onSuccess, const onut::Http::ErrorCallback& onError)
 {
-    OAsync([url, arguments, onSuccess, onError]
+    OThread([url, arguments, onSuccess, onError]
     {
         auto ret = OHTTPGetTexture(url, arguments, [onError](long errCode, std::string message)
         {
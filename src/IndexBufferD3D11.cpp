@@ -76,7 +76,8 @@ namespace onut
 
             // Set up the description of the static vertex buffer.
             D3D11_BUFFER_DESC indexBufferDesc;
-            indexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+            // Without initial data, the buffer is filled later with setSubData
+            indexBufferDesc.Usage = pVertexData ? D3D11_USAGE_IMMUTABLE : D3D11_USAGE_DEFAULT;
             indexBufferDesc.ByteWidth = static_cast<UINT>(size);
             indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
             indexBufferDesc.CPUAccessFlags = 0;
@@ -89,7 +90,8 @@ namespace onut
             indexData.SysMemPitch = 0;
             indexData.SysMemSlicePitch = 0;
 
-            auto ret = pDevice->CreateBuffer(&indexBufferDesc, &indexData, &m_pBuffer);
+            auto ret = pDevice->CreateBuffer(&indexBufferDesc, pVertexData ? &indexData : nullptr, &m_pBuffer);
+            oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
             if (ret != S_OK)
                 OLogE("Failed to create index buffer");
             assert(ret == S_OK);
@@ -104,6 +106,19 @@ namespace onut
         }
     }
 
+    void IndexBufferD3D11::setSubData(const void* pIndexData, uint32_t offset, uint32_t size)
+    {
+        if (m_isDynamic)
+            OLogE("Cannot update part of a dynamic index buffer");
+        assert(!m_isDynamic && offset + size <= m_size);
+        if (m_isDynamic) return;
+
+        auto pRendererD3D11 = std::dynamic_pointer_cast<ORendererD3D11>(oRenderer);
+        D3D11_BOX box = {offset, 0, 0, offset + size, 1, 1};
+        pRendererD3D11->getDeviceContext()->UpdateSubresource(m_pBuffer, 0, &box, pIndexData, 0, 0);
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
+    }
+
     void* IndexBufferD3D11::map()
     {
         if (!m_isDynamic)
@@ -127,6 +142,7 @@ namespace onut
         {
             auto pRendererD3D11 = std::dynamic_pointer_cast<ORendererD3D11>(oRenderer);
             pRendererD3D11->getDeviceContext()->Unmap(m_pBuffer, 0);
+            oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
         }
     }
 
@@ -2,11 +2,14 @@
 #include <onut/Log.h>
 
 // Private
+#include "DynamicBufferGL.h"
 #include "IndexBufferGL.h"
 #include "RendererGL.h"
 
 // STL
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 namespace onut
 {
@@ -21,14 +24,8 @@ namespace onut
     {
         auto pRet = OMake<IndexBufferGL>();
         
-        GLuint handle;
-        glGenBuffers(1, &handle);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, handle);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
-        
-        pRet->m_handle = handle;
+        pRet->m_pDynamicBuffer = std::make_unique<DynamicBufferGL>(GL_ELEMENT_ARRAY_BUFFER, size);
         pRet->m_size = size;
-        pRet->m_pData = new uint8_t[size];
         pRet->m_isDynamic = true;
         
         oRenderer->renderStates.indexBuffer.forceDirty();
@@ -46,10 +43,6 @@ namespace onut
         {
             glDeleteBuffers(1, &m_handle);
         }
-        if (m_pData)
-        {
-            delete [] m_pData;
-        }
     }
 
     void IndexBufferGL::setData(const void* pIndexData, uint32_t size, int typeSize)
@@ -70,10 +63,25 @@ namespace onut
         }
         else
         {
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_handle);
-            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, size, pIndexData);
+            size = std::min(size, m_size);
+            memcpy(m_pDynamicBuffer->map(), pIndexData, size);
+            m_pDynamicBuffer->unmap();
         }
         oRenderer->renderStates.indexBuffer.forceDirty();
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
+    }
+
+    void IndexBufferGL::setSubData(const void* pIndexData, uint32_t offset, uint32_t size)
+    {
+        if (m_isDynamic)
+            OLogE("Cannot update part of a dynamic index buffer");
+        assert(!m_isDynamic && offset + size <= m_size);
+        if (m_isDynamic) return;
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_handle);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, size, pIndexData);
+        oRenderer->renderStates.indexBuffer.forceDirty();
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
     }
 
     void* IndexBufferGL::map()
@@ -83,7 +91,8 @@ namespace onut
         assert(m_isDynamic);
         if (m_isDynamic)
         {
-            return m_pData;
+            oRenderer->renderStates.indexBuffer.forceDirty();
+            return m_pDynamicBuffer->map();
         }
         return nullptr;
     }
@@ -95,9 +104,9 @@ namespace onut
         assert(m_isDynamic);
         if (m_isDynamic)
         {
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_handle);
-            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, size, m_pData);
+            m_pDynamicBuffer->unmap();
             oRenderer->renderStates.indexBuffer.forceDirty();
+            oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
         }
     }
 
@@ -108,9 +117,16 @@ namespace onut
 
     GLuint IndexBufferGL::getHandle() const
     {
+        if (m_pDynamicBuffer) return m_pDynamicBuffer->getHandle();
         return m_handle;
     }
 
+    uint32_t IndexBufferGL::getOffset() const
+    {
+        if (m_pDynamicBuffer) return m_pDynamicBuffer->getOffset();
+        return 0;
+    }
+
     int IndexBufferGL::getTypeSize() const
     {
         return m_typeSize;
@@ -4,11 +4,15 @@
 // Onut
 #include <onut/IndexBuffer.h>
 
+// STL
+#include <memory>
+
 // Third party
 #include "gl_includes.h"
 
 // Forward
 #include <onut/ForwardDeclaration.h>
+OForwardDeclare(DynamicBufferGL)
 OForwardDeclare(IndexBufferGL)
 
 namespace onut
@@ -20,11 +24,13 @@ namespace onut
         ~IndexBufferGL();
 
         void setData(const void* pIndexData, uint32_t size, int typeSize = 16) override;
+        void setSubData(const void* pIndexData, uint32_t offset, uint32_t size) override;
         void* map() override;
         void unmap(uint32_t size) override;
         uint32_t size() override;
         
         GLuint getHandle() const;
+        uint32_t getOffset() const; // Bytes from the start of the handle
         int getTypeSize() const;
 
     private:
@@ -33,7 +39,7 @@ namespace onut
         uint32_t m_size = 0;
         bool m_isDynamic = false;
         GLuint m_handle = 0;
-        uint8_t* m_pData = nullptr;
+        std::unique_ptr<DynamicBufferGL> m_pDynamicBuffer;
         int m_typeSize = 16;
     };
 };
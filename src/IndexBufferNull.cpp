@@ -0,0 +1,92 @@
+// Onut
+#include <onut/Log.h>
+#include <onut/Renderer.h>
+
+// Private
+#include "IndexBufferNull.h"
+
+// STL
+#include <cassert>
+#include <cstring>
+
+namespace onut
+{
+    OIndexBufferRef IndexBuffer::createStatic(const void* pIndexData, uint32_t size, int typeSize)
+    {
+        auto pRet = OMake<IndexBufferNull>();
+        pRet->setData(pIndexData, size, typeSize);
+        return pRet;
+    }
+
+    OIndexBufferRef IndexBuffer::createDynamic(uint32_t size)
+    {
+        auto pRet = OMake<IndexBufferNull>();
+        pRet->m_data.resize(size);
+        pRet->m_isDynamic = true;
+        return pRet;
+    }
+
+    IndexBufferNull::IndexBufferNull()
+    {
+    }
+
+    IndexBufferNull::~IndexBufferNull()
+    {
+    }
+
+    void IndexBufferNull::setData(const void* pIndexData, uint32_t size, int typeSize)
+    {
+        m_typeSize = typeSize;
+        if (!m_isDynamic)
+        {
+            m_data.resize(size);
+        }
+        assert(size <= m_data.size());
+        if (pIndexData) memcpy(m_data.data(), pIndexData, size);
+        oRenderer->renderStates.indexBuffer.forceDirty();
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
+    }
+
+    void IndexBufferNull::setSubData(const void* pIndexData, uint32_t offset, uint32_t size)
+    {
+        if (m_isDynamic)
+            OLogE("Cannot update part of a dynamic index buffer");
+        assert(!m_isDynamic && offset + size <= m_data.size());
+        if (m_isDynamic) return;
+
+        memcpy(m_data.data() + offset, pIndexData, size);
+        oRenderer->renderStates.indexBuffer.forceDirty();
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
+    }
+
+    void* IndexBufferNull::map()
+    {
+        if (!m_isDynamic)
+            OLogE("Cannot unmap static index buffer");
+        assert(m_isDynamic);
+        if (m_isDynamic)
+        {
+            return m_data.data();
+        }
+        return nullptr;
+    }
+
+    void IndexBufferNull::unmap(uint32_t size)
+    {
+        if (!m_isDynamic)
+            OLogE("Cannot unmap static index buffer");
+        assert(m_isDynamic);
+        oRenderer->renderStates.indexBuffer.forceDirty();
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
+    }
+
+    uint32_t IndexBufferNull::size()
+    {
+        return static_cast<uint32_t>(m_data.size());
+    }
+
+    int IndexBufferNull::getTypeSize() const
+    {
+        return m_typeSize;
+    }
+}
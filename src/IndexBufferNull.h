@@ -0,0 +1,40 @@
+#ifndef INDEXBUFFERNULL_H_INCLUDED
+#define INDEXBUFFERNULL_H_INCLUDED
+
+// Onut
+#include <onut/IndexBuffer.h>
+
+// STL
+#include <vector>
+
+// Forward
+#include <onut/ForwardDeclaration.h>
+OForwardDeclare(IndexBufferNull)
+
+namespace onut
+{
+    class IndexBufferNull final : public IndexBuffer
+    {
+    public:
+        IndexBufferNull();
+        ~IndexBufferNull();
+
+        void setData(const void* pIndexData, uint32_t size, int typeSize = 16) override;
+        void setSubData(const void* pIndexData, uint32_t offset, uint32_t size) override;
+        void* map() override;
+        void unmap(uint32_t size) override;
+        uint32_t size() override;
+
+        const uint8_t* getData() const { return m_data.data(); }
+        int getTypeSize() const;
+
+    private:
+        friend class IndexBuffer;
+
+        bool m_isDynamic = false;
+        std::vector<uint8_t> m_data;
+        int m_typeSize = 16;
+    };
+};
+
+#endif
@@ -7371,6 +7371,7 @@ namespace onut
                 auto filename = JS_STRING(0);
                 auto isResource = JS_BOOL(1, true);
                 std::string foundFilename = filename;
+                bool isNewFile = false;
                 if (isResource)
                 {
                     foundFilename = oContentManager->findResourceFile(filename);
@@ -7378,6 +7379,7 @@ namespace onut
                     {
                         if (oContentManager->getSearchPaths().empty()) foundFilename = filename;
                         else foundFilename = oContentManager->getSearchPaths().front() + "/" + filename;
+                        isNewFile = true;
                     }
                 }
                 FILE* pFile = nullptr;
@@ -7387,6 +7389,7 @@ namespace onut
                 pFile = fopen(foundFilename.c_str(), "wb");
 #endif
                 if (!pFile) return DUK_RET_URI_ERROR;
+                if (isNewFile) oContentManager->invalidateFileIndex();
 
                 duk_push_this(ctx);
                 duk_push_pointer(ctx, pFile);
@@ -8899,10 +8902,35 @@ namespace onut
 
                 JS_INTERFACE_FUNCTION_BEGIN
                 {
-                    oRenderer->drawIndexed(JS_UINT(0), JS_UINT(1));
+                    oRenderer->drawIndexed(JS_UINT(0), JS_UINT(1), JS_UINT(2));
                     return 0;
                 }
-                JS_INTERFACE_FUNCTION_END("drawIndexed", 2);
+                JS_INTERFACE_FUNCTION_END("drawIndexed", 3);
+
+                JS_INTERFACE_FUNCTION_BEGIN
+                {
+                    const auto& stats = oRenderer->getFrameStats();
+                    duk_push_object(ctx);
+                    for (int c = 0; c < (int)FrameStats::Counter::COUNT; ++c)
+                    {
+                        duk_push_uint(ctx, stats.totals[c]);
+                        duk_put_prop_string(ctx, -2, FrameStats::getCounterName((FrameStats::Counter)c));
+                    }
+                    duk_push_object(ctx);
+                    for (int s = 0; s < (int)FrameStats::Source::COUNT; ++s)
+                    {
+                        duk_push_object(ctx);
+                        for (int c = 0; c < (int)FrameStats::Counter::COUNT; ++c)
+                        {
+                            duk_push_uint(ctx, stats.counters[s][c]);
+                            duk_put_prop_string(ctx, -2, FrameStats::getCounterName((FrameStats::Counter)c));
+                        }
+                        duk_put_prop_string(ctx, -2, FrameStats::getSourceName((FrameStats::Source)s));
+                    }
+                    duk_put_prop_string(ctx, -2, "sources");
+                    return 1;
+                }
+                JS_INTERFACE_FUNCTION_END("getFrameStats", 0);
 
                 // Render target
                 JS_INTERFACE_FUNCTION_BEGIN
@@ -9689,6 +9717,47 @@ namespace onut
                 }
                 JS_INTERFACE_FUNCTION_END("drawSpriteWithUVs", 7);
                 JS_INTERFACE_FUNCTION_BEGIN
+                {
+                    // Flat x, y, angle, scale per sprite. A Float32Array avoids reading every number through the stack.
+                    static std::vector<OSpriteBatch::SpriteInstance> sprites;
+                    auto color = JS_COLOR(2);
+                    auto setSprite = [&color](OSpriteBatch::SpriteInstance& sprite, const float* pValues)
+                    {
+                        sprite.position = {pValues[0], pValues[1]};
+                        sprite.rotation = pValues[2];
+                        sprite.scale = {pValues[3], pValues[3]};
+                        sprite.color = color;
+                    };
+                    if (duk_is_buffer_data(ctx, 1))
+                    {
+                        duk_size_t size = 0;
+                        auto pValues = static_cast<const float*>(duk_get_buffer_data(ctx, 1, &size));
+                        auto count = size / (sizeof(float) * 4);
+                        sprites.resize(count);
+                        for (size_t i = 0; i < count; ++i) setSprite(sprites[i], pValues + i * 4);
+                    }
+                    else if (duk_is_array(ctx, 1))
+                    {
+                        auto count = duk_get_length(ctx, 1) / 4;
+                        sprites.resize(count);
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            float values[4];
+                            for (int j = 0; j < 4; ++j)
+                            {
+                                duk_get_prop_index(ctx, 1, static_cast<duk_uarridx_t>(i * 4 + j));
+                                values[j] = static_cast<float>(duk_to_number(ctx, -1));
+                                duk_pop(ctx);
+                            }
+                            setSprite(sprites[i], values);
+                        }
+                    }
+                    else return 0;
+                    oSpriteBatch->drawSprites(JS_TEXTURE(0), sprites);
+                    return 0;
+                }
+                JS_INTERFACE_FUNCTION_END("drawSprites", 3);
+                JS_INTERFACE_FUNCTION_BEGIN
                 {
                     auto pSpriteAnimInstance = JS_SPRITE_ANIM_INSTANCE(0);
                     if (pSpriteAnimInstance)
@@ -1,3 +1,4 @@
+#include <onut/Files.h>
 #include <onut/Json.h>
 #include <onut/Log.h>
 
@@ -7,23 +8,17 @@ namespace onut
 {
     bool loadJson(Json::Value& out, const std::string& filename)
     {
-        std::ifstream file(filename);
-        if (!file.is_open())
+        if (!fileExists(filename))
         {
             OLogE("Failed to load file: " + filename);
             return false;
         }
-        try
-        {
-            file >> out;
-        }
-        catch (...)
+        Json::Reader reader;
+        if (!reader.parse(getFileString(filename), out))
         {
             OLogE("Failed to parse file: " + filename);
-            file.close();
             return false;
         }
-        file.close();
         return true;
     }
 
@@ -220,6 +220,35 @@ namespace onut
         }
     }
 
+    // Meshes share the renderer's arenas. The ones too big for a page get buffers of their own.
+    static void createMeshBuffers(Model::Mesh* pMesh)
+    {
+        auto vertexStride = static_cast<uint32_t>(sizeof(float) * pMesh->vertexSize);
+        auto vertexDataSize = static_cast<uint32_t>(pMesh->vertices.size() * sizeof(float));
+        auto is16Bits = !pMesh->indices16.empty();
+        const void* pIndices = is16Bits ? (const void*)pMesh->indices16.data() : (const void*)pMesh->indices32.data();
+        auto indexDataSize = pMesh->elementCount * static_cast<uint32_t>(is16Bits ? sizeof(uint16_t) : sizeof(uint32_t));
+
+        pMesh->pVertexRange = oRenderer->getBufferArena(BufferArena::Type::Vertex)->allocate(vertexDataSize, vertexStride);
+        pMesh->pIndexRange = oRenderer->getBufferArena(is16Bits ? BufferArena::Type::Index16 : BufferArena::Type::Index32)->allocate(indexDataSize);
+        if (pMesh->pVertexRange && pMesh->pIndexRange)
+        {
+            pMesh->pVertexRange->setData(pMesh->vertices.data(), vertexDataSize);
+            pMesh->pIndexRange->setData(pIndices, indexDataSize);
+            pMesh->pVertexBuffer = pMesh->pVertexRange->getVertexBuffer();
+            pMesh->pIndexBuffer = pMesh->pIndexRange->getIndexBuffer();
+            pMesh->baseVertex = pMesh->pVertexRange->getFirstElement();
+            pMesh->startIndex = pMesh->pIndexRange->getFirstElement();
+        }
+        else
+        {
+            pMesh->pVertexRange = nullptr;
+            pMesh->pIndexRange = nullptr;
+            pMesh->pVertexBuffer = OVertexBuffer::createStatic(pMesh->vertices.data(), vertexDataSize);
+            pMesh->pIndexBuffer = OIndexBuffer::createStatic(pIndices, indexDataSize, is16Bits ? 16 : 32);
+        }
+    }
+
     OModelRef Model::createFromFile(const std::string& filename, const OContentManagerRef& pContentManager)
     {
         unsigned char white[4] = {255, 255, 255, 255};
@@ -417,6 +446,10 @@ namespace onut
                                                     pMesh->vertexFlags & ONUT_MODEL_VERTEX_HAS_UV,
                                                     pMesh->vertexFlags & ONUT_MODEL_VERTEX_HAS_WEIGHTS);
             pMesh->pPS = oRenderer->get3DPSForInput(pMesh->vertexFlags & ONUT_MODEL_VERTEX_HAS_UV);
+            if (pMesh->vertexFlags & ONUT_MODEL_VERTEX_HAS_WEIGHTS)
+            {
+                pMesh->bonesUniformId = pMesh->pVS->getUniformId("bones");
+            }
 
             pMesh->vertices.resize(pAssMesh->mNumVertices * vertexSize);
             float* vertices = pMesh->vertices.data();
@@ -527,8 +560,6 @@ namespace onut
                 }
             }
 
-            pMesh->pVertexBuffer = OVertexBuffer::createStatic(vertices, pAssMesh->mNumVertices * sizeof(float) * vertexSize);
-
             // Load faces
             pMesh->elementCount = (uint32_t)pAssMesh->mNumFaces * 3;
             if (pAssMesh->mNumFaces * 3 > std::numeric_limits<uint16_t>::max())
@@ -541,7 +572,6 @@ namespace onut
                     indices[i * 3 + 1] = (uint32_t)pAssMesh->mFaces[i].mIndices[1];
                     indices[i * 3 + 2] = (uint32_t)pAssMesh->mFaces[i].mIndices[2];
                 }
-                pMesh->pIndexBuffer = OIndexBuffer::createStatic(indices, pMesh->elementCount * sizeof(uint32_t), 32);
             }
             else
             {
@@ -553,8 +583,8 @@ namespace onut
                     indices[i * 3 + 1] = (uint16_t)pAssMesh->mFaces[i].mIndices[1];
                     indices[i * 3 + 2] = (uint16_t)pAssMesh->mFaces[i].mIndices[2];
                 }
-                pMesh->pIndexBuffer = OIndexBuffer::createStatic(indices, pMesh->elementCount * sizeof(uint16_t), 16);
             }
+            createMeshBuffers(pMesh);
         }
 
         // Animations
@@ -769,6 +799,8 @@ namespace onut
 
         rs.world = transform;
 
+        auto previousStatsSource = pRenderer->setStatsSource(FrameStats::Source::Model);
+        int customBonesUniformId = -1;
         int len = (int)m_meshes.size();
         auto pMeshes = m_meshes.data();
         for (int i = 0; i < len; ++i)
@@ -780,10 +812,12 @@ namespace onut
             rs.pixelShader = customPS ? customPS : pMeshes[i].pPS;
             if (pMeshes[i].vertexFlags & ONUT_MODEL_VERTEX_HAS_WEIGHTS)
             {
-                rs.vertexShader.get()->setMatrixArray("bones", pMeshes[i].bones.data(), (int)pMeshes[i].bones.size());
+                if (customVS && customBonesUniformId == -1) customBonesUniformId = customVS->getUniformId("bones");
+                rs.vertexShader.get()->setMatrixArray(customVS ? customBonesUniformId : pMeshes[i].bonesUniformId, pMeshes[i].bones.data(), (int)pMeshes[i].bones.size());
             }
-            pRenderer->drawIndexed(pMeshes[i].elementCount, 0);
+            pRenderer->drawIndexed(pMeshes[i].elementCount, pMeshes[i].startIndex, pMeshes[i].baseVertex);
         }
+        pRenderer->setStatsSource(previousStatsSource);
     }
 
     void Model::render(const Matrix& transform, const Anim* pAnim, double time, const OShaderRef& customVS, const OShaderRef& customPS)
@@ -802,6 +836,8 @@ namespace onut
 
         rs.world = transform;
 
+        auto previousStatsSource = pRenderer->setStatsSource(FrameStats::Source::Model);
+        int customBonesUniformId = -1;
         int len = (int)m_meshes.size();
         auto pMeshes = m_meshes.data();
         for (int i = 0; i < len; ++i)
@@ -813,11 +849,13 @@ namespace onut
             rs.pixelShader = customPS ? customPS : pMeshes[i].pPS;
             if (pMeshes[i].vertexFlags & ONUT_MODEL_VERTEX_HAS_WEIGHTS)
             {
+                if (customVS && customBonesUniformId == -1) customBonesUniformId = customVS->getUniformId("bones");
                 const auto& bones = pAnim->animMeshes[i].frames[framei].bones;
-                rs.vertexShader.get()->setMatrixArray("bones", bones.data(), (int)bones.size());
+                rs.vertexShader.get()->setMatrixArray(customVS ? customBonesUniformId : pMeshes[i].bonesUniformId, bones.data(), (int)bones.size());
             }
-            pRenderer->drawIndexed(pMeshes[i].elementCount, 0);
+            pRenderer->drawIndexed(pMeshes[i].elementCount, pMeshes[i].startIndex, pMeshes[i].baseVertex);
         }
+        pRenderer->setStatsSource(previousStatsSource);
     }
 };
 
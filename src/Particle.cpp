@@ -1,66 +1,234 @@
 // Onut
 #include <onut/ParticleSystem.h>
-#include <onut/Timing.h>
 
 // Private
 #include "Particle.h"
-#include "ParticleEmitter.h"
+#include "SIMD.h"
 
 namespace onut
 {
-    void Particle::update()
+    ParticleBuffer::ParticleBuffer()
     {
-        float dt = ODT;
-        if (delay > 0)
+        Range* ranges[] = {
+            &velocityX, &velocityY, &velocityZ,
+            &gravityX, &gravityY, &gravityZ,
+            &colorR, &colorG, &colorB, &colorA,
+            &angle, &size, &rotation, &radialAccel, &tangentAccel
+        };
+        m_streams = {
+            &life, &delay, &delta,
+            &positionX, &positionY, &positionZ,
+            &velX, &velY, &velZ
+        };
+        for (auto pRange : ranges)
         {
-            delay -= dt;
-            return;
+            m_streams.push_back(&pRange->from);
+            m_streams.push_back(&pRange->to);
+            m_streams.push_back(&pRange->value);
         }
-        float t = 1 - life;
-        life -= delta * dt;
-        if (life < 0.f) life = 0.f;
-
-        // Animate position with velocity
-        position += (vel + velocity.value) * dt;
-        vel += gravity.value * dt;
-        angle.from += rotation.value * dt;
-        angle.to += rotation.value * dt;
-
-        // Acceleration
-        if (pDesc->accelType == OParticleEmitterDesc::AccelType::Gravity)
+    }
+
+    void ParticleBuffer::grow()
+    {
+        m_capacity = m_capacity ? m_capacity * 2 : 16;
+        for (auto pStream : m_streams)
+        {
+            pStream->resize(m_capacity);
+        }
+        textureIndex.resize(m_capacity);
+        m_t.resize(m_capacity);
+    }
+
+    size_t ParticleBuffer::add()
+    {
+        if (m_count == m_capacity) grow();
+        return m_count++;
+    }
+
+    void ParticleBuffer::remove(size_t index)
+    {
+        auto last = m_count - 1;
+        if (index != last)
+        {
+            for (auto pStream : m_streams)
+            {
+                (*pStream)[index] = (*pStream)[last];
+            }
+            textureIndex[index] = textureIndex[last];
+        }
+        --m_count;
+    }
+
+    void ParticleBuffer::clear()
+    {
+        m_count = 0;
+    }
+
+    void ParticleBuffer::initValues(size_t index, const OParticleEmitterDesc& desc)
+    {
+        auto init = [index](Range& range, Tween tween)
+        {
+            auto t = OApplyTween(0.f, tween);
+            range.value[index] = range.from[index] + (range.to[index] - range.from[index]) * t;
+        };
+        init(velocityX, desc.speed.tween);
+        init(velocityY, desc.speed.tween);
+        init(velocityZ, desc.speed.tween);
+        init(gravityX, desc.gravity.tween);
+        init(gravityY, desc.gravity.tween);
+        init(gravityZ, desc.gravity.tween);
+        init(colorR, desc.color.tween);
+        init(colorG, desc.color.tween);
+        init(colorB, desc.color.tween);
+        init(colorA, desc.color.tween);
+        init(angle, desc.angle.tween);
+        init(size, desc.size.tween);
+        init(rotation, desc.rotation.tween);
+        init(radialAccel, desc.radialAccel.tween);
+        init(tangentAccel, desc.tangentAccel.tween);
+    }
+
+    const float* ParticleBuffer::getTweened(Tween tween, size_t count)
+    {
+        if (tween == Tween::Linear) return m_t.data();
+
+        // Tweens are not vectorized, but they are shared by all the properties using the same one
+        auto bit = 1u << (uint32_t)tween;
+        auto& tweened = m_tweened[(int)tween];
+        if (!(m_tweenedMask & bit))
+        {
+            m_tweenedMask |= bit;
+            if (tweened.size() < count) tweened.resize(m_capacity);
+            for (size_t i = 0; i < count; ++i)
+            {
+                tweened[i] = OApplyTween(m_t[i], tween);
+            }
+        }
+        return tweened.data();
+    }
+
+    void ParticleBuffer::updateRange(Range& range, Tween tween, size_t count)
+    {
+        auto pT = getTweened(tween, count);
+        auto pFrom = range.from.data();
+        auto pTo = range.to.data();
+        auto pValue = range.value.data();
+        for (size_t i = 0; i < count; i += Float4::WIDTH)
         {
-            auto radial = position - pEmitter->getPosition();
-            radial.Normalize();
-            auto tagent = Vector3(radial.y, -radial.x, 0);
+            auto from = Float4::load(pFrom + i);
+            auto to = Float4::load(pTo + i);
+            auto t = Float4::load(pT + i);
+            (from + (to - from) * t).store(pValue + i);
+        }
+    }
+
+    size_t ParticleBuffer::update(float dt, const OParticleEmitterDesc& desc, const Vector3& emitterPosition)
+    {
+        if (m_count == 0) return 0;
+
+        auto count = alignToFloat4(m_count);
+        auto gravityAccel = desc.accelType == ParticleEmitterDesc::AccelType::Gravity;
 
-            radial *= radialAccel.value;
-            tagent *= tangentAccel.value;
+        const Float4 zero(0.f);
+        const Float4 one(1.f);
+        const Float4 dt4(dt);
+        const Float4 emitterX(emitterPosition.x);
+        const Float4 emitterY(emitterPosition.y);
+        const Float4 emitterZ(emitterPosition.z);
 
-            auto accel = gravity.value + radial + tagent;
-            vel += accel * dt;
+        for (size_t i = 0; i < count; i += Float4::WIDTH)
+        {
+            // Particles still in their delay only count it down
+            auto d = Float4::load(&delay[i]);
+            auto waiting = d > zero;
+            select(waiting, d - dt4, d).store(&delay[i]);
+
+            auto l = Float4::load(&life[i]);
+            (one - l).store(&m_t[i]);
+            auto newLife = max(l - Float4::load(&delta[i]) * dt4, zero);
+            select(waiting, l, newLife).store(&life[i]);
+
+            // Animate position with velocity
+            auto px = Float4::load(&positionX[i]);
+            auto py = Float4::load(&positionY[i]);
+            auto pz = Float4::load(&positionZ[i]);
+            auto vx = Float4::load(&velX[i]);
+            auto vy = Float4::load(&velY[i]);
+            auto vz = Float4::load(&velZ[i]);
+            auto gx = Float4::load(&gravityX.value[i]);
+            auto gy = Float4::load(&gravityY.value[i]);
+            auto gz = Float4::load(&gravityZ.value[i]);
+
+            auto newPx = px + (vx + Float4::load(&velocityX.value[i])) * dt4;
+            auto newPy = py + (vy + Float4::load(&velocityY.value[i])) * dt4;
+            auto newPz = pz + (vz + Float4::load(&velocityZ.value[i])) * dt4;
+            auto newVx = vx + gx * dt4;
+            auto newVy = vy + gy * dt4;
+            auto newVz = vz + gz * dt4;
+
+            auto rotationDelta = Float4::load(&rotation.value[i]) * dt4;
+            auto angleFrom = Float4::load(&angle.from[i]);
+            auto angleTo = Float4::load(&angle.to[i]);
+            select(waiting, angleFrom, angleFrom + rotationDelta).store(&angle.from[i]);
+            select(waiting, angleTo, angleTo + rotationDelta).store(&angle.to[i]);
+
+            // Acceleration
+            if (gravityAccel)
+            {
+                auto rx = newPx - emitterX;
+                auto ry = newPy - emitterY;
+                auto rz = newPz - emitterZ;
+                auto len = sqrt(rx * rx + ry * ry + rz * rz);
+                auto invLen = select(len > zero, one / len, zero);
+                rx = rx * invLen;
+                ry = ry * invLen;
+                rz = rz * invLen;
+
+                auto radial = Float4::load(&radialAccel.value[i]);
+                auto tangent = Float4::load(&tangentAccel.value[i]);
+                newVx = newVx + (gx + rx * radial + ry * tangent) * dt4;
+                newVy = newVy + (gy + ry * radial - rx * tangent) * dt4;
+                newVz = newVz + (gz + rz * radial) * dt4;
+            }
+
+            select(waiting, px, newPx).store(&positionX[i]);
+            select(waiting, py, newPy).store(&positionY[i]);
+            select(waiting, pz, newPz).store(&positionZ[i]);
+            select(waiting, vx, newVx).store(&velX[i]);
+            select(waiting, vy, newVy).store(&velY[i]);
+            select(waiting, vz, newVz).store(&velZ[i]);
+        }
+
+        // Animate constant properties. Waiting particles have t = 0, which gives back their spawn value.
+        m_tweenedMask = 0;
+        updateRange(velocityX, desc.speed.tween, count);
+        updateRange(velocityY, desc.speed.tween, count);
+        updateRange(velocityZ, desc.speed.tween, count);
+        updateRange(gravityX, desc.gravity.tween, count);
+        updateRange(gravityY, desc.gravity.tween, count);
+        updateRange(gravityZ, desc.gravity.tween, count);
+        updateRange(colorR, desc.color.tween, count);
+        updateRange(colorG, desc.color.tween, count);
+        updateRange(colorB, desc.color.tween, count);
+        updateRange(colorA, desc.color.tween, count);
+        updateRange(angle, desc.angle.tween, count);
+        updateRange(size, desc.size.tween, count);
+        updateRange(rotation, desc.rotation.tween, count);
+        updateRange(radialAccel, desc.radialAccel.tween, count);
+        updateRange(tangentAccel, desc.tangentAccel.tween, count);
+
+        // Kill dead ones
+        size_t killed = 0;
+        for (size_t i = 0; i < m_count;)
+        {
+            if (life[i] <= 0.f)
+            {
+                remove(i);
+                ++killed;
+                continue;
+            }
+            ++i;
         }
-        //else if (pEmitter->getDesc()->accelType == sEmitterDesc::AccelType::Radial)
-        //{
-        //    // FIX 2
-        //    // Update the angle of the particle from the sourcePosition and the radius.  This is only done if the particles are rotating
-        //    currentParticle->m_rAngle -= currentParticle->m_degreesPerSecond * in_delta;
-        //    currentParticle->m_radius += currentParticle->m_radiusDelta * in_delta;
-
-        //    Vector2f tmp;
-        //    tmp.x = currentParticle->m_sourcePosition.x - cosf(currentParticle->m_rAngle) * currentParticle->m_radius;
-        //    tmp.y = currentParticle->m_sourcePosition.y - sinf(currentParticle->m_rAngle) * currentParticle->m_radius;
-        //    currentParticle->SetPosition(tmp);
-        //}
-
-        // Animate constant properties
-        velocity.update(t);
-        gravity.update(t);
-        color.update(t);
-        angle.update(t);
-        size.update(t);
-        image_index.update(t);
-        rotation.update(t);
-        radialAccel.update(t);
-        tangentAccel.update(t);
+        return killed;
     }
 }
@@ -2,62 +2,91 @@
 #define PARTICLE_H_INCLUDED
 
 // Onut
-#include <onut/Curve.h>
 #include <onut/Maths.h>
 #include <onut/Tween.h>
 
+// STL
+#include <cstdint>
+#include <vector>
+
 // Forward
 #include <onut/ForwardDeclaration.h>
 OForwardDeclare(ParticleEmitterDesc);
-OForwardDeclare(ParticleSystem);
-OForwardDeclare(Texture);
 
 namespace onut
 {
-    class ParticleEmitter;
-
-    class Particle final
+    /**
+    Particles of one emitter, stored as a structure of arrays so they can be
+    updated 4 at a time. Arrays are padded to a multiple of 4, the padding
+    lanes are computed and ignored. Removing a particle moves the last one in
+    its place.
+    */
+    class ParticleBuffer final
     {
     public:
-        template<typename Ttype>
+        using Stream = std::vector<float>;
+
         struct Range
         {
-            Ttype from;
-            Ttype to;
-            Ttype value;
-            Tween tween;
-
-            void update(float t)
-            {
-                t = OApplyTween(t, tween);
-                value = OLerp(from, to, t);
-            }
+            Stream from;
+            Stream to;
+            Stream value;
         };
 
-        void update();
+        ParticleBuffer();
+        ParticleBuffer(const ParticleBuffer&) = delete;
+        ParticleBuffer& operator=(const ParticleBuffer&) = delete;
+
+        size_t getCount() const { return m_count; }
+        bool empty() const { return m_count == 0; }
+
+        /**
+        Add a particle at the end. Values are left for the caller to fill.
+        @return Index of the new particle
+        */
+        size_t add();
+        void remove(size_t index);
+        void clear();
+
+        /**
+        Simulate all particles.
+        @return Count of particles that died and were removed
+        */
+        size_t update(float dt, const OParticleEmitterDesc& desc, const Vector3& emitterPosition);
 
-        bool isAlive() const { return life > 0.f; }
+        /**
+        Compute range values at t = 0 for a newly spawned particle.
+        */
+        void initValues(size_t index, const OParticleEmitterDesc& desc);
 
-        OParticleEmitterDescRef pDesc;
-        float life;
-        float delay;
-        float delta;
-        ParticleEmitter* pEmitter = nullptr;
+        Stream life;
+        Stream delay;
+        Stream delta;
+        Stream positionX, positionY, positionZ;
+        Stream velX, velY, velZ;
+        Range velocityX, velocityY, velocityZ;
+        Range gravityX, gravityY, gravityZ;
+        Range colorR, colorG, colorB, colorA;
+        Range angle;
+        Range size;
+        Range rotation;
+        Range radialAccel;
+        Range tangentAccel;
+        std::vector<uint32_t> textureIndex;
 
-        Vector3 position;
-        Vector3 vel;
+    private:
+        void grow();
+        const float* getTweened(Tween tween, size_t count);
+        void updateRange(Range& range, Tween tween, size_t count);
 
-        Range<Vector3> velocity;
-        Range<Vector3> gravity;
-        Range<Color> color;
-        Range<float> angle;
-        Range<float> size;
-        Range<unsigned int> image_index;
-        Range<float> rotation;
-        Range<float> radialAccel;
-        Range<float> tangentAccel;
+        size_t m_count = 0;
+        size_t m_capacity = 0;
+        std::vector<Stream*> m_streams;
 
-        OTextureRef pTexture;
+        // Scratch for the current update
+        Stream m_t;
+        Stream m_tweened[(int)Tween::SpringOut + 1];
+        uint32_t m_tweenedMask = 0;
     };
 }
 
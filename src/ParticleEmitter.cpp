@@ -1,6 +1,8 @@
 // Onut
 #include <onut/ParticleSystem.h>
 #include <onut/ParticleSystemManager.h>
+#include <onut/SpriteBatch.h>
+#include <onut/Texture.h>
 #include <onut/Timing.h>
 
 // Private
@@ -12,15 +14,20 @@ namespace onut
     ParticleEmitter::ParticleEmitter(const OParticleEmitterDescRef& pEmitterDesc,
                                      const OParticleSystemManagerRef& pParticleSystemManager,
                                      const Matrix& transform,
-                                     uint32_t instanceId) :
+                                     uint32_t instanceId,
+                                     ParticlePriority priority) :
         m_pDesc(pEmitterDesc),
         m_pParticleSystemManager(pParticleSystemManager),
         m_transform(transform),
         m_isAlive(true),
-        m_instanceId(instanceId)
+        m_instanceId(instanceId),
+        m_priority(priority),
+        m_random(static_cast<unsigned int>(randi()))
     {
+        ScopedRandomGenerator scopedRandom(m_random);
         m_duration = m_pDesc->duration.generate();
-        if (m_pDesc->type == ParticleEmitterDesc::Type::BURST)
+        m_isCulled = m_pParticleSystemManager->isCulled(getPosition(), m_priority);
+        if (m_pDesc->type == ParticleEmitterDesc::Type::BURST && !m_isCulled)
         {
             // Spawn them all!
             for (decltype(m_pDesc->count) i = 0; i < m_pDesc->count; ++i)
@@ -32,10 +39,7 @@ namespace onut
 
     ParticleEmitter::~ParticleEmitter()
     {
-        for (auto pParticle : m_particles)
-        {
-            m_pParticleSystemManager->deallocParticle(pParticle);
-        }
+        m_pParticleSystemManager->deallocParticles(m_particles.getCount());
         m_particles.clear();
     }
 
@@ -46,30 +50,18 @@ namespace onut
 
     void ParticleEmitter::update()
     {
+        ScopedRandomGenerator scopedRandom(m_random);
+
         // Update current particles
-        for (decltype(m_particles.size()) i = 0; i < m_particles.size();)
-        {
-            auto pParticle = m_particles[i];
-            pParticle->update();
-            if (!pParticle->isAlive())
-            {
-                m_pParticleSystemManager->deallocParticle(pParticle);
-                m_particles.erase(m_particles.begin() + i);
-                continue;
-            }
-            ++i;
-        }
+        auto killed = m_particles.update(ODT, *m_pDesc, getPosition());
+        m_pParticleSystemManager->deallocParticles(killed);
+
+        m_isCulled = m_pParticleSystemManager->isCulled(getPosition(), m_priority);
 
         // Spawn at rate
         if (m_pDesc->type == ParticleEmitterDesc::Type::CONTINOUS && m_pDesc->rate > 0 && !m_isStopped)
         {
-            m_rateProgress += ODT;
-            auto rate = 1.0f / m_pDesc->rate;
-            while (m_rateProgress >= rate)
-            {
-                m_rateProgress -= rate;
-                spawnParticle();
-            }
+            spawnAtRate();
         }
 
         if (m_pDesc->type == ParticleEmitterDesc::Type::CONTINOUS && m_isStopped)
@@ -80,13 +72,7 @@ namespace onut
         if (m_pDesc->type == ParticleEmitterDesc::Type::FINITE && m_pDesc->rate > 0 && !m_isStopped && m_duration > 0.f)
         {
             m_duration -= ODT;
-            m_rateProgress += ODT;
-            auto rate = 1.0f / m_pDesc->rate;
-            while (m_rateProgress >= rate)
-            {
-                m_rateProgress -= rate;
-                spawnParticle();
-            }
+            spawnAtRate();
         }
 
         if (m_pDesc->type == ParticleEmitterDesc::Type::FINITE && (m_isStopped || m_duration <= 0.f))
@@ -99,21 +85,74 @@ namespace onut
         {
             m_isAlive = false;
         }
+
+        flushStats();
+    }
+
+    void ParticleEmitter::spawnAtRate()
+    {
+        // Culled emitters don't build up progress, they would burst when coming back
+        if (m_isCulled) return;
+
+        auto rate = 1.0f / m_pDesc->rate;
+        auto scale = m_pParticleSystemManager->getSpawnRateScale(m_priority);
+        m_rateProgress += ODT * scale;
+        while (m_rateProgress >= rate)
+        {
+            m_rateProgress -= rate;
+            spawnParticle();
+        }
+
+        // What the scale took away is counted as throttled
+        m_throttleProgress += ODT * (1.f - scale);
+        while (m_throttleProgress >= rate)
+        {
+            m_throttleProgress -= rate;
+            ++m_throttledCount;
+        }
+    }
+
+    void ParticleEmitter::flushStats()
+    {
+        m_pParticleSystemManager->addStats(m_spawnedCount, m_throttledCount, m_isCulled ? 1 : 0);
+        m_spawnedCount = 0;
+        m_throttledCount = 0;
     }
 
     void ParticleEmitter::render()
     {
-        auto camDir = -Vector3::UnitZ;
-        auto camUp = -Vector3::UnitY;
-        auto camRight = camDir.Cross(camUp);
+        if (m_isCulled) return;
 
-        for (decltype(m_particles.size()) i = 0; i < m_particles.size(); ++i)
+        auto& textures = m_pDesc->textures;
+        auto count = m_particles.getCount();
+        const uint32_t* pOrder = nullptr;
+        if (m_pParticleSystemManager->getSortParticles() && count > 1)
         {
-            auto pParticle = m_particles[i];
-            if (pParticle->delay <= 0)
+            pOrder = m_pParticleSystemManager->sortParticles(m_particles.positionX.data(), m_particles.positionY.data(), m_particles.positionZ.data(), count);
+        }
+
+        for (decltype(count) n = 0; n < count; ++n)
+        {
+            auto i = pOrder ? pOrder[n] : n;
+            if (m_particles.delay[i] > 0) continue;
+
+            OTextureRef pTexture;
+            float dim = 1.f;
+            if (!textures.empty())
             {
-                m_pParticleSystemManager->renderParticle(pParticle, camRight, camUp);
+                pTexture = textures[m_particles.textureIndex[i]];
+                if (pTexture)
+                {
+                    auto& textureSize = pTexture->getSize();
+                    dim = static_cast<float>(std::max(textureSize.x, textureSize.y));
+                }
             }
+
+            oSpriteBatch->drawSprite(pTexture,
+                                     Vector2(m_particles.positionX[i], m_particles.positionY[i]),
+                                     Color(m_particles.colorR.value[i], m_particles.colorG.value[i], m_particles.colorB.value[i], m_particles.colorA.value[i]),
+                                     m_particles.angle.value[i],
+                                     m_particles.size.value[i] / dim);
         }
     }
 
@@ -127,76 +166,82 @@ namespace onut
         m_renderEnabled = renderEnabled;
     }
 
-    Particle* ParticleEmitter::spawnParticle()
+    void ParticleEmitter::spawnParticle()
     {
-        auto pParticle = m_pParticleSystemManager->allocParticle();
-        if (pParticle)
+        if (!m_pParticleSystemManager->allocParticle(m_priority))
         {
-            Vector3 spawnPos = m_transform.Translation();
-            Vector3 up = m_transform.AxisZ();
-            Vector3 right = m_transform.AxisX();
+            ++m_throttledCount;
+            return;
+        }
+        ++m_spawnedCount;
 
-            auto randomAngleX = m_pDesc->spread.generateFrom() * .5f;
-            auto randomAngleZ = randf(0, 360.f);
+        Vector3 spawnPos = m_transform.Translation();
+        Vector3 up = m_transform.AxisZ();
+        Vector3 right = m_transform.AxisX();
 
-            Matrix rotX = Matrix::CreateFromAxisAngle(right, OConvertToRadians(randomAngleX));
-            Matrix rotZ = Matrix::CreateFromAxisAngle(up, OConvertToRadians(randomAngleZ));
+        auto randomAngleX = m_pDesc->spread.generateFrom() * .5f;
+        auto randomAngleZ = randf(0, 360.f);
 
-            up = Vector3::Transform(up, rotX);
-            up = Vector3::Transform(up, rotZ);
-            if (m_pDesc->dir.from.LengthSquared() != 0)
-            {
-                Matrix rotDir = Matrix::CreateFromAxisAngle(Vector3(m_pDesc->dir.from.y, m_pDesc->dir.from.x, 0), OConvertToRadians(90));
-                up = Vector3::Transform(up, rotDir);
-            }
-
-            pParticle->pDesc = m_pDesc;
-            pParticle->pEmitter = this;
-
-            pParticle->position = spawnPos + m_pDesc->position.generate();
-
-            pParticle->velocity.from = up * m_pDesc->speed.generateFrom();
-            pParticle->velocity.to = up * m_pDesc->speed.generateTo();
-            pParticle->color.to = m_pDesc->color.generateTo(pParticle->color.from = m_pDesc->color.generateFrom());
-            pParticle->angle.to = m_pDesc->angle.generateTo(pParticle->angle.from = m_pDesc->angle.generateFrom());
-            pParticle->size.to = m_pDesc->size.generateTo(pParticle->size.from = m_pDesc->size.generateFrom());
-            pParticle->image_index.to = m_pDesc->image_index.generateTo(pParticle->image_index.from = m_pDesc->image_index.generateFrom());
-            pParticle->rotation.to = m_pDesc->rotation.generateTo(pParticle->rotation.from = m_pDesc->rotation.generateFrom());
-            pParticle->radialAccel.to = m_pDesc->radialAccel.generateTo(pParticle->radialAccel.from = m_pDesc->radialAccel.generateFrom());
-            pParticle->tangentAccel.to = m_pDesc->tangentAccel.generateTo(pParticle->tangentAccel.from = m_pDesc->tangentAccel.generateFrom());
-            pParticle->gravity.to = m_pDesc->gravity.generateTo(pParticle->gravity.from = m_pDesc->gravity.generateFrom());
-
-            pParticle->velocity.tween = m_pDesc->speed.tween;
-            pParticle->gravity.tween = m_pDesc->gravity.tween;
-            pParticle->color.tween = m_pDesc->color.tween;
-            pParticle->angle.tween = m_pDesc->angle.tween;
-            pParticle->size.tween = m_pDesc->size.tween;
-            pParticle->image_index.tween = m_pDesc->image_index.tween;
-            pParticle->rotation.tween = m_pDesc->rotation.tween;
-            pParticle->radialAccel.tween = m_pDesc->radialAccel.tween;
-            pParticle->tangentAccel.tween = m_pDesc->tangentAccel.tween;
-
-            pParticle->velocity.update(0);
-            pParticle->gravity.update(0);
-            pParticle->color.update(0);
-            pParticle->angle.update(0);
-            pParticle->size.update(0);
-            pParticle->image_index.update(0);
-            pParticle->rotation.update(0);
-            pParticle->radialAccel.update(0);
-            pParticle->tangentAccel.update(0);
-
-            if (!pParticle->pDesc->textures.empty())
-            {
-                pParticle->pTexture = pParticle->pDesc->textures[static_cast<decltype(pParticle->pDesc->textures.size())>(pParticle->image_index.value)];
-            }
+        Matrix rotX = Matrix::CreateFromAxisAngle(right, OConvertToRadians(randomAngleX));
+        Matrix rotZ = Matrix::CreateFromAxisAngle(up, OConvertToRadians(randomAngleZ));
 
-            pParticle->life = 1.f;
-            pParticle->delay = m_pDesc->delay.generate();
-            pParticle->delta = 1.f / m_pDesc->life.generate();
+        up = Vector3::Transform(up, rotX);
+        up = Vector3::Transform(up, rotZ);
+        if (m_pDesc->dir.from.LengthSquared() != 0)
+        {
+            Matrix rotDir = Matrix::CreateFromAxisAngle(Vector3(m_pDesc->dir.from.y, m_pDesc->dir.from.x, 0), OConvertToRadians(90));
+            up = Vector3::Transform(up, rotDir);
+        }
 
-            m_particles.push_back(pParticle);
+        auto& p = m_particles;
+        auto i = p.add();
+
+        auto position = spawnPos + m_pDesc->position.generate();
+        p.positionX[i] = position.x;
+        p.positionY[i] = position.y;
+        p.positionZ[i] = position.z;
+        p.velX[i] = 0.f;
+        p.velY[i] = 0.f;
+        p.velZ[i] = 0.f;
+
+        auto velocityFrom = up * m_pDesc->speed.generateFrom();
+        auto velocityTo = up * m_pDesc->speed.generateTo();
+        p.velocityX.from[i] = velocityFrom.x; p.velocityX.to[i] = velocityTo.x;
+        p.velocityY.from[i] = velocityFrom.y; p.velocityY.to[i] = velocityTo.y;
+        p.velocityZ.from[i] = velocityFrom.z; p.velocityZ.to[i] = velocityTo.z;
+
+        auto gravityFrom = m_pDesc->gravity.generateFrom();
+        auto gravityTo = m_pDesc->gravity.generateTo(gravityFrom);
+        p.gravityX.from[i] = gravityFrom.x; p.gravityX.to[i] = gravityTo.x;
+        p.gravityY.from[i] = gravityFrom.y; p.gravityY.to[i] = gravityTo.y;
+        p.gravityZ.from[i] = gravityFrom.z; p.gravityZ.to[i] = gravityTo.z;
+
+        auto colorFrom = m_pDesc->color.generateFrom();
+        auto colorTo = m_pDesc->color.generateTo(colorFrom);
+        p.colorR.from[i] = colorFrom.r; p.colorR.to[i] = colorTo.r;
+        p.colorG.from[i] = colorFrom.g; p.colorG.to[i] = colorTo.g;
+        p.colorB.from[i] = colorFrom.b; p.colorB.to[i] = colorTo.b;
+        p.colorA.from[i] = colorFrom.a; p.colorA.to[i] = colorTo.a;
+
+        p.angle.to[i] = m_pDesc->angle.generateTo(p.angle.from[i] = m_pDesc->angle.generateFrom());
+        p.size.to[i] = m_pDesc->size.generateTo(p.size.from[i] = m_pDesc->size.generateFrom());
+        p.rotation.to[i] = m_pDesc->rotation.generateTo(p.rotation.from[i] = m_pDesc->rotation.generateFrom());
+        p.radialAccel.to[i] = m_pDesc->radialAccel.generateTo(p.radialAccel.from[i] = m_pDesc->radialAccel.generateFrom());
+        p.tangentAccel.to[i] = m_pDesc->tangentAccel.generateTo(p.tangentAccel.from[i] = m_pDesc->tangentAccel.generateFrom());
+        p.initValues(i, *m_pDesc);
+
+        // The image is picked once, at spawn
+        p.textureIndex[i] = 0;
+        if (!m_pDesc->textures.empty())
+        {
+            auto imageFrom = m_pDesc->image_index.generateFrom();
+            auto imageTo = m_pDesc->image_index.generateTo(imageFrom);
+            auto imageIndex = static_cast<uint32_t>(lerp(imageFrom, imageTo, OApplyTween(0.f, m_pDesc->image_index.tween)));
+            p.textureIndex[i] = std::min<uint32_t>(imageIndex, static_cast<uint32_t>(m_pDesc->textures.size() - 1));
         }
-        return pParticle;
+
+        p.life[i] = 1.f;
+        p.delay[i] = m_pDesc->delay.generate();
+        p.delta[i] = 1.f / m_pDesc->life.generate();
     }
 }
@@ -3,6 +3,11 @@
 
 // Onut
 #include <onut/Maths.h>
+#include <onut/ParticleSystem.h>
+#include <onut/Random.h>
+
+// Private
+#include "Particle.h"
 
 // Forward
 #include <onut/ForwardDeclaration.h>
@@ -11,12 +16,10 @@ OForwardDeclare(ParticleSystemManager);
 
 namespace onut
 {
-    class Particle;
-
     class ParticleEmitter final
     {
     public:
-        ParticleEmitter(const OParticleEmitterDescRef& pEmitterDesc, const OParticleSystemManagerRef& pParticleSystemManager, const Matrix& transform, uint32_t instanceId = 0);
+        ParticleEmitter(const OParticleEmitterDescRef& pEmitterDesc, const OParticleSystemManagerRef& pParticleSystemManager, const Matrix& transform, uint32_t instanceId, ParticlePriority priority);
         ~ParticleEmitter();
 
         bool isAlive() const { return m_isAlive; }
@@ -30,14 +33,17 @@ namespace onut
 
         void setRenderEnabled(bool renderEnabled);
         bool getRenderEnabled() const { return m_renderEnabled; }
+        bool isCulled() const { return m_isCulled; }
 
         Vector3 getPosition() const { return m_transform.Translation(); }
         const OParticleEmitterDescRef& getDesc() const { return m_pDesc; }
 
     private:
-        Particle* spawnParticle();
+        void spawnAtRate();
+        void spawnParticle();
+        void flushStats();
 
-        std::vector<Particle*> m_particles;
+        ParticleBuffer m_particles;
         OParticleSystemManagerRef m_pParticleSystemManager;
         bool m_isAlive = false;
         Matrix m_transform;
@@ -47,6 +53,15 @@ namespace onut
         bool m_isStopped = false;
         bool m_renderEnabled = true;
         float m_duration = 0.f;
+        ParticlePriority m_priority;
+        RandomGenerator m_random; // Own state, updates can run on worker threads
+        bool m_isCulled = false;
+        float m_throttleProgress = 0.f;
+
+        // Counted locally and added to the manager once per update. emit() updates
+        // new emitters right away, which reports what the constructor spawned.
+        size_t m_spawnedCount = 0;
+        size_t m_throttledCount = 0;
     };
 }
 
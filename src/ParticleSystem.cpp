@@ -399,6 +399,12 @@ namespace onut
                 return pRet;
             }
 
+            pfxReadEnum<ParticlePriority>(pRet->m_priority, doc["priority"], {
+                {"LOW", ParticlePriority::Low},
+                {"NORMAL", ParticlePriority::Normal},
+                {"HIGH", ParticlePriority::High},
+                {"CRITICAL", ParticlePriority::Critical}});
+
             const auto& jonsEmitters = doc["emitters"];
             for (decltype(jonsEmitters.Size()) i = 0; i < jonsEmitters.Size(); ++i)
             {
@@ -536,6 +542,16 @@ namespace onut
     {
         return m_emitters;
     }
+
+    void ParticleSystem::setPriority(ParticlePriority priority)
+    {
+        m_priority = priority;
+    }
+
+    ParticlePriority ParticleSystem::getPriority() const
+    {
+        return m_priority;
+    }
 }
 
 OParticleSystemRef OGetParticleSystem(const std::string& name)
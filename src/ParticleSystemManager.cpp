@@ -4,10 +4,15 @@
 #include <onut/Pool.h>
 #include <onut/SpriteBatch.h>
 #include <onut/Texture.h>
+#include <onut/ThreadPool.h>
+
+// STL
+#include <algorithm>
+#include <limits>
 
 // Private
-#include "Particle.h"
 #include "ParticleEmitter.h"
+#include "RadixSort.h"
 
 OParticleSystemManagerRef oParticleSystemManager;
 
@@ -15,14 +20,17 @@ namespace onut
 {
     OParticleSystemManagerRef ParticleSystemManager::create(uintptr_t TmaxPFX, uintptr_t TmaxParticles, bool TsortEmitters)
     {
-        return OMake<ParticleSystemManager>(TmaxPFX, TmaxParticles, false);
+        return OMake<ParticleSystemManager>(TmaxPFX, TmaxParticles, TsortEmitters);
     }
 
     ParticleSystemManager::ParticleSystemManager(uintptr_t TmaxPFX, uintptr_t TmaxParticles, bool TsortEmitters)
-        : m_sortEmitters(TsortEmitters)
+        : m_maxParticles(TmaxParticles)
+        , m_sortEmitters(TsortEmitters)
     {
-        m_pEmitterPool = OPool::create(sizeof(ParticleEmitter), TmaxPFX);
-        m_pParticlePool = OPool::create(sizeof(Particle), TmaxParticles);
+        m_pEmitterPool = OMake<OTypedPool<ParticleEmitter>>(TmaxPFX);
+        m_pEmitterSort = OMake<RadixSort>();
+        m_pParticleSort = OMake<RadixSort>();
+        m_camRight = m_camDir.Cross(m_camUp);
     }
 
     void ParticleSystemManager::EmitterInstance::setTransform(const Vector3& pos, const Vector3& dir, const Vector3& up)
@@ -35,16 +43,12 @@ namespace onut
     {
         if (m_pParticleSystemManager)
         {
-            auto len = m_pParticleSystemManager->m_pEmitterPool->size();
-            for (decltype(len) i = 0; i < len; ++i)
+            auto pEmitters = m_pParticleSystemManager->getInstanceEmitters(m_id);
+            if (pEmitters)
             {
-                auto pEmitter = m_pParticleSystemManager->m_pEmitterPool->at<ParticleEmitter>(i);
-                if (m_pParticleSystemManager->m_pEmitterPool->isUsed(pEmitter))
+                for (auto pEmitter : *pEmitters)
                 {
-                    if (pEmitter->getInstanceId() == m_id)
-                    {
-                        pEmitter->setRenderEnabled(renderEnabled);
-                    }
+                    pEmitter->setRenderEnabled(renderEnabled);
                 }
             }
         }
@@ -54,16 +58,12 @@ namespace onut
     {
         if (m_pParticleSystemManager)
         {
-            auto len = m_pParticleSystemManager->m_pEmitterPool->size();
-            for (decltype(len) i = 0; i < len; ++i)
+            auto pEmitters = m_pParticleSystemManager->getInstanceEmitters(m_id);
+            if (pEmitters)
             {
-                auto pEmitter = m_pParticleSystemManager->m_pEmitterPool->at<ParticleEmitter>(i);
-                if (m_pParticleSystemManager->m_pEmitterPool->isUsed(pEmitter))
+                for (auto pEmitter : *pEmitters)
                 {
-                    if (pEmitter->getInstanceId() == m_id)
-                    {
-                        pEmitter->setTransform(transform);
-                    }
+                    pEmitter->setTransform(transform);
                 }
             }
         }
@@ -73,16 +73,12 @@ namespace onut
     {
         if (m_pParticleSystemManager)
         {
-            auto len = m_pParticleSystemManager->m_pEmitterPool->size();
-            for (decltype(len) i = 0; i < len; ++i)
+            auto pEmitters = m_pParticleSystemManager->getInstanceEmitters(m_id);
+            if (pEmitters)
             {
-                auto pEmitter = m_pParticleSystemManager->m_pEmitterPool->at<ParticleEmitter>(i);
-                if (m_pParticleSystemManager->m_pEmitterPool->isUsed(pEmitter))
+                for (auto pEmitter : *pEmitters)
                 {
-                    if (pEmitter->getInstanceId() == m_id)
-                    {
-                        pEmitter->stop();
-                    }
+                    pEmitter->stop();
                 }
             }
         }
@@ -94,16 +90,12 @@ namespace onut
         if (m_bStopped) return false;
         if (m_pParticleSystemManager)
         {
-            auto len = m_pParticleSystemManager->m_pEmitterPool->size();
-            for (decltype(len) i = 0; i < len; ++i)
+            auto pEmitters = m_pParticleSystemManager->getInstanceEmitters(m_id);
+            if (pEmitters)
             {
-                auto pEmitter = m_pParticleSystemManager->m_pEmitterPool->at<ParticleEmitter>(i);
-                if (m_pParticleSystemManager->m_pEmitterPool->isUsed(pEmitter))
+                for (auto pEmitter : *pEmitters)
                 {
-                    if (pEmitter->getInstanceId() == m_id)
-                    {
-                        if (pEmitter->isAlive()) return true;
-                    }
+                    if (pEmitter->isAlive()) return true;
                 }
             }
         }
@@ -114,16 +106,12 @@ namespace onut
     {
         if (m_pParticleSystemManager)
         {
-            auto len = m_pParticleSystemManager->m_pEmitterPool->size();
-            for (decltype(len) i = 0; i < len; ++i)
+            auto pEmitters = m_pParticleSystemManager->getInstanceEmitters(m_id);
+            if (pEmitters)
             {
-                auto pEmitter = m_pParticleSystemManager->m_pEmitterPool->at<ParticleEmitter>(i);
-                if (m_pParticleSystemManager->m_pEmitterPool->isUsed(pEmitter))
+                for (auto pEmitter : *pEmitters)
                 {
-                    if (pEmitter->getInstanceId() == m_id)
-                    {
-                        if (pEmitter->isAlive()) return true;
-                    }
+                    if (pEmitter->isAlive()) return true;
                 }
             }
         }
@@ -136,16 +124,12 @@ namespace onut
         {
             bool bManageBatch = !oSpriteBatch->isInBatch();
             if (bManageBatch) oSpriteBatch->begin();
-            auto len = m_pParticleSystemManager->m_pEmitterPool->size();
-            for (decltype(len) i = 0; i < len; ++i)
+            auto pEmitters = m_pParticleSystemManager->getInstanceEmitters(m_id);
+            if (pEmitters)
             {
-                auto pEmitter = m_pParticleSystemManager->m_pEmitterPool->at<ParticleEmitter>(i);
-                if (m_pParticleSystemManager->m_pEmitterPool->isUsed(pEmitter))
+                for (auto pEmitter : *pEmitters)
                 {
-                    if (pEmitter->getInstanceId() == m_id)
-                    {
-                        pEmitter->render();
-                    }
+                    pEmitter->render();
                 }
             }
             if (bManageBatch) oSpriteBatch->end();
@@ -163,9 +147,14 @@ namespace onut
         auto& emitters = pParticleSystem->getEmitters();
         for (auto& emitter : emitters)
         {
-            auto pEmitter = m_pEmitterPool->alloc<ParticleEmitter>(emitter, OThis, transform, instance.m_id);
-            // Update the first frame right away
-            if (pEmitter) pEmitter->update();
+            auto pEmitter = m_pEmitterPool->alloc(emitter, OThis, transform, instance.m_id, pParticleSystem->getPriority());
+            if (pEmitter)
+            {
+                m_instances[instance.m_id].push_back(pEmitter);
+
+                // Update the first frame right away
+                pEmitter->update();
+            }
         }
 
         return instance;
@@ -174,26 +163,23 @@ namespace onut
     void ParticleSystemManager::clear()
     {
         m_pEmitterPool->clear();
-        m_pParticlePool->clear();
+        m_instances.clear();
+        m_particleCount = 0;
     }
 
     void ParticleSystemManager::update()
     {
         updateEmitters();
+
+        m_stats.spawned = m_spawnedCount.exchange(0, std::memory_order_relaxed);
+        m_stats.throttled = m_throttledCount.exchange(0, std::memory_order_relaxed);
+        m_stats.culled = m_culledCount.exchange(0, std::memory_order_relaxed);
+        m_stats.particleCount = getParticleCount();
     }
 
     bool ParticleSystemManager::hasAliveParticles() const
     {
-        auto len = m_pEmitterPool->size();
-        for (decltype(len) i = 0; i < len; ++i)
-        {
-            auto pEmitter = m_pEmitterPool->at<ParticleEmitter>(i);
-            if (m_pEmitterPool->isUsed(pEmitter))
-            {
-                return true;
-            }
-        }
-        return false;
+        return m_pEmitterPool->getAllocCount() > 0;
     }
 
     void ParticleSystemManager::render()
@@ -201,62 +187,316 @@ namespace onut
         oSpriteBatch->begin();
         if (m_sortEmitters)
         {
+            m_sortedEmitters.clear();
+            m_sortX.clear();
+            m_sortY.clear();
+            m_sortZ.clear();
+            for (auto pEmitter : *m_pEmitterPool)
+            {
+                if (pEmitter->getRenderEnabled() && !pEmitter->isCulled())
+                {
+                    auto position = pEmitter->getPosition();
+                    m_sortedEmitters.push_back(pEmitter);
+                    m_sortX.push_back(position.x);
+                    m_sortY.push_back(position.y);
+                    m_sortZ.push_back(position.z);
+                }
+            }
+            auto count = m_sortedEmitters.size();
+            auto pOrder = sortBackToFront(*m_pEmitterSort, m_sortX.data(), m_sortY.data(), m_sortZ.data(), count);
+            for (decltype(count) i = 0; i < count; ++i)
+            {
+                m_sortedEmitters[pOrder[i]]->render();
+            }
         }
         else
         {
-            auto len = m_pEmitterPool->size();
-            for (decltype(len) i = 0; i < len; ++i)
+            for (auto pEmitter : *m_pEmitterPool)
             {
-                auto pEmitter = m_pEmitterPool->at<ParticleEmitter>(i);
-                if (m_pEmitterPool->isUsed(pEmitter))
+                if (pEmitter->getRenderEnabled())
                 {
-                    if (pEmitter->getRenderEnabled())
-                    {
-                        pEmitter->render();
-                    }
+                    pEmitter->render();
                 }
             }
         }
         oSpriteBatch->end();
     }
 
-    Particle* ParticleSystemManager::allocParticle()
+    bool ParticleSystemManager::allocParticle(ParticlePriority priority)
+    {
+        auto budget = static_cast<size_t>(static_cast<float>(m_maxParticles) * getPriorityBudget(priority));
+
+        // Emitters can be updated from several threads at once
+        if (m_particleCount.fetch_add(1, std::memory_order_relaxed) >= budget)
+        {
+            m_particleCount.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    void ParticleSystemManager::deallocParticles(size_t count)
+    {
+        m_particleCount.fetch_sub(count, std::memory_order_relaxed);
+    }
+
+    size_t ParticleSystemManager::getParticleCount() const
+    {
+        return m_particleCount.load(std::memory_order_relaxed);
+    }
+
+    void ParticleSystemManager::addStats(size_t spawned, size_t throttled, size_t culled)
+    {
+        if (spawned) m_spawnedCount.fetch_add(spawned, std::memory_order_relaxed);
+        if (throttled) m_throttledCount.fetch_add(throttled, std::memory_order_relaxed);
+        if (culled) m_culledCount.fetch_add(culled, std::memory_order_relaxed);
+    }
+
+    const ParticleSystemManager::Stats& ParticleSystemManager::getStats() const
+    {
+        return m_stats;
+    }
+
+    void ParticleSystemManager::setPriorityBudget(ParticlePriority priority, float fraction)
+    {
+        m_priorityBudgets[static_cast<int>(priority)] = std::max(0.f, std::min(1.f, fraction));
+    }
+
+    float ParticleSystemManager::getPriorityBudget(ParticlePriority priority) const
+    {
+        return m_priorityBudgets[static_cast<int>(priority)];
+    }
+
+    void ParticleSystemManager::setThrottleThreshold(float threshold)
+    {
+        m_throttleThreshold = std::max(0.f, std::min(1.f, threshold));
+    }
+
+    float ParticleSystemManager::getThrottleThreshold() const
+    {
+        return m_throttleThreshold;
+    }
+
+    float ParticleSystemManager::getSpawnRateScale(ParticlePriority priority) const
+    {
+        if (priority == ParticlePriority::Critical) return 1.f;
+
+        auto budget = static_cast<float>(m_maxParticles) * getPriorityBudget(priority);
+        auto start = budget * m_throttleThreshold;
+        auto count = static_cast<float>(getParticleCount());
+        if (count <= start) return 1.f;
+        if (count >= budget) return 0.f;
+        return (budget - count) / (budget - start);
+    }
+
+    void ParticleSystemManager::setCullRect(const Rect& rect)
+    {
+        m_cullRect = rect;
+        m_cullRectEnabled = true;
+    }
+
+    const Rect& ParticleSystemManager::getCullRect() const
+    {
+        return m_cullRect;
+    }
+
+    void ParticleSystemManager::setCullRectEnabled(bool cullRectEnabled)
+    {
+        m_cullRectEnabled = cullRectEnabled;
+    }
+
+    bool ParticleSystemManager::getCullRectEnabled() const
+    {
+        return m_cullRectEnabled;
+    }
+
+    void ParticleSystemManager::setCullDistance(float distance)
+    {
+        m_cullDistance = distance;
+    }
+
+    float ParticleSystemManager::getCullDistance() const
+    {
+        return m_cullDistance;
+    }
+
+    bool ParticleSystemManager::isCulled(const Vector3& position, ParticlePriority priority) const
+    {
+        if (priority == ParticlePriority::Critical) return false;
+        if (m_cullRectEnabled)
+        {
+            if (position.x < m_cullRect.x || position.x > m_cullRect.x + m_cullRect.z ||
+                position.y < m_cullRect.y || position.y > m_cullRect.y + m_cullRect.w)
+            {
+                return true;
+            }
+        }
+        if (m_cullDistance > 0.f)
+        {
+            if (Vector3::DistanceSquared(position, m_camPosition) > m_cullDistance * m_cullDistance)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ParticleSystemManager::setParallelUpdate(bool parallelUpdate)
+    {
+        m_parallelUpdate = parallelUpdate;
+    }
+
+    bool ParticleSystemManager::getParallelUpdate() const
+    {
+        return m_parallelUpdate;
+    }
+
+    void ParticleSystemManager::setCamera(const Vector3& position, const Vector3& dir, const Vector3& up)
+    {
+        m_camPosition = position;
+        m_camDir = dir;
+        m_camUp = up;
+        m_camRight = dir.Cross(up);
+    }
+
+    const Vector3& ParticleSystemManager::getCameraPosition() const
+    {
+        return m_camPosition;
+    }
+
+    const Vector3& ParticleSystemManager::getCameraDir() const
+    {
+        return m_camDir;
+    }
+
+    const Vector3& ParticleSystemManager::getCameraUp() const
+    {
+        return m_camUp;
+    }
+
+    const Vector3& ParticleSystemManager::getCameraRight() const
+    {
+        return m_camRight;
+    }
+
+    void ParticleSystemManager::setSortEmitters(bool sortEmitters)
+    {
+        m_sortEmitters = sortEmitters;
+    }
+
+    bool ParticleSystemManager::getSortEmitters() const
+    {
+        return m_sortEmitters;
+    }
+
+    void ParticleSystemManager::setSortParticles(bool sortParticles)
     {
-        return m_pParticlePool->alloc<Particle>();
+        m_sortParticles = sortParticles;
     }
 
-    void ParticleSystemManager::deallocParticle(Particle* pParticle)
+    bool ParticleSystemManager::getSortParticles() const
     {
-        m_pParticlePool->dealloc(pParticle);
+        return m_sortParticles;
+    }
+
+    const uint32_t* ParticleSystemManager::sortBackToFront(RadixSort& sorter, const float* pX, const float* pY, const float* pZ, size_t count)
+    {
+        if (count == 0) return nullptr;
+
+        // Depth along the camera direction
+        if (m_depths.size() < count)
+        {
+            m_depths.resize(count);
+            m_depthKeys.resize(count);
+        }
+        auto minDepth = std::numeric_limits<float>::max();
+        auto maxDepth = std::numeric_limits<float>::lowest();
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto depth = (pX[i] - m_camPosition.x) * m_camDir.x +
+                         (pY[i] - m_camPosition.y) * m_camDir.y +
+                         (pZ[i] - m_camPosition.z) * m_camDir.z;
+            m_depths[i] = depth;
+            minDepth = std::min(minDepth, depth);
+            maxDepth = std::max(maxDepth, depth);
+        }
+
+        // Quantize to 16 bits over the visible range, farthest gets the lowest key
+        auto range = maxDepth - minDepth;
+        auto scale = range > 0.f ? 65535.f / range : 0.f;
+        for (size_t i = 0; i < count; ++i)
+        {
+            m_depthKeys[i] = static_cast<uint16_t>((maxDepth - m_depths[i]) * scale);
+        }
+
+        return sorter.sort(m_depthKeys.data(), count);
     }
 
-    void ParticleSystemManager::renderParticle(Particle* pParticle, const Vector3& camRight, const Vector3& camUp)
+    const uint32_t* ParticleSystemManager::sortParticles(const float* pX, const float* pY, const float* pZ, size_t count)
     {
-        float dim = static_cast<float>(std::max<decltype(pParticle->pTexture->getSize().x)>(pParticle->pTexture->getSize().x, pParticle->pTexture->getSize().y));
-        oSpriteBatch->drawSprite(pParticle->pTexture, pParticle->position, pParticle->color.value, pParticle->angle.value, pParticle->size.value / dim);
+        return sortBackToFront(*m_pParticleSort, pX, pY, pZ, count);
+    }
+
+    void ParticleSystemManager::deallocEmitter(ParticleEmitter* pEmitter)
+    {
+        auto it = m_instances.find(pEmitter->getInstanceId());
+        if (it != m_instances.end())
+        {
+            auto& emitters = it->second;
+            emitters.erase(std::remove(emitters.begin(), emitters.end(), pEmitter), emitters.end());
+            if (emitters.empty()) m_instances.erase(it);
+        }
+        m_pEmitterPool->dealloc(pEmitter);
+    }
+
+    ParticleSystemManager::InstanceEmitters* ParticleSystemManager::getInstanceEmitters(uint32_t id)
+    {
+        auto it = m_instances.find(id);
+        if (it == m_instances.end()) return nullptr;
+        return &it->second;
     }
 
     void ParticleSystemManager::updateEmitters()
     {
-        auto len = m_pEmitterPool->size();
-        for (decltype(len) i = 0; i < len; ++i)
+        if (m_parallelUpdate && oThreadPool && m_pEmitterPool->getAllocCount() > 1)
         {
-            auto pEmitter = m_pEmitterPool->at<ParticleEmitter>(i);
-            if (m_pEmitterPool->isUsed(pEmitter))
+            // Emitters only share the particle count, which is atomic. Dead ones
+            // are removed after the join since that reorders the alive list.
+            auto& emitters = m_pEmitterPool->getAlive();
+            auto count = emitters.size();
+            auto grain = std::max<size_t>(1, count / (oThreadPool->getWorkerCount() * 4));
+            oThreadPool->parallel_for(0, count, grain, [&emitters](size_t i)
             {
-                if (pEmitter->isAlive())
-                {
-                    pEmitter->update();
-                    if (!pEmitter->isAlive())
-                    {
-                        m_pEmitterPool->dealloc(pEmitter);
-                    }
-                }
-                else
+                auto pEmitter = emitters[i];
+                if (pEmitter->isAlive()) pEmitter->update();
+            });
+            for (size_t i = 0; i < m_pEmitterPool->getAllocCount();)
+            {
+                auto pEmitter = (*m_pEmitterPool)[i];
+                if (!pEmitter->isAlive())
                 {
-                    m_pEmitterPool->dealloc(pEmitter);
+                    deallocEmitter(pEmitter);
+                    continue;
                 }
+                ++i;
+            }
+            return;
+        }
+
+        // Dealloc swaps the last alive emitter in, so don't advance when removing
+        for (size_t i = 0; i < m_pEmitterPool->getAllocCount();)
+        {
+            auto pEmitter = (*m_pEmitterPool)[i];
+            if (pEmitter->isAlive())
+            {
+                pEmitter->update();
+            }
+            if (!pEmitter->isAlive())
+            {
+                deallocEmitter(pEmitter);
+                continue;
             }
+            ++i;
         }
     }
 };
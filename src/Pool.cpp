@@ -2,6 +2,8 @@
 #include <onut/Pool.h>
 
 // STL
+#include <algorithm>
+#include <cstddef>
 #include <memory.h>
 
 namespace onut
@@ -13,13 +15,18 @@ namespace onut
 
     Pool::Pool(size_t objSize, size_t objCount, FailAction failAction)
         : m_objCount(objCount)
-        , m_objSize(objSize)
         , m_failAction(failAction)
     {
-        static const size_t alignment = sizeof(uintptr_t);
-        static const size_t headerSize = 1;
+        static const size_t alignment = alignof(std::max_align_t);
+        static const size_t headerAlignment = alignof(Header);
 
-        m_objTotalSize = ((m_objSize + headerSize) % alignment) ? (m_objSize + headerSize) + (alignment - ((m_objSize + headerSize) % alignment)) : (m_objSize + headerSize);
+        assert(objCount <= POOL_MAX_OBJ_COUNT);
+
+        // Free objects hold the index of the next free one. Header goes right after the object.
+        m_objSize = std::max(objSize, sizeof(uint32_t));
+        if (m_objSize % headerAlignment) m_objSize += headerAlignment - (m_objSize % headerAlignment);
+        m_objTotalSize = m_objSize + sizeof(Header);
+        if (m_objTotalSize % alignment) m_objTotalSize += alignment - (m_objTotalSize % alignment);
         m_memorySize = m_objTotalSize * m_objCount + alignment;
 
         // Allocate memory
@@ -37,7 +44,11 @@ namespace onut
             m_pFirstObj = m_pMemory;
         }
 
-        m_currentObjIndex = 0;
+        for (size_t i = 0; i < m_objCount; ++i)
+        {
+            getHeader(i)->generation = 1;
+        }
+        resetFreeList();
     }
 
     Pool::~Pool()
@@ -47,11 +58,28 @@ namespace onut
 
     void Pool::clear()
     {
-        memset(m_pMemory, 0, m_memorySize);
-        m_currentObjIndex = 0;
+        for (size_t i = 0; i < m_objCount; ++i)
+        {
+            auto pHeader = getHeader(i);
+            if (pHeader->used)
+            {
+                pHeader->used = 0;
+                pHeader->generation = nextPoolGeneration(pHeader->generation);
+            }
+        }
+        resetFreeList();
         m_allocCount = 0;
     }
 
+    void Pool::resetFreeList()
+    {
+        for (size_t i = 0; i < m_objCount; ++i)
+        {
+            *reinterpret_cast<uint32_t*>(m_pFirstObj + i * m_objTotalSize) = (i + 1 < m_objCount) ? static_cast<uint32_t>(i + 1) : INVALID_INDEX;
+        }
+        m_firstFree = m_objCount ? 0 : INVALID_INDEX;
+    }
+
     size_t Pool::getAllocCount() const
     {
         return m_allocCount; 
@@ -70,12 +98,22 @@ namespace onut
     bool Pool::isUsed(void* pObject) const
     {
         auto ptr = static_cast<uint8_t*>(pObject);
-        auto used = ptr + m_objSize;
-        return (*used) ? true : false;
+        auto pHeader = reinterpret_cast<Header*>(ptr + m_objSize);
+        return pHeader->used ? true : false;
     }
 
     void* Pool::operator[](size_t index) const
     {
         return m_pFirstObj + index * m_objTotalSize;
     }
+
+    Pool::Handle Pool::getHandle(const void* pObject) const
+    {
+        auto ptr = static_cast<const uint8_t*>(pObject);
+        if (ptr < m_pFirstObj || ptr >= m_pFirstObj + m_objCount * m_objTotalSize) return INVALID_POOL_HANDLE;
+        auto index = static_cast<uint32_t>((ptr - m_pFirstObj) / m_objTotalSize);
+        auto pHeader = getHeader(index);
+        if (!pHeader->used) return INVALID_POOL_HANDLE;
+        return makePoolHandle(index, pHeader->generation);
+    }
 }
@@ -92,12 +92,14 @@ namespace onut
             return; // Nothing to flush
         }
 
+        auto previousStatsSource = oRenderer->setStatsSource(FrameStats::Source::PrimitiveBatch);
         m_pVertexBuffer->unmap(sizeof(SVertexP2T2C4) * m_vertexCount);
 
         oRenderer->renderStates.textures[0] = m_pTexture;
         oRenderer->renderStates.primitiveMode = m_primitiveType;
         oRenderer->renderStates.vertexBuffer = m_pVertexBuffer;
         oRenderer->draw(m_vertexCount);
+        oRenderer->setStatsSource(previousStatsSource);
 
         m_pMappedVertexBuffer = reinterpret_cast<SVertexP2T2C4*>(m_pVertexBuffer->map());
 
@@ -0,0 +1,74 @@
+#ifndef RADIXSORT_H_INCLUDED
+#define RADIXSORT_H_INCLUDED
+
+// STL
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace onut
+{
+    /**
+    Stable LSD radix sort, 8 bits per pass. It sorts indices, the keys are
+    left untouched. Bytes that are the same for all keys are skipped.
+    Keep the sorter around, its buffers are reused from one sort to the next.
+    */
+    class RadixSort final
+    {
+    public:
+        /**
+        @return count indices into pKeys, in ascending key order
+        */
+        template<typename Tkey>
+        const uint32_t* sort(const Tkey* pKeys, size_t count)
+        {
+            if (count == 0) return nullptr;
+            if (m_indices.size() < count)
+            {
+                m_indices.resize(count);
+                m_scratch.resize(count);
+            }
+            auto pIndices = m_indices.data();
+            auto pScratch = m_scratch.data();
+            for (size_t i = 0; i < count; ++i)
+            {
+                pIndices[i] = static_cast<uint32_t>(i);
+            }
+
+            uint32_t histogram[256];
+            for (size_t pass = 0; pass < sizeof(Tkey); ++pass)
+            {
+                auto shift = pass * 8;
+                memset(histogram, 0, sizeof(histogram));
+                for (size_t i = 0; i < count; ++i)
+                {
+                    ++histogram[(pKeys[i] >> shift) & 0xFF];
+                }
+                if (histogram[(pKeys[0] >> shift) & 0xFF] == count) continue;
+
+                uint32_t offset = 0;
+                for (auto& bucket : histogram)
+                {
+                    auto bucketCount = bucket;
+                    bucket = offset;
+                    offset += bucketCount;
+                }
+                for (size_t i = 0; i < count; ++i)
+                {
+                    auto index = pIndices[i];
+                    pScratch[histogram[(pKeys[index] >> shift) & 0xFF]++] = index;
+                }
+                std::swap(pIndices, pScratch);
+            }
+
+            return pIndices;
+        }
+
+    private:
+        std::vector<uint32_t> m_indices;
+        std::vector<uint32_t> m_scratch;
+    };
+}
+
+#endif
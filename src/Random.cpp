@@ -7,6 +7,39 @@
 
 namespace onut
 {
+    static thread_local RandomGenerator* t_pGenerator = nullptr;
+
+    static int nextRand()
+    {
+        if (t_pGenerator) return t_pGenerator->next();
+        return rand();
+    }
+
+    RandomGenerator::RandomGenerator(unsigned int seed)
+        : m_state(seed ? seed : 0x9e3779b9)
+    {
+    }
+
+    int RandomGenerator::next()
+    {
+        // xorshift32
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return static_cast<int>(m_state % (static_cast<uint32_t>(RAND_MAX) + 1));
+    }
+
+    ScopedRandomGenerator::ScopedRandomGenerator(RandomGenerator& generator)
+        : m_pPrevious(t_pGenerator)
+    {
+        t_pGenerator = &generator;
+    }
+
+    ScopedRandomGenerator::~ScopedRandomGenerator()
+    {
+        t_pGenerator = m_pPrevious;
+    }
+
     void setSeed(unsigned int seed)
     {
         srand(seed);
@@ -21,18 +54,18 @@ namespace onut
 
     int randi()
     {
-        return rand();
+        return nextRand();
     }
 
     int randi(int max)
     {
-        return rand() % (max + 1);
+        return nextRand() % (max + 1);
     }
 
     int randi(int min, int max)
     {
         auto range = max - min + 1;
-        return rand() % range + min;
+        return nextRand() % range + min;
     }
 
     bool randb()
@@ -47,7 +80,7 @@ namespace onut
 
     float randf(float max)
     {
-        auto rnd = rand();
+        auto rnd = nextRand();
         auto rndf = static_cast<double>(rnd) / static_cast<double>(RAND_MAX - 1);
         rndf *= static_cast<double>(max);
         return static_cast<float>(rndf);
@@ -55,7 +88,7 @@ namespace onut
 
     float randf(float min, float max)
     {
-        auto rnd = rand();
+        auto rnd = nextRand();
         auto rndf = static_cast<double>(rnd) / static_cast<double>(RAND_MAX - 1);
         rndf *= static_cast<double>(max - min);
         return static_cast<float>(rndf)+min;
@@ -173,12 +206,12 @@ namespace onut
     template<> unsigned int randt<unsigned int>(const unsigned int& min, const unsigned int& max)
     {
         auto range = max - min + 1;
-        return rand() % range + min;
+        return nextRand() % range + min;
     }
 
     template<> unsigned int randt<unsigned int>(const unsigned int& max)
     {
-        return rand() % (max + 1);
+        return nextRand() % (max + 1);
     }
 
     template<> float randt<float>(const float& min, const float& max)
@@ -193,7 +226,7 @@ namespace onut
 
     template<> double randt<double>(const double& min, const double& max)
     {
-        auto rnd = rand();
+        auto rnd = nextRand();
         auto rndf = static_cast<double>(rnd) / static_cast<double>(RAND_MAX - 1);
         rndf *= max - min;
         return rndf + min;
@@ -201,7 +234,7 @@ namespace onut
 
     template<> double randt<double>(const double& max)
     {
-        auto rnd = rand();
+        auto rnd = nextRand();
         auto rndf = static_cast<double>(rnd) / static_cast<double>(RAND_MAX - 1);
         rndf *= max;
         return rndf;
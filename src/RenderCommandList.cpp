@@ -0,0 +1,405 @@
+// Onut
+#include <onut/IndexBuffer.h>
+#include <onut/RenderCommandList.h>
+#include <onut/Renderer.h>
+#include <onut/Resource.h>
+#include <onut/Shader.h>
+#include <onut/Texture.h>
+#include <onut/VertexBuffer.h>
+
+// STL
+#include <cassert>
+#include <cstring>
+#include <fstream>
+
+namespace onut
+{
+    namespace
+    {
+        // Payloads are memcpy'd in the stream right after their command type byte
+        struct ResourcePayload
+        {
+            uint32_t index;
+        };
+
+        struct TexturePayload
+        {
+            int32_t slot;
+            uint32_t index;
+        };
+
+        struct UniformVectorPayload
+        {
+            uint32_t shaderIndex;
+            int32_t varId;
+            uint32_t count;
+            float values[4];
+        };
+
+        struct UniformMatrixPayload
+        {
+            uint32_t shaderIndex;
+            int32_t varId;
+            Matrix value;
+        };
+
+        // Followed by count matrices
+        struct UniformMatrixArrayPayload
+        {
+            uint32_t shaderIndex;
+            int32_t varId;
+            uint32_t count;
+        };
+
+        struct DrawIndexedPayload
+        {
+            uint32_t indexCount;
+            uint32_t startOffset;
+            uint32_t baseVertex;
+        };
+
+        static const uint32_t FILE_VERSION = 3;
+
+        template<typename Tpayload>
+        Tpayload read(const uint8_t*& pCursor)
+        {
+            Tpayload payload;
+            memcpy(&payload, pCursor, sizeof(Tpayload));
+            pCursor += sizeof(Tpayload);
+            return payload;
+        }
+
+        template<typename Ttype>
+        std::shared_ptr<Ttype> getResource(const std::vector<OResourceRef>& resources, uint32_t index)
+        {
+            if (index >= resources.size()) return nullptr;
+            return std::static_pointer_cast<Ttype>(resources[index]);
+        }
+    }
+
+    ORenderCommandListRef RenderCommandList::create()
+    {
+        return OMake<RenderCommandList>();
+    }
+
+    void RenderCommandList::reset()
+    {
+        m_stream.clear();
+        m_resources.clear();
+        m_resourceIndices.clear();
+        m_commandCount = 0;
+        m_drawCount = 0;
+    }
+
+    template<typename Tpayload>
+    void RenderCommandList::write(CommandType type, const Tpayload& payload)
+    {
+        auto offset = m_stream.size();
+        m_stream.resize(offset + 1 + sizeof(Tpayload));
+        m_stream[offset] = static_cast<uint8_t>(type);
+        memcpy(m_stream.data() + offset + 1, &payload, sizeof(Tpayload));
+        ++m_commandCount;
+    }
+
+    uint32_t RenderCommandList::addResource(const OResourceRef& pResource)
+    {
+        if (!pResource) return NO_RESOURCE;
+        auto it = m_resourceIndices.find(pResource.get());
+        if (it != m_resourceIndices.end()) return it->second;
+        auto index = static_cast<uint32_t>(m_resources.size());
+        m_resources.push_back(pResource);
+        m_resourceIndices[pResource.get()] = index;
+        return index;
+    }
+
+    void RenderCommandList::setTexture(int slot, const OTextureRef& pTexture)
+    {
+        assert(slot >= 0 && slot < RenderStates::MAX_TEXTURES);
+        write(CommandType::Texture, TexturePayload{slot, addResource(pTexture)});
+    }
+
+    void RenderCommandList::setBlendMode(BlendMode blendMode)
+    {
+        write(CommandType::BlendMode, blendMode);
+    }
+
+    void RenderCommandList::setSampleFiltering(sample::Filtering filtering)
+    {
+        write(CommandType::SampleFiltering, filtering);
+    }
+
+    void RenderCommandList::setSampleAddressMode(sample::AddressMode addressMode)
+    {
+        write(CommandType::SampleAddressMode, addressMode);
+    }
+
+    void RenderCommandList::setPrimitiveMode(PrimitiveMode primitiveMode)
+    {
+        write(CommandType::PrimitiveMode, primitiveMode);
+    }
+
+    void RenderCommandList::setDepthEnabled(bool depthEnabled)
+    {
+        write(CommandType::DepthEnabled, static_cast<uint8_t>(depthEnabled));
+    }
+
+    void RenderCommandList::setDepthWrite(bool depthWrite)
+    {
+        write(CommandType::DepthWrite, static_cast<uint8_t>(depthWrite));
+    }
+
+    void RenderCommandList::setBackFaceCull(bool backFaceCull)
+    {
+        write(CommandType::BackFaceCull, static_cast<uint8_t>(backFaceCull));
+    }
+
+    void RenderCommandList::setScissorEnabled(bool scissorEnabled)
+    {
+        write(CommandType::ScissorEnabled, static_cast<uint8_t>(scissorEnabled));
+    }
+
+    void RenderCommandList::setScissor(const iRect& scissor)
+    {
+        write(CommandType::Scissor, scissor);
+    }
+
+    void RenderCommandList::setViewport(const iRect& viewport)
+    {
+        write(CommandType::Viewport, viewport);
+    }
+
+    void RenderCommandList::setWorld(const Matrix& world)
+    {
+        write(CommandType::World, world);
+    }
+
+    void RenderCommandList::setView(const Matrix& view)
+    {
+        write(CommandType::View, view);
+    }
+
+    void RenderCommandList::setProjection(const Matrix& projection)
+    {
+        write(CommandType::Projection, projection);
+    }
+
+    void RenderCommandList::setVertexShader(const OShaderRef& pShader)
+    {
+        write(CommandType::VertexShader, ResourcePayload{addResource(pShader)});
+    }
+
+    void RenderCommandList::setPixelShader(const OShaderRef& pShader)
+    {
+        write(CommandType::PixelShader, ResourcePayload{addResource(pShader)});
+    }
+
+    void RenderCommandList::setVertexBuffer(const OVertexBufferRef& pVertexBuffer)
+    {
+        write(CommandType::VertexBuffer, ResourcePayload{addResource(pVertexBuffer)});
+    }
+
+    void RenderCommandList::setIndexBuffer(const OIndexBufferRef& pIndexBuffer)
+    {
+        write(CommandType::IndexBuffer, ResourcePayload{addResource(pIndexBuffer)});
+    }
+
+    void RenderCommandList::setUniform(const OShaderRef& pShader, int varId, const float* pValues, uint8_t count)
+    {
+        assert(pShader);
+        UniformVectorPayload payload;
+        payload.shaderIndex = addResource(pShader);
+        payload.varId = varId;
+        payload.count = count;
+        memset(payload.values, 0, sizeof(payload.values));
+        memcpy(payload.values, pValues, sizeof(float) * count);
+        write(CommandType::UniformVector, payload);
+    }
+
+    void RenderCommandList::setFloat(const OShaderRef& pShader, int varId, float value)
+    {
+        setUniform(pShader, varId, &value, 1);
+    }
+
+    void RenderCommandList::setVector2(const OShaderRef& pShader, int varId, const Vector2& value)
+    {
+        setUniform(pShader, varId, &value.x, 2);
+    }
+
+    void RenderCommandList::setVector3(const OShaderRef& pShader, int varId, const Vector3& value)
+    {
+        setUniform(pShader, varId, &value.x, 3);
+    }
+
+    void RenderCommandList::setVector4(const OShaderRef& pShader, int varId, const Vector4& value)
+    {
+        setUniform(pShader, varId, &value.x, 4);
+    }
+
+    void RenderCommandList::setMatrix(const OShaderRef& pShader, int varId, const Matrix& value)
+    {
+        assert(pShader);
+        write(CommandType::UniformMatrix, UniformMatrixPayload{addResource(pShader), varId, value});
+    }
+
+    void RenderCommandList::setMatrixArray(const OShaderRef& pShader, int varId, const Matrix* pValues, int count)
+    {
+        assert(pShader);
+        assert(count >= 0);
+        write(CommandType::UniformMatrixArray, UniformMatrixArrayPayload{addResource(pShader), varId, static_cast<uint32_t>(count)});
+        auto offset = m_stream.size();
+        m_stream.resize(offset + sizeof(Matrix) * count);
+        if (count) memcpy(m_stream.data() + offset, pValues, sizeof(Matrix) * count);
+    }
+
+    void RenderCommandList::draw(uint32_t vertexCount)
+    {
+        write(CommandType::Draw, vertexCount);
+        ++m_drawCount;
+    }
+
+    void RenderCommandList::drawIndexed(uint32_t indexCount, uint32_t startOffset, uint32_t baseVertex)
+    {
+        write(CommandType::DrawIndexed, DrawIndexedPayload{indexCount, startOffset, baseVertex});
+        ++m_drawCount;
+    }
+
+    void RenderCommandList::execute(Renderer& renderer) const
+    {
+        auto& states = renderer.renderStates;
+        std::vector<Matrix> matrices; // Matrix arrays are copied out of the stream, it's not aligned
+        auto pCursor = m_stream.data();
+        auto pEnd = pCursor + m_stream.size();
+        while (pCursor < pEnd)
+        {
+            auto type = static_cast<CommandType>(*pCursor++);
+            switch (type)
+            {
+                case CommandType::Texture:
+                {
+                    auto payload = read<TexturePayload>(pCursor);
+                    states.textures[payload.slot] = getResource<Texture>(m_resources, payload.index);
+                    break;
+                }
+                case CommandType::BlendMode:
+                    states.blendMode = read<BlendMode>(pCursor);
+                    break;
+                case CommandType::SampleFiltering:
+                    states.sampleFiltering = read<sample::Filtering>(pCursor);
+                    break;
+                case CommandType::SampleAddressMode:
+                    states.sampleAddressMode = read<sample::AddressMode>(pCursor);
+                    break;
+                case CommandType::PrimitiveMode:
+                    states.primitiveMode = read<PrimitiveMode>(pCursor);
+                    break;
+                case CommandType::DepthEnabled:
+                    states.depthEnabled = read<uint8_t>(pCursor) != 0;
+                    break;
+                case CommandType::DepthWrite:
+                    states.depthWrite = read<uint8_t>(pCursor) != 0;
+                    break;
+                case CommandType::BackFaceCull:
+                    states.backFaceCull = read<uint8_t>(pCursor) != 0;
+                    break;
+                case CommandType::ScissorEnabled:
+                    states.scissorEnabled = read<uint8_t>(pCursor) != 0;
+                    break;
+                case CommandType::Scissor:
+                    states.scissor = read<iRect>(pCursor);
+                    break;
+                case CommandType::Viewport:
+                    states.viewport = read<iRect>(pCursor);
+                    break;
+                case CommandType::World:
+                    states.world = read<Matrix>(pCursor);
+                    break;
+                case CommandType::View:
+                    states.view = read<Matrix>(pCursor);
+                    break;
+                case CommandType::Projection:
+                    states.projection = read<Matrix>(pCursor);
+                    break;
+                case CommandType::VertexShader:
+                    states.vertexShader = getResource<Shader>(m_resources, read<ResourcePayload>(pCursor).index);
+                    break;
+                case CommandType::PixelShader:
+                    states.pixelShader = getResource<Shader>(m_resources, read<ResourcePayload>(pCursor).index);
+                    break;
+                case CommandType::VertexBuffer:
+                    states.vertexBuffer = getResource<VertexBuffer>(m_resources, read<ResourcePayload>(pCursor).index);
+                    break;
+                case CommandType::IndexBuffer:
+                    states.indexBuffer = getResource<IndexBuffer>(m_resources, read<ResourcePayload>(pCursor).index);
+                    break;
+                case CommandType::UniformVector:
+                {
+                    auto payload = read<UniformVectorPayload>(pCursor);
+                    auto pShader = getResource<Shader>(m_resources, payload.shaderIndex);
+                    if (!pShader) break;
+                    switch (payload.count)
+                    {
+                        case 1: pShader->setFloat(payload.varId, payload.values[0]); break;
+                        case 2: pShader->setVector2(payload.varId, Vector2(payload.values[0], payload.values[1])); break;
+                        case 3: pShader->setVector3(payload.varId, Vector3(payload.values[0], payload.values[1], payload.values[2])); break;
+                        case 4: pShader->setVector4(payload.varId, Vector4(payload.values[0], payload.values[1], payload.values[2], payload.values[3])); break;
+                    }
+                    break;
+                }
+                case CommandType::UniformMatrix:
+                {
+                    auto payload = read<UniformMatrixPayload>(pCursor);
+                    auto pShader = getResource<Shader>(m_resources, payload.shaderIndex);
+                    if (pShader) pShader->setMatrix(payload.varId, payload.value);
+                    break;
+                }
+                case CommandType::UniformMatrixArray:
+                {
+                    auto payload = read<UniformMatrixArrayPayload>(pCursor);
+                    matrices.resize(payload.count);
+                    if (payload.count) memcpy(matrices.data(), pCursor, sizeof(Matrix) * payload.count);
+                    pCursor += sizeof(Matrix) * payload.count;
+                    auto pShader = getResource<Shader>(m_resources, payload.shaderIndex);
+                    if (pShader) pShader->setMatrixArray(payload.varId, matrices.data(), static_cast<int>(payload.count));
+                    break;
+                }
+                case CommandType::Draw:
+                    renderer.draw(read<uint32_t>(pCursor));
+                    break;
+                case CommandType::DrawIndexed:
+                {
+                    auto payload = read<DrawIndexedPayload>(pCursor);
+                    renderer.drawIndexed(payload.indexCount, payload.startOffset, payload.baseVertex);
+                    break;
+                }
+                default:
+                    assert(false); // Corrupted stream
+                    return;
+            }
+        }
+    }
+
+    bool RenderCommandList::save(const std::string& filename) const
+    {
+        std::ofstream file(filename, std::ios::binary);
+        if (!file.is_open()) return false;
+
+        auto writeU32 = [&file](uint32_t value)
+        {
+            file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        };
+
+        file.write("ORCL", 4);
+        writeU32(FILE_VERSION);
+        writeU32(static_cast<uint32_t>(m_commandCount));
+        writeU32(static_cast<uint32_t>(m_stream.size()));
+        file.write(reinterpret_cast<const char*>(m_stream.data()), m_stream.size());
+        writeU32(static_cast<uint32_t>(m_resources.size()));
+        for (auto& pResource : m_resources)
+        {
+            auto& name = pResource->getName();
+            writeU32(static_cast<uint32_t>(name.size()));
+            file.write(name.c_str(), name.size());
+        }
+        return file.good();
+    }
+}
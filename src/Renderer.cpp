@@ -1,5 +1,6 @@
 // Onut
 #include <onut/IndexBuffer.h>
+#include <onut/RenderCommandList.h>
 #include <onut/Renderer.h>
 #include <onut/Settings.h>
 #include <onut/Shader.h>
@@ -185,6 +186,28 @@ namespace onut
         clearColor.pop();
     }
 
+    template<typename Tindex>
+    static OIndexBufferRef createQuadIndices(uint32_t quadCount)
+    {
+        std::vector<Tindex> indices(quadCount * 6);
+        for (uint32_t i = 0; i < quadCount; ++i)
+        {
+            indices[i * 6 + 0] = static_cast<Tindex>(i * 4 + 0);
+            indices[i * 6 + 1] = static_cast<Tindex>(i * 4 + 1);
+            indices[i * 6 + 2] = static_cast<Tindex>(i * 4 + 2);
+            indices[i * 6 + 3] = static_cast<Tindex>(i * 4 + 2);
+            indices[i * 6 + 4] = static_cast<Tindex>(i * 4 + 3);
+            indices[i * 6 + 5] = static_cast<Tindex>(i * 4 + 0);
+        }
+        return OIndexBuffer::createStatic(indices.data(), static_cast<uint32_t>(indices.size() * sizeof(Tindex)), static_cast<int>(sizeof(Tindex) * 8));
+    }
+
+    OIndexBufferRef Renderer::createQuadIndexBuffer(uint32_t quadCount)
+    {
+        if (quadCount <= QUAD_INDEX_BUFFER_QUAD_COUNT) return createQuadIndices<uint16_t>(quadCount);
+        return createQuadIndices<uint32_t>(quadCount);
+    }
+
     Renderer::Renderer()
     {
     }
@@ -205,6 +228,16 @@ namespace onut
             1, 1
         };
         m_pEffectsVertexBuffer = OVertexBuffer::createStatic(vertices, sizeof(vertices));
+        m_pQuadIndexBuffer = createQuadIndexBuffer(QUAD_INDEX_BUFFER_QUAD_COUNT);
+        m_pBufferArenas[(int)BufferArena::Type::Vertex] = BufferArena::create(BufferArena::Type::Vertex);
+        m_pBufferArenas[(int)BufferArena::Type::Index16] = BufferArena::create(BufferArena::Type::Index16, BufferArena::DEFAULT_PAGE_SIZE / 4);
+        m_pBufferArenas[(int)BufferArena::Type::Index32] = BufferArena::create(BufferArena::Type::Index32, BufferArena::DEFAULT_PAGE_SIZE / 4);
+    }
+
+    void Renderer::execute(const ORenderCommandListRef& pCommandList)
+    {
+        if (!pCommandList) return;
+        pCommandList->execute(*this);
     }
 
     void Renderer::setupFor2D()
@@ -335,6 +368,10 @@ namespace onut
         {
             m_p2DVertexShader = OShader::createFromSource(SHADER_SRC_2D_VS, OVertexShader);
             m_p2DPixelShader = OShader::createFromSource(SHADER_SRC_2D_PS, OPixelShader);
+            m_p2DMultiTextureVertexShader = OShader::createFromSource(SHADER_SRC_2D_MULTI_TEXTURE_VS, OVertexShader);
+            m_p2DMultiTexturePixelShader = OShader::createFromSource(SHADER_SRC_2D_MULTI_TEXTURE_PS, OPixelShader);
+            m_p2DPackedColorVertexShader = OShader::createFromSource(SHADER_SRC_2D_PACKED_COLOR_VS, OVertexShader);
+            m_p2DMultiTexturePackedColorVertexShader = OShader::createFromSource(SHADER_SRC_2D_MULTI_TEXTURE_PACKED_COLOR_VS, OVertexShader);
         }
 
         // Create 3D shaders
@@ -527,6 +564,95 @@ namespace onut
         draw(6);
     }
 
+    const char* FrameStats::getSourceName(Source source)
+    {
+        switch (source)
+        {
+            case Source::Other: return "Other";
+            case Source::SpriteBatch: return "SpriteBatch";
+            case Source::PrimitiveBatch: return "PrimitiveBatch";
+            case Source::TiledMap: return "TiledMap";
+            case Source::Model: return "Model";
+            case Source::Imgui: return "Imgui";
+            default: return "";
+        }
+    }
+
+    const char* FrameStats::getCounterName(Counter counter)
+    {
+        switch (counter)
+        {
+            case Counter::DrawCalls: return "drawCalls";
+            case Counter::Vertices: return "vertices";
+            case Counter::TextureBinds: return "textureBinds";
+            case Counter::ShaderChanges: return "shaderChanges";
+            case Counter::StateChanges: return "stateChanges";
+            case Counter::UniformUploads: return "uniformUploads";
+            case Counter::UploadedBytes: return "uploadedBytes";
+            default: return "";
+        }
+    }
+
+    FrameStats::Source Renderer::setStatsSource(FrameStats::Source source)
+    {
+        auto previous = m_statsSource;
+        m_statsSource = source;
+        return previous;
+    }
+
+    void Renderer::addDirtyStateStats()
+    {
+        uint32_t textureBinds = 0;
+        for (const auto& texture : renderStates.textures)
+        {
+            if (texture.isDirty()) ++textureBinds;
+        }
+        if (textureBinds) addStat(FrameStats::Counter::TextureBinds, textureBinds);
+
+        if (renderStates.vertexShader.isDirty() || renderStates.pixelShader.isDirty())
+        {
+            addStat(FrameStats::Counter::ShaderChanges);
+        }
+
+        uint32_t stateChanges = 0;
+        for (const auto& renderTarget : renderStates.renderTargets)
+        {
+            if (renderTarget.isDirty()) ++stateChanges;
+        }
+        if (renderStates.blendMode.isDirty()) ++stateChanges;
+        if (renderStates.sampleFiltering.isDirty()) ++stateChanges;
+        if (renderStates.sampleAddressMode.isDirty()) ++stateChanges;
+        if (renderStates.viewport.isDirty()) ++stateChanges;
+        if (renderStates.scissorEnabled.get() && renderStates.scissor.isDirty()) ++stateChanges;
+        if (renderStates.projection.isDirty()) ++stateChanges;
+        if (renderStates.view.isDirty()) ++stateChanges;
+        if (renderStates.world.isDirty()) ++stateChanges;
+        if (renderStates.wireframe.isDirty()) ++stateChanges;
+        if (renderStates.depthEnabled.isDirty()) ++stateChanges;
+        if (renderStates.depthWrite.isDirty()) ++stateChanges;
+        if (renderStates.backFaceCull.isDirty()) ++stateChanges;
+        if (renderStates.scissorEnabled.isDirty()) ++stateChanges;
+        if (renderStates.primitiveMode.isDirty()) ++stateChanges;
+        if (renderStates.vertexBuffer.isDirty()) ++stateChanges;
+        if (renderStates.indexBuffer.isDirty()) ++stateChanges;
+        if (stateChanges) addStat(FrameStats::Counter::StateChanges, stateChanges);
+    }
+
+    void Renderer::endFrameStats()
+    {
+        auto& stats = m_currentFrameStats;
+        for (int counter = 0; counter < (int)FrameStats::Counter::COUNT; ++counter)
+        {
+            stats.totals[counter] = 0;
+            for (int source = 0; source < (int)FrameStats::Source::COUNT; ++source)
+            {
+                stats.totals[counter] += stats.counters[source][counter];
+            }
+        }
+        m_frameStats = stats;
+        m_currentFrameStats = FrameStats();
+    }
+
     Point Renderer::getResolution() const
     {
         auto& pRenderTarget = renderStates.renderTargets[0].get();
@@ -561,7 +561,8 @@ namespace onut
         else
         {
             m_pSwapChain->Present(1, 0);
-        }
+        }        }
+        endFrameStats();
     }
 
     ID3D11Device* RendererD3D11::getDevice() const
@@ -599,16 +600,22 @@ namespace onut
     {
         applyRenderStates();
         m_pDeviceContext->Draw(static_cast<UINT>(vertexCount), 0);
+        addStat(FrameStats::Counter::DrawCalls);
+        addStat(FrameStats::Counter::Vertices, vertexCount);
     }
 
-    void RendererD3D11::drawIndexed(uint32_t indexCount, uint32_t startOffset)
+    void RendererD3D11::drawIndexed(uint32_t indexCount, uint32_t startOffset, uint32_t baseVertex)
     {
         applyRenderStates();
-        m_pDeviceContext->DrawIndexed(static_cast<UINT>(indexCount), static_cast<UINT>(startOffset), 0);
+        m_pDeviceContext->DrawIndexed(static_cast<UINT>(indexCount), static_cast<UINT>(startOffset), static_cast<INT>(baseVertex));
+        addStat(FrameStats::Counter::DrawCalls);
+        addStat(FrameStats::Counter::Vertices, indexCount);
     }
 
     void RendererD3D11::applyRenderStates()
     {
+        addDirtyStateStats();
+
         // Render target
         bool isFirstRTDirty = false;
         bool hasDirtyRT = false;
@@ -681,8 +688,9 @@ namespace onut
                 m_boundTextures[i] = pTextureState.get();
                 if (pTextureState.get() != nullptr)
                 {
+                    assert(!pTextureState.get()->getAtlasPage()); // Packed textures can only be drawn with SpriteBatch
                     auto pRenderTargetD3D11 = ODynamicCast<OTextureD3D11>(pTextureState.get());
-                    pResourceView = pRenderTargetD3D11->getD3DResourceView();
+                    if (pRenderTargetD3D11) pResourceView = pRenderTargetD3D11->getD3DResourceView();
                 }
                 m_pDeviceContext->PSSetShaderResources(static_cast<UINT>(i), 1, &pResourceView);
                 m_pDeviceContext->VSSetShaderResources(static_cast<UINT>(i), 1, &pResourceView);
@@ -762,6 +770,7 @@ namespace onut
             m_pDeviceContext->Map(m_pModelBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map);
             memcpy(map.pData, &finalModel._11, sizeof(finalModel));
             m_pDeviceContext->Unmap(m_pModelBuffer, 0);
+            addStat(FrameStats::Counter::UniformUploads, 2);
             m_pDeviceContext->VSSetConstantBuffers(1, 1, &m_pModelBuffer);
 
             renderStates.projection.resetDirty();
@@ -819,26 +828,10 @@ namespace onut
                 m_pDeviceContext->IASetInputLayout(pShaderD3D11->getInputLayout());
                 renderStates.vertexShader.resetDirty();
 
-                auto& uniforms = pShaderD3D11->getUniforms();
-                for (UINT i = 0; i < (UINT)uniforms.size(); ++i)
-                {
-                    m_pDeviceContext->VSSetConstantBuffers(4 + i, 1, &(uniforms[i].pBuffer));
-                    uniforms[i].dirty = false;
-                }
-            }
-            else
-            {
-                auto& uniforms = pShaderD3D11->getUniforms();
-                for (UINT i = 0; i < (UINT)uniforms.size(); ++i)
-                {
-                    auto& uniform = uniforms[i];
-                    if (uniform.dirty)
-                    {
-                        m_pDeviceContext->VSSetConstantBuffers(4 + i, 1, &(uniform.pBuffer));
-                        uniform.dirty = false;
-                    }
-                }
+                auto pUniformBuffer = pShaderD3D11->getUniformBuffer();
+                m_pDeviceContext->VSSetConstantBuffers(ShaderD3D11::UNIFORM_BUFFER_SLOT, 1, &pUniformBuffer);
             }
+            pShaderD3D11->updateUniformBuffer(m_pDeviceContext);
         }
 
         pShaderD3D11 = pPixelShaderD3D11;
@@ -848,26 +841,10 @@ namespace onut
             {
                 m_pDeviceContext->PSSetShader(pShaderD3D11->getPixelShader(), nullptr, 0);
 
-                auto& uniforms = pShaderD3D11->getUniforms();
-                for (UINT i = 0; i < (UINT)uniforms.size(); ++i)
-                {
-                    m_pDeviceContext->PSSetConstantBuffers(4 + i, 1, &(uniforms[i].pBuffer));
-                    uniforms[i].dirty = false;
-                }
-            }
-            else
-            {
-                auto& uniforms = pShaderD3D11->getUniforms();
-                for (UINT i = 0; i < (UINT)uniforms.size(); ++i)
-                {
-                    auto& uniform = uniforms[i];
-                    if (uniform.dirty)
-                    {
-                        m_pDeviceContext->PSSetConstantBuffers(4 + i, 1, &(uniform.pBuffer));
-                        uniform.dirty = false;
-                    }
-                }
+                auto pUniformBuffer = pShaderD3D11->getUniformBuffer();
+                m_pDeviceContext->PSSetConstantBuffers(ShaderD3D11::UNIFORM_BUFFER_SLOT, 1, &pUniformBuffer);
             }
+            pShaderD3D11->updateUniformBuffer(m_pDeviceContext);
         }
 
         // Sampler state
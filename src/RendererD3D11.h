@@ -27,7 +27,7 @@ namespace onut
         void endFrame();
 
         void draw(uint32_t vertexCount) override;
-        void drawIndexed(uint32_t indexCount, uint32_t startOffset = 0) override;
+        void drawIndexed(uint32_t indexCount, uint32_t startOffset = 0, uint32_t baseVertex = 0) override;
 
         Point getTrueResolution() const override;
         void onResize(const Point& newSize);
@@ -21,6 +21,7 @@
 
 // STL
 #include <cassert>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <vector>
@@ -169,6 +170,7 @@ namespace onut
 #else
         SDL_GL_SwapWindow(m_pSDLWindow);
 #endif
+        endFrameStats();
     }
 
     Point RendererGL::getTrueResolution() const
@@ -190,8 +192,16 @@ namespace onut
         glClear(GL_DEPTH_BUFFER_BIT);
     }
 
+    void RendererGL::setAttribBaseVertex(uint32_t baseVertex)
+    {
+        if (baseVertex == m_attribBaseVertex) return;
+        m_attribBaseVertex = baseVertex;
+        renderStates.vertexBuffer.forceDirty();
+    }
+
     void RendererGL::draw(uint32_t vertexCount)
     {
+        setAttribBaseVertex(0);
         applyRenderStates();
         
         GLenum mode = GL_POINTS;
@@ -217,10 +227,15 @@ namespace onut
         }
 
         glDrawArrays(mode, 0, vertexCount);
+        addStat(FrameStats::Counter::DrawCalls);
+        addStat(FrameStats::Counter::Vertices, vertexCount);
     }
 
-    void RendererGL::drawIndexed(uint32_t indexCount, uint32_t startOffset)
+    void RendererGL::drawIndexed(uint32_t indexCount, uint32_t startOffset, uint32_t baseVertex)
     {
+        // Without glDrawElementsBaseVertex, offset the attributes instead
+        static const bool HAS_BASE_VERTEX = hasBaseVertex();
+        setAttribBaseVertex(HAS_BASE_VERTEX ? 0 : baseVertex);
         applyRenderStates();
         
         GLenum mode = GL_POINTS;
@@ -245,14 +260,68 @@ namespace onut
                 break;
         }
 
-        if (std::dynamic_pointer_cast<IndexBufferGL>(renderStates.indexBuffer.get())->getTypeSize() == 16)
+        auto pIndexBufferGL = static_cast<IndexBufferGL*>(renderStates.indexBuffer.get().get());
+        uintptr_t offset = pIndexBufferGL->getOffset();
+        GLenum type = GL_UNSIGNED_INT;
+        if (pIndexBufferGL->getTypeSize() == 16)
+        {
+            type = GL_UNSIGNED_SHORT;
+            offset += startOffset * sizeof(uint16_t);
+        }
+        else
         {
-            glDrawElements(mode, indexCount, GL_UNSIGNED_SHORT, (const void*)(uintptr_t)(startOffset * sizeof(uint16_t)));
+            offset += startOffset * sizeof(uint32_t);
+        }
+#if defined(GL_VERSION_3_2) || defined(GL_ARB_draw_elements_base_vertex)
+        if (HAS_BASE_VERTEX && baseVertex)
+        {
+            glDrawElementsBaseVertex(mode, indexCount, type, (const void*)offset, static_cast<GLint>(baseVertex));
         }
         else
+#endif
         {
-            glDrawElements(mode, indexCount, GL_UNSIGNED_INT, (const void*)(uintptr_t)(startOffset * sizeof(uint32_t)));
+            glDrawElements(mode, indexCount, type, (const void*)offset);
         }
+        addStat(FrameStats::Counter::DrawCalls);
+        addStat(FrameStats::Counter::Vertices, indexCount);
+    }
+
+    bool RendererGL::hasBaseVertex()
+    {
+#if defined(GL_VERSION_3_2) || defined(GL_ARB_draw_elements_base_vertex)
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (major > 3 || (major == 3 && minor >= 2)) return true;
+        return hasExtension("GL_ARB_draw_elements_base_vertex");
+#else
+        return false;
+#endif
+    }
+
+    bool RendererGL::hasExtension(const char* szName)
+    {
+        auto szExtensions = (const char*)glGetString(GL_EXTENSIONS);
+        if (szExtensions)
+        {
+            auto len = strlen(szName);
+            for (auto szFound = strstr(szExtensions, szName); szFound; szFound = strstr(szFound + len, szName))
+            {
+                if ((szFound == szExtensions || szFound[-1] == ' ') &&
+                    (szFound[len] == ' ' || szFound[len] == '\0')) return true;
+            }
+            return false;
+        }
+
+        // Core profiles only list them one by one
+        GLint extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+        for (GLint i = 0; i < extensionCount; ++i)
+        {
+            auto szExtension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if (szExtension && !strcmp(szExtension, szName)) return true;
+        }
+        return false;
     }
 
     void RendererGL::attachDepthBuffer(const Point& size)
@@ -271,6 +340,8 @@ namespace onut
 
     void RendererGL::applyRenderStates()
     {
+        addDirtyStateStats();
+
         // Clear color
         if (renderStates.clearColor.isDirty())
         {
@@ -470,6 +541,7 @@ namespace onut
         }
 
         // Shaders
+        uint32_t uniformUploads = 0;
         bool programDirty = false;
         OShaderGL::Program* pProgram = nullptr;
         if (renderStates.vertexShader.get() &&
@@ -486,113 +558,41 @@ namespace onut
             {
                 programDirty = true;
                 glUseProgram(pProgram->program);
+            }
 
-                // Update all uniforms
-                for (int i = 0; i < (int)pVSRaw->m_uniforms.size(); ++i)
-                {
-                    auto& uniform = pVSRaw->m_uniforms[i];
-                    auto uniformId = pProgram->uniformsVS[i];
-                    if (uniformId == -1) continue;
-                    switch (uniform.type)
-                    {
-                    case Shader::VarType::Float:
-                        glUniform1f(uniformId, uniform.value._11);
-                        break;
-                    case Shader::VarType::Float2:
-                        glUniform2fv(uniformId, 1, &uniform.value._11);
-                        break;
-                    case Shader::VarType::Float3:
-                        glUniform3fv(uniformId, 1, &uniform.value._11);
-                        break;
-                    case Shader::VarType::Float4:
-                        glUniform4fv(uniformId, 1, &uniform.value._11);
-                        break;
-                    case Shader::VarType::Matrix:
-                        glUniformMatrix4fv(uniformId, 1, GL_FALSE, &uniform.value._11);
-                        break;
-                    }
-                    uniform.dirty = false;
-                }
-                for (int i = 0; i < (int)pPSRaw->m_uniforms.size(); ++i)
+            if (ShaderGL::hasUniformBlocks())
+            {
+                // Each shader has its own block, bound to the program's binding points
+                if (programDirty)
                 {
-                    auto& uniform = pPSRaw->m_uniforms[i];
-                    auto uniformId = pProgram->uniformsPS[i];
-                    if (uniformId == -1) continue;
-                    switch (uniform.type)
-                    {
-                    case Shader::VarType::Float:
-                        glUniform1f(uniformId, uniform.value._11);
-                        break;
-                    case Shader::VarType::Float2:
-                        glUniform2fv(uniformId, 1, &uniform.value._11);
-                        break;
-                    case Shader::VarType::Float3:
-                        glUniform3fv(uniformId, 1, &uniform.value._11);
-                        break;
-                    case Shader::VarType::Float4:
-                        glUniform4fv(uniformId, 1, &uniform.value._11);
-                        break;
-                    case Shader::VarType::Matrix:
-                        glUniformMatrix4fv(uniformId, 1, GL_FALSE, &uniform.value._11);
-                        break;
-                    }
-                    uniform.dirty = false;
+                    glBindBufferBase(GL_UNIFORM_BUFFER, ShaderGL::VS_UNIFORM_BLOCK_BINDING, pVSRaw->m_uniformBuffer);
+                    glBindBufferBase(GL_UNIFORM_BUFFER, ShaderGL::PS_UNIFORM_BLOCK_BINDING, pPSRaw->m_uniformBuffer);
                 }
+                if (pVSRaw->updateUniformBlock()) ++uniformUploads;
+                if (pPSRaw->updateUniformBlock()) ++uniformUploads;
             }
             else
             {
-                // Only update uniforms that are dirty in that case
+                // Update all uniforms when the program changes, only the dirty ones otherwise
                 for (int i = 0; i < (int)pVSRaw->m_uniforms.size(); ++i)
                 {
                     auto& uniform = pVSRaw->m_uniforms[i];
-                    if (!uniform.dirty) continue;
+                    if (!uniform.dirty && !programDirty) continue;
                     uniform.dirty = false;
                     auto uniformId = pProgram->uniformsVS[i];
                     if (uniformId == -1) continue;
-                    switch (uniform.type)
-                    {
-                    case Shader::VarType::Float:
-                        glUniform1f(uniformId, uniform.value._11);
-                        break;
-                    case Shader::VarType::Float2:
-                        glUniform2fv(uniformId, 1, &uniform.value._11);
-                        break;
-                    case Shader::VarType::Float3:
-                        glUniform3fv(uniformId, 1, &uniform.value._11);
-                        break;
-                    case Shader::VarType::Float4:
-                        glUniform4fv(uniformId, 1, &uniform.value._11);
-                        break;
-                    case Shader::VarType::Matrix:
-                        glUniformMatrix4fv(uniformId, 1, GL_FALSE, &uniform.value._11);
-                        break;
-                    }
+                    ++uniformUploads;
+                    pVSRaw->uploadUniform(uniformId, uniform);
                 }
                 for (int i = 0; i < (int)pPSRaw->m_uniforms.size(); ++i)
                 {
                     auto& uniform = pPSRaw->m_uniforms[i];
-                    if (!uniform.dirty) continue;
+                    if (!uniform.dirty && !programDirty) continue;
                     uniform.dirty = false;
                     auto uniformId = pProgram->uniformsPS[i];
                     if (uniformId == -1) continue;
-                    switch (uniform.type)
-                    {
-                    case Shader::VarType::Float:
-                        glUniform1f(uniformId, uniform.value._11);
-                        break;
-                    case Shader::VarType::Float2:
-                        glUniform2fv(uniformId, 1, &uniform.value._11);
-                        break;
-                    case Shader::VarType::Float3:
-                        glUniform3fv(uniformId, 1, &uniform.value._11);
-                        break;
-                    case Shader::VarType::Float4:
-                        glUniform4fv(uniformId, 1, &uniform.value._11);
-                        break;
-                    case Shader::VarType::Matrix:
-                        glUniformMatrix4fv(uniformId, 1, GL_FALSE, &uniform.value._11);
-                        break;
-                    }
+                    ++uniformUploads;
+                    pPSRaw->uploadUniform(uniformId, uniform);
                 }
             }
 
@@ -627,13 +627,16 @@ namespace onut
                 if (pProgram && pProgram->oViewProjectionUniform != -1)
                 {
                     glUniformMatrix4fv(pProgram->oViewProjectionUniform, 1, GL_FALSE, &finalTransform._11);
+                    ++uniformUploads;
                 }
                 if (pProgram && pProgram->oModelUniform != -1)
                 {
                     glUniformMatrix4fv(pProgram->oModelUniform, 1, GL_FALSE, &finalModel._11);
+                    ++uniformUploads;
                 }
             }
         }
+        if (uniformUploads) addStat(FrameStats::Counter::UniformUploads, uniformUploads);
 
         // Textures
         auto pShaderGL_ps_s = ODynamicCast<OShaderGL>(renderStates.pixelShader.get());
@@ -646,11 +649,16 @@ namespace onut
         for (int i = 0; i < RenderStates::MAX_TEXTURES; ++i)
         {
             auto& pTextureState = renderStates.textures[i];
-            if (pTextureState.isDirty() || (isSampleDirty && i == 0) || 
+            if (pTextureState.isDirty() || isSampleDirty || 
                 renderStates.pixelShader.isDirty() || 
                 renderStates.vertexShader.isDirty())
             {
                 auto pTexture = pTextureState.get().get();
+                if (pTexture != nullptr && pTexture->getAtlasPage())
+                {
+                    assert(false); // Packed textures can only be drawn with SpriteBatch
+                    pTexture = nullptr;
+                }
                 if (pTexture != nullptr)
                 {
                     auto pTextureGL = static_cast<TextureGL*>(pTexture);
@@ -811,7 +819,7 @@ namespace onut
                     glEnableVertexAttribArray(i);
                 }
 
-                int offset = 0;
+                uintptr_t offset = pVBRaw->getOffset();
                 int dataSize = 0;
                 for (int i = 0; i < attribCount; ++i)
                 {
@@ -829,8 +837,12 @@ namespace onut
                     case Shader::VarType::Float4:
                         dataSize += 4 * 4;
                         break;
+                    case Shader::VarType::UByte4:
+                        dataSize += 4;
+                        break;
                     }
                 }
+                offset += m_attribBaseVertex * dataSize;
                 for (int i = 0; i < attribCount; ++i)
                 {
                     int size = 0;
@@ -848,6 +860,10 @@ namespace onut
                     case Shader::VarType::Float4:
                         size = 4;
                         break;
+                    case Shader::VarType::UByte4:
+                        glVertexAttribPointer(i, 4, GL_UNSIGNED_BYTE, GL_TRUE, dataSize, (uint8_t*)(uintptr_t)offset);
+                        offset += 4;
+                        continue;
                     }
                     glVertexAttribPointer(i, size, GL_FLOAT, GL_FALSE, dataSize, (float*)(uintptr_t)offset);
                     offset += size * 4;
@@ -865,5 +881,9 @@ namespace onut
             }
             renderStates.indexBuffer.resetDirty();
         }
+
+        // Read in draw calls, or not supported
+        renderStates.primitiveMode.resetDirty();
+        renderStates.wireframe.resetDirty();
     }
 }
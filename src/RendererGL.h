@@ -31,7 +31,7 @@ namespace onut
         void endFrame() override;
 
         void draw(uint32_t vertexCount) override;
-        void drawIndexed(uint32_t indexCount, uint32_t startOffset = 0) override;
+        void drawIndexed(uint32_t indexCount, uint32_t startOffset = 0, uint32_t baseVertex = 0) override;
 
         Point getTrueResolution() const override;
         void onResize(const Point& newSize) override;
@@ -41,11 +41,15 @@ namespace onut
 
         void attachDepthBuffer(const Point& size);
 
+        static bool hasExtension(const char* szName);
+
     private:
         void createDevice(const OWindowRef& pWindow);
         void createRenderTarget();
         void createRenderStates();
         void createUniforms();
+        void setAttribBaseVertex(uint32_t baseVertex);
+        static bool hasBaseVertex();
 
         // Device stuff
 #if defined(WIN32)
@@ -58,6 +62,7 @@ namespace onut
 #endif
 
         int m_lastVertexAttribCount = 0;
+        uint32_t m_attribBaseVertex = 0; // Vertices skipped in the attribute pointers
 
         Point m_resolution;
         OIndexBufferRef m_masterIndices;
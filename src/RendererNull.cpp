@@ -0,0 +1,137 @@
+// Onut
+#include <onut/Settings.h>
+#include <onut/Shader.h>
+#include <onut/Texture.h>
+
+// Private
+#include "RendererNull.h"
+
+namespace onut
+{
+    ORendererRef Renderer::create(const OWindowRef& pWindow)
+    {
+        return OMake<RendererNull>(pWindow);
+    }
+
+    RendererNull::RendererNull(const OWindowRef& pWindow)
+    {
+    }
+
+    RendererNull::~RendererNull()
+    {
+    }
+
+    void RendererNull::init(const OWindowRef& pWindow)
+    {
+        m_resolution = oSettings->getResolution();
+        Renderer::init(pWindow);
+    }
+
+    void RendererNull::onResize(const Point& newSize)
+    {
+        m_resolution = newSize;
+    }
+
+    void RendererNull::beginFrame()
+    {
+        m_drawCalls.clear();
+
+        // Bind render target
+        renderStates.reset();
+
+        // Set viewport/scissor
+        const auto& res = getResolution();
+        renderStates.viewport = iRect{0, 0, res.x, res.y};
+        renderStates.scissorEnabled = false;
+        renderStates.scissor = renderStates.viewport.get();
+
+        // Reset 2d view
+        set2DCamera(Vector2::Zero);
+    }
+
+    void RendererNull::endFrame()
+    {
+        endFrameStats();
+    }
+
+    Point RendererNull::getTrueResolution() const
+    {
+        return m_resolution;
+    }
+
+    void RendererNull::clear(const Color& color)
+    {
+        renderStates.clearColor = color;
+        applyRenderStates();
+    }
+
+    void RendererNull::clearDepth()
+    {
+        applyRenderStates();
+    }
+
+    void RendererNull::draw(uint32_t vertexCount)
+    {
+        applyRenderStates();
+        recordDraw(false, vertexCount, 0, 0);
+    }
+
+    void RendererNull::drawIndexed(uint32_t indexCount, uint32_t startOffset, uint32_t baseVertex)
+    {
+        applyRenderStates();
+        recordDraw(true, indexCount, startOffset, baseVertex);
+    }
+
+    void RendererNull::recordDraw(bool isIndexed, uint32_t count, uint32_t startOffset, uint32_t baseVertex)
+    {
+        addStat(FrameStats::Counter::DrawCalls);
+        addStat(FrameStats::Counter::Vertices, count);
+        if (!m_isRecording) return;
+
+        DrawCall drawCall;
+        drawCall.isIndexed = isIndexed;
+        drawCall.count = count;
+        drawCall.startOffset = startOffset;
+        drawCall.baseVertex = baseVertex;
+        drawCall.primitiveMode = renderStates.primitiveMode;
+        drawCall.blendMode = renderStates.blendMode;
+        drawCall.pTexture = renderStates.textures[0];
+        drawCall.pRenderTarget = renderStates.renderTargets[0];
+        drawCall.pVertexShader = renderStates.vertexShader;
+        drawCall.pPixelShader = renderStates.pixelShader;
+        m_drawCalls.push_back(drawCall);
+    }
+
+    template<typename Ttype>
+    static void applyState(RenderState<Ttype>& state)
+    {
+        state.resetDirty();
+    }
+
+    void RendererNull::applyRenderStates()
+    {
+        addDirtyStateStats();
+
+        for (auto& renderTarget : renderStates.renderTargets) applyState(renderTarget);
+        for (auto& texture : renderStates.textures) applyState(texture);
+        applyState(renderStates.clearColor);
+        applyState(renderStates.blendMode);
+        applyState(renderStates.sampleFiltering);
+        applyState(renderStates.sampleAddressMode);
+        applyState(renderStates.viewport);
+        applyState(renderStates.scissor);
+        applyState(renderStates.projection);
+        applyState(renderStates.view);
+        applyState(renderStates.world);
+        applyState(renderStates.wireframe);
+        applyState(renderStates.depthEnabled);
+        applyState(renderStates.depthWrite);
+        applyState(renderStates.backFaceCull);
+        applyState(renderStates.scissorEnabled);
+        applyState(renderStates.primitiveMode);
+        applyState(renderStates.vertexShader);
+        applyState(renderStates.pixelShader);
+        applyState(renderStates.vertexBuffer);
+        applyState(renderStates.indexBuffer);
+    }
+}
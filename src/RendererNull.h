@@ -0,0 +1,75 @@
+#ifndef RENDERERNULL_H_INCLUDED
+#define RENDERERNULL_H_INCLUDED
+
+// Onut
+#include <onut/Point.h>
+#include <onut/Renderer.h>
+
+// STL
+#include <vector>
+
+// Forward
+#include <onut/ForwardDeclaration.h>
+OForwardDeclare(RendererNull);
+
+namespace onut
+{
+    /**
+    Renderer without GPU or window, for headless benchmarks and tests. Draws
+    and state changes go in the frame stats, and can be recorded, but nothing
+    is drawn. Resources keep their data in memory.
+    */
+    class RendererNull final : public Renderer
+    {
+    public:
+        struct DrawCall
+        {
+            bool isIndexed;
+            uint32_t count;
+            uint32_t startOffset;
+            uint32_t baseVertex;
+            PrimitiveMode primitiveMode;
+            BlendMode blendMode;
+            OTextureRef pTexture;
+            OTextureRef pRenderTarget;
+            OShaderRef pVertexShader;
+            OShaderRef pPixelShader;
+        };
+        using DrawCalls = std::vector<DrawCall>;
+
+        RendererNull(const OWindowRef& pWindow);
+        ~RendererNull();
+
+        void clear(const Color& color = {.25f, .5f, 1, 1}) override;
+        void clearDepth() override;
+
+        void beginFrame() override;
+        void endFrame() override;
+
+        void draw(uint32_t vertexCount) override;
+        void drawIndexed(uint32_t indexCount, uint32_t startOffset = 0, uint32_t baseVertex = 0) override;
+
+        Point getTrueResolution() const override;
+        void onResize(const Point& newSize) override;
+
+        void applyRenderStates() override;
+        void init(const OWindowRef& pWindow) override;
+
+        /**
+        Keep every draw call of the frame in progress. Recorded calls are
+        cleared at the start of each frame.
+        */
+        void setRecording(bool isRecording) { m_isRecording = isRecording; }
+        bool isRecording() const { return m_isRecording; }
+        const DrawCalls& getDrawCalls() const { return m_drawCalls; }
+
+    private:
+        void recordDraw(bool isIndexed, uint32_t count, uint32_t startOffset, uint32_t baseVertex);
+
+        Point m_resolution;
+        bool m_isRecording = false;
+        DrawCalls m_drawCalls;
+    };
+};
+
+#endif
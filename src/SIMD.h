@@ -0,0 +1,135 @@
+#ifndef SIMD_H_INCLUDED
+#define SIMD_H_INCLUDED
+
+// Platform
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ONUT_SIMD_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define ONUT_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+// STL
+#include <cmath>
+#include <cstddef>
+
+namespace onut
+{
+    /**
+    4 floats processed together. Maps to SSE or NEON registers, with a plain
+    scalar fallback. Loads and stores are unaligned. Comparisons return a
+    mask to be used with select().
+    */
+    struct Float4
+    {
+        static constexpr size_t WIDTH = 4;
+
+#if defined(ONUT_SIMD_SSE)
+        __m128 v;
+
+        Float4() = default;
+        Float4(__m128 _v) : v(_v) {}
+        Float4(float s) : v(_mm_set1_ps(s)) {}
+
+        static Float4 load(const float* p) { return _mm_loadu_ps(p); }
+        void store(float* p) const { _mm_storeu_ps(p, v); }
+
+        friend Float4 operator+(const Float4& a, const Float4& b) { return _mm_add_ps(a.v, b.v); }
+        friend Float4 operator-(const Float4& a, const Float4& b) { return _mm_sub_ps(a.v, b.v); }
+        friend Float4 operator*(const Float4& a, const Float4& b) { return _mm_mul_ps(a.v, b.v); }
+        friend Float4 operator/(const Float4& a, const Float4& b) { return _mm_div_ps(a.v, b.v); }
+        friend Float4 operator>(const Float4& a, const Float4& b) { return _mm_cmpgt_ps(a.v, b.v); }
+        friend Float4 min(const Float4& a, const Float4& b) { return _mm_min_ps(a.v, b.v); }
+        friend Float4 max(const Float4& a, const Float4& b) { return _mm_max_ps(a.v, b.v); }
+        friend Float4 sqrt(const Float4& a) { return _mm_sqrt_ps(a.v); }
+        friend Float4 select(const Float4& mask, const Float4& a, const Float4& b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+        friend Float4 round(const Float4& a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v)); }
+#elif defined(ONUT_SIMD_NEON)
+        float32x4_t v;
+
+        Float4() = default;
+        Float4(float32x4_t _v) : v(_v) {}
+        Float4(float s) : v(vdupq_n_f32(s)) {}
+
+        static Float4 load(const float* p) { return vld1q_f32(p); }
+        void store(float* p) const { vst1q_f32(p, v); }
+
+        friend Float4 operator+(const Float4& a, const Float4& b) { return vaddq_f32(a.v, b.v); }
+        friend Float4 operator-(const Float4& a, const Float4& b) { return vsubq_f32(a.v, b.v); }
+        friend Float4 operator*(const Float4& a, const Float4& b) { return vmulq_f32(a.v, b.v); }
+        friend Float4 operator>(const Float4& a, const Float4& b) { return vreinterpretq_f32_u32(vcgtq_f32(a.v, b.v)); }
+        friend Float4 min(const Float4& a, const Float4& b) { return vminq_f32(a.v, b.v); }
+        friend Float4 max(const Float4& a, const Float4& b) { return vmaxq_f32(a.v, b.v); }
+        friend Float4 select(const Float4& mask, const Float4& a, const Float4& b) { return vbslq_f32(vreinterpretq_u32_f32(mask.v), a.v, b.v); }
+#if defined(__aarch64__) || defined(_M_ARM64)
+        friend Float4 operator/(const Float4& a, const Float4& b) { return vdivq_f32(a.v, b.v); }
+        friend Float4 sqrt(const Float4& a) { return vsqrtq_f32(a.v); }
+        friend Float4 round(const Float4& a) { return vrndnq_f32(a.v); }
+#else
+        // 32-bit NEON has no divide, square root or rounding instructions
+        friend Float4 operator/(const Float4& a, const Float4& b)
+        {
+            // Reciprocal estimate refined by two Newton-Raphson steps
+            auto r = vrecpeq_f32(b.v);
+            r = vmulq_f32(vrecpsq_f32(b.v, r), r);
+            r = vmulq_f32(vrecpsq_f32(b.v, r), r);
+            return vmulq_f32(a.v, r);
+        }
+        friend Float4 sqrt(const Float4& a) { float r[4]; vst1q_f32(r, a.v); for (int i = 0; i < 4; ++i) r[i] = std::sqrt(r[i]); return vld1q_f32(r); }
+        friend Float4 round(const Float4& a) { float r[4]; vst1q_f32(r, a.v); for (int i = 0; i < 4; ++i) r[i] = std::nearbyint(r[i]); return vld1q_f32(r); }
+#endif
+#else
+        float v[4];
+
+        Float4() = default;
+        Float4(float s) : v{s, s, s, s} {}
+
+        static Float4 load(const float* p) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = p[i]; return r; }
+        void store(float* p) const { for (int i = 0; i < 4; ++i) p[i] = v[i]; }
+
+        friend Float4 operator+(const Float4& a, const Float4& b) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] + b.v[i]; return r; }
+        friend Float4 operator-(const Float4& a, const Float4& b) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] - b.v[i]; return r; }
+        friend Float4 operator*(const Float4& a, const Float4& b) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] * b.v[i]; return r; }
+        friend Float4 operator/(const Float4& a, const Float4& b) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] / b.v[i]; return r; }
+        friend Float4 operator>(const Float4& a, const Float4& b) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = (a.v[i] > b.v[i]) ? 1.f : 0.f; return r; }
+        friend Float4 min(const Float4& a, const Float4& b) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return r; }
+        friend Float4 max(const Float4& a, const Float4& b) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return r; }
+        friend Float4 sqrt(const Float4& a) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = std::sqrt(a.v[i]); return r; }
+        friend Float4 select(const Float4& mask, const Float4& a, const Float4& b) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = mask.v[i] != 0.f ? a.v[i] : b.v[i]; return r; }
+        friend Float4 round(const Float4& a) { Float4 r; for (int i = 0; i < 4; ++i) r.v[i] = std::nearbyint(a.v[i]); return r; }
+#endif
+    };
+
+    /**
+    Sine and cosine of angles in radians. Max error is around 1e-6 for
+    angles within a few turns, precision drops with very large angles.
+    */
+    inline void sinCos(const Float4& angle, Float4& outSin, Float4& outCos)
+    {
+        const Float4 pi(3.141592654f);
+        const Float4 halfPi(1.570796327f);
+        const Float4 one(1.f);
+
+        // Bring in [-pi, pi], then in [-pi/2, pi/2] where the polynomials are accurate
+        auto x = angle - round(angle * Float4(0.159154943f)) * Float4(6.283185307f);
+        auto above = x > halfPi;
+        auto below = (Float4(0.f) - halfPi) > x;
+        x = select(above, pi - x, select(below, Float4(0.f) - pi - x, x));
+        auto cosSign = select(above, Float4(-1.f), select(below, Float4(-1.f), one));
+
+        auto x2 = x * x;
+        outSin = x * (one + x2 * (Float4(-0.16666667f) + x2 * (Float4(0.0083333310f) + x2 * (Float4(-0.00019840874f) + x2 * (Float4(2.7525562e-06f) + x2 * Float4(-2.3889859e-08f))))));
+        outCos = cosSign * (one + x2 * (Float4(-0.5f) + x2 * (Float4(0.041666638f) + x2 * (Float4(-0.0013888378f) + x2 * (Float4(2.4760495e-05f) + x2 * Float4(-2.6051615e-07f))))));
+    }
+
+    /**
+    @return count rounded up so arrays can be processed 4 at a time without a scalar tail
+    */
+    inline size_t alignToFloat4(size_t count)
+    {
+        return (count + Float4::WIDTH - 1) & ~(Float4::WIDTH - 1);
+    }
+}
+
+#endif
@@ -171,6 +171,11 @@ namespace onut
         m_showFPS = showFPS;
     }
 
+    void Settings::setShowRenderStats(bool showRenderStats)
+    {
+        m_showRenderStats = showRenderStats;
+    }
+
     void Settings::setAutoLoadScripts(bool autoLoadScripts)
     {
         m_autoLoadScripts = autoLoadScripts;
@@ -67,22 +67,15 @@ namespace onut
 {
     static std::string readShaderFileContent(const std::string& filename)
     {
-        FILE* pFic;
-#if defined(WIN32)
-        fopen_s(&pFic, filename.c_str(), "rb");
-#else
-        pFic = fopen(filename.c_str(), "rb");
-#endif
-        if (!pFic) OLogE("Failed to load " + filename);
-        assert(pFic);
-        fseek(pFic, 0, SEEK_END);
-        auto filesize = static_cast<size_t>(ftell(pFic));
-        fseek(pFic, 0, SEEK_SET);
         std::string content;
-        content.resize(filesize + 1);
-        fread(const_cast<char*>(content.data()), 1, filesize, pFic);
-        content[filesize] = '\0';
-        fclose(pFic);
+        auto loaded = readFile(filename, [&content](const uint8_t* pData, size_t size)
+        {
+            content.reserve(size + 1);
+            content.assign(reinterpret_cast<const char*>(pData), size);
+        });
+        if (!loaded) OLogE("Failed to load " + filename);
+        assert(loaded);
+        content.push_back('\0');
 
         return std::move(content);
     }
@@ -252,7 +245,7 @@ namespace onut
         OLogE("(" + std::to_string(loc.line_number) + "," + std::to_string(loc.line_offset) + ") " + msg);
     }
 
-    static bool parseElement(Shader::ParsedElement& element, stb_lexer& lexer)
+    static bool parseElement(Shader::ParsedElement& element, stb_lexer& lexer, bool isVertexInput = false)
     {
         if (!stb_c_lexer_get_token(&lexer))
         {
@@ -268,9 +261,10 @@ namespace onut
         else if (strcmp(lexer.string, "float2") == 0) element.type = Shader::VarType::Float2;
         else if (strcmp(lexer.string, "float3") == 0) element.type = Shader::VarType::Float3;
         else if (strcmp(lexer.string, "float4") == 0) element.type = Shader::VarType::Float4;
+        else if (isVertexInput && strcmp(lexer.string, "ubyte4") == 0) element.type = Shader::VarType::UByte4;
         else
         {
-            shaderError(lexer, "Expected type of float, float2, float3 or float4");
+            shaderError(lexer, isVertexInput ? "Expected type of float, float2, float3, float4 or ubyte4" : "Expected type of float, float2, float3 or float4");
             return false;
         }
         if (!stb_c_lexer_get_token(&lexer))
@@ -1110,7 +1104,7 @@ namespace onut
             if (strcmp(lexer.string, "input") == 0)
             {
                 ParsedElement input;
-                if (!parseElement(input, lexer)) break;
+                if (!parseElement(input, lexer, true)) break;
                 ret.inputs.push_back(input);
             }
             else if (strcmp(lexer.string, "output") == 0)
@@ -1271,6 +1265,37 @@ namespace onut
 
         return std::move(ret);
     }
+
+    uint32_t Shader::packUniforms(const ParsedUniforms& uniforms, std::vector<uint32_t>& offsets)
+    {
+        uint32_t offset = 0;
+        offsets.clear();
+        for (const auto& uniform : uniforms)
+        {
+            uint32_t size = 4;
+            uint32_t alignment = 4;
+            switch (uniform.type)
+            {
+                case VarType::Float2: size = 8; alignment = 8; break;
+                case VarType::Float3: size = 12; alignment = 16; break;
+                case VarType::Float4: size = 16; alignment = 16; break;
+                case VarType::Matrix: size = 64; alignment = 16; break;
+                default: break;
+            }
+
+            // Array elements start on 16 bytes
+            if (uniform.count > 1)
+            {
+                alignment = 16;
+                size = ((size + 15) & ~15) * uniform.count;
+            }
+
+            offset = (offset + alignment - 1) & ~(alignment - 1);
+            offsets.push_back(offset);
+            offset += size;
+        }
+        return (offset + 15) & ~15;
+    }
 };
 
 OShaderRef OGetShader(const std::string& name)
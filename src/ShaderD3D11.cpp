@@ -14,7 +14,9 @@
 #include <D3Dcompiler.h>
 
 // STL
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <regex>
 #include <set>
 
@@ -28,6 +30,7 @@ namespace onut
         case Shader::VarType::Float2: return "float2";
         case Shader::VarType::Float3: return "float3";
         case Shader::VarType::Float4: return "float4";
+        case Shader::VarType::UByte4: return "float4";
         case Shader::VarType::Matrix: return "matrix";
         default: assert(false);
         }
@@ -185,27 +188,20 @@ namespace onut
             elementStructsSource += "};\n\n";
             source += elementStructsSource;
 
-            // Create uniforms
-            ShaderD3D11::Uniforms uniforms;
-            int uniformId = 4;
-            for (auto& parsedUniform : parsed.uniforms)
+            // Create uniforms, all in one constant buffer laid out like the GL uniform block
+            std::vector<uint32_t> uniformOffsets;
+            auto uniformBlockSize = packUniforms(parsed.uniforms, uniformOffsets);
+            if (!parsed.uniforms.empty())
             {
-                ShaderD3D11::Uniform uniform;
-
-                uniform.name = parsedUniform.name;
-
-                UINT uniformSize = 4;
-                if (parsedUniform.type == VarType::Matrix) uniformSize = 16;
-                uniformSize *= parsedUniform.count;
-
-                D3D11_BUFFER_DESC cbDesc = CD3D11_BUFFER_DESC(uniformSize * 4, D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
-                auto ret = pDevice->CreateBuffer(&cbDesc, NULL, &(uniform.pBuffer));
-                assert(ret == S_OK);
-
-                source += "cbuffer cb_" + uniform.name + " : register(b" + std::to_string(uniformId) + ")\n{\n    " + getTypeName(parsedUniform.type) + " " + uniform.name + (parsedUniform.count > 1 ? ("[" + std::to_string(parsedUniform.count) + "]") : "") + ";\n}\n\n";
-
-                uniforms.push_back(uniform);
-                ++uniformId;
+                source += "cbuffer OUniforms : register(b" + std::to_string(ShaderD3D11::UNIFORM_BUFFER_SLOT) + ")\n{\n";
+                for (int i = 0; i < (int)parsed.uniforms.size(); ++i)
+                {
+                    const auto& uniform = parsed.uniforms[i];
+                    auto offset = uniformOffsets[i];
+                    source += "    " + getTypeName(uniform.type) + " " + uniform.name + (uniform.count > 1 ? ("[" + std::to_string(uniform.count) + "]") : "");
+                    source += " : packoffset(c" + std::to_string(offset / 16) + "." + "xyzw"[(offset % 16) / 4] + ");\n";
+                }
+                source += "}\n\n";
             }
 
             // Bake structures
@@ -278,7 +274,7 @@ namespace onut
             auto pRetD3D11 = ODynamicCast<ShaderD3D11>(pRet);
             if (pRetD3D11)
             {
-                pRetD3D11->m_uniforms = uniforms;
+                pRetD3D11->initUniforms(parsed.uniforms, uniformOffsets, uniformBlockSize);
 
                 // Create textures samplers
                 if (!parsed.textures.empty())
@@ -384,27 +380,20 @@ namespace onut
             elementStructsSource += "};\n\n";
             source += elementStructsSource;
 
-            // Create uniforms
-            ShaderD3D11::Uniforms uniforms;
-            int uniformId = 4;
-            for (auto& parsedUniform : parsed.uniforms)
+            // Create uniforms, all in one constant buffer laid out like the GL uniform block
+            std::vector<uint32_t> uniformOffsets;
+            auto uniformBlockSize = packUniforms(parsed.uniforms, uniformOffsets);
+            if (!parsed.uniforms.empty())
             {
-                ShaderD3D11::Uniform uniform;
-
-                uniform.name = parsedUniform.name;
-
-                UINT uniformSize = 4;
-                if (parsedUniform.type == VarType::Matrix) uniformSize = 16;
-                uniformSize *= parsedUniform.count;
-
-                D3D11_BUFFER_DESC cbDesc = CD3D11_BUFFER_DESC(uniformSize * 4, D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
-                auto ret = pDevice->CreateBuffer(&cbDesc, NULL, &(uniform.pBuffer));
-                assert(ret == S_OK);
-
-                source += "cbuffer cb_" + uniform.name + " : register(b" + std::to_string(uniformId) + ")\n{\n    " + getTypeName(parsedUniform.type) + " " + uniform.name + (parsedUniform.count > 1 ? ("[" + std::to_string(parsedUniform.count) + "]") : "") + ";\n}\n\n";
-
-                uniforms.push_back(uniform);
-                ++uniformId;
+                source += "cbuffer OUniforms : register(b" + std::to_string(ShaderD3D11::UNIFORM_BUFFER_SLOT) + ")\n{\n";
+                for (int i = 0; i < (int)parsed.uniforms.size(); ++i)
+                {
+                    const auto& uniform = parsed.uniforms[i];
+                    auto offset = uniformOffsets[i];
+                    source += "    " + getTypeName(uniform.type) + " " + uniform.name + (uniform.count > 1 ? ("[" + std::to_string(uniform.count) + "]") : "");
+                    source += " : packoffset(c" + std::to_string(offset / 16) + "." + "xyzw"[(offset % 16) / 4] + ");\n";
+                }
+                source += "}\n\n";
             }
 
             // Bake structures
@@ -494,7 +483,7 @@ namespace onut
             auto pRetD3D11 = ODynamicCast<ShaderD3D11>(pRet);
             if (pRetD3D11)
             {
-                pRetD3D11->m_uniforms = uniforms;
+                pRetD3D11->initUniforms(parsed.uniforms, uniformOffsets, uniformBlockSize);
 
                 // Create textures samplers
                 if (!parsed.textures.empty())
@@ -606,11 +595,14 @@ namespace onut
                         case VarType::Float4:
                             format = DXGI_FORMAT_R32G32B32A32_FLOAT;
                             break;
+                        case VarType::UByte4:
+                            format = DXGI_FORMAT_R8G8B8A8_UNORM;
+                            break;
                         default:
                             assert(false);
                     }
 
-                    pRet->m_vertexSize += (int)element.type * 4;
+                    pRet->m_vertexSize += (element.type == VarType::UByte4) ? 4 : (int)element.type * 4;
                     
                     D3D11_INPUT_ELEMENT_DESC inputElement = {
                         element.semanticName.c_str(), semanticIndexes[element.semanticName], 
@@ -698,9 +690,9 @@ namespace onut
             m_ppVSSampleStates[i]->Release();
         }
         if (m_ppVSSampleStates) delete[] m_ppVSSampleStates;
-        for (auto& pUniform : m_uniforms)
+        if (m_pUniformBuffer)
         {
-            pUniform.pBuffer->Release();
+            m_pUniformBuffer->Release();
         }
         if (m_pVertexShader)
         {
@@ -767,99 +759,88 @@ namespace onut
         return -1;
     }
 
-    void ShaderD3D11::setFloat(int varId, float value)
+    void ShaderD3D11::initUniforms(const ParsedUniforms& parsedUniforms, const std::vector<uint32_t>& offsets, uint32_t blockSize)
     {
-        auto& uniform = m_uniforms[varId];
-        uniform.dirty = true;
-        auto pBuffer = uniform.pBuffer;
-        auto pRendererD3D11 = std::dynamic_pointer_cast<ORendererD3D11>(oRenderer);
-        auto pDeviceContext = pRendererD3D11->getDeviceContext();
+        m_uniforms.clear();
+        for (int i = 0; i < (int)parsedUniforms.size(); ++i)
+        {
+            Uniform uniform;
+            uniform.type = parsedUniforms[i].type;
+            uniform.count = parsedUniforms[i].count;
+            uniform.offset = offsets[i];
+            uniform.name = parsedUniforms[i].name;
+            m_uniforms.push_back(uniform);
+        }
+        m_uniformData.assign(blockSize, 0);
 
-        D3D11_MAPPED_SUBRESOURCE map;
-        pDeviceContext->Map(pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map);
-        float values[4] = {value, 0, 0, 0};
-        memcpy(map.pData, values, 16);
-        pDeviceContext->Unmap(pBuffer, 0);
+        if (blockSize)
+        {
+            auto pRendererD3D11 = std::dynamic_pointer_cast<ORendererD3D11>(oRenderer);
+            auto pDevice = pRendererD3D11->getDevice();
+            D3D11_BUFFER_DESC cbDesc = CD3D11_BUFFER_DESC(blockSize, D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+            auto ret = pDevice->CreateBuffer(&cbDesc, NULL, &m_pUniformBuffer);
+            assert(ret == S_OK);
+            m_isUniformBufferDirty = true;
+        }
     }
 
-    void ShaderD3D11::setVector2(int varId, const Vector2& value)
+    void ShaderD3D11::setUniformData(int varId, const void* pData, uint32_t size)
     {
-        auto& uniform = m_uniforms[varId];
-        uniform.dirty = true;
-        auto pBuffer = uniform.pBuffer;
-        auto pRendererD3D11 = std::dynamic_pointer_cast<ORendererD3D11>(oRenderer);
-        auto pDeviceContext = pRendererD3D11->getDeviceContext();
+        if (varId < 0 || varId >= (int)m_uniforms.size()) return;
+        memcpy(m_uniformData.data() + m_uniforms[varId].offset, pData, size);
+        m_isUniformBufferDirty = true;
+    }
+
+    void ShaderD3D11::updateUniformBuffer(ID3D11DeviceContext* pDeviceContext)
+    {
+        if (!m_isUniformBufferDirty || !m_pUniformBuffer) return;
 
         D3D11_MAPPED_SUBRESOURCE map;
-        pDeviceContext->Map(pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map);
-        float values[4] = {value.x, value.y, 0, 0};
-        memcpy(map.pData, values, 16);
-        pDeviceContext->Unmap(pBuffer, 0);
+        pDeviceContext->Map(m_pUniformBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map);
+        memcpy(map.pData, m_uniformData.data(), m_uniformData.size());
+        pDeviceContext->Unmap(m_pUniformBuffer, 0);
+        oRenderer->addStat(FrameStats::Counter::UniformUploads);
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, (uint32_t)m_uniformData.size());
+        m_isUniformBufferDirty = false;
     }
 
-    void ShaderD3D11::setVector3(int varId, const Vector3& value)
+    void ShaderD3D11::setFloat(int varId, float value)
     {
-        auto& uniform = m_uniforms[varId];
-        uniform.dirty = true;
-        auto pBuffer = uniform.pBuffer;
-        auto pRendererD3D11 = std::dynamic_pointer_cast<ORendererD3D11>(oRenderer);
-        auto pDeviceContext = pRendererD3D11->getDeviceContext();
+        setUniformData(varId, &value, 4);
+    }
 
-        D3D11_MAPPED_SUBRESOURCE map;
-        pDeviceContext->Map(pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map);
-        float values[4] = {value.x, value.y, value.z, 0};
-        memcpy(map.pData, values, 16);
-        pDeviceContext->Unmap(pBuffer, 0);
+    void ShaderD3D11::setVector2(int varId, const Vector2& value)
+    {
+        setUniformData(varId, &value.x, 8);
     }
 
-    void ShaderD3D11::setVector4(int varId, const Vector4& value)
+    void ShaderD3D11::setVector3(int varId, const Vector3& value)
     {
-        auto& uniform = m_uniforms[varId];
-        uniform.dirty = true;
-        auto pBuffer = uniform.pBuffer;
-        auto pRendererD3D11 = std::dynamic_pointer_cast<ORendererD3D11>(oRenderer);
-        auto pDeviceContext = pRendererD3D11->getDeviceContext();
+        setUniformData(varId, &value.x, 12);
+    }
 
-        D3D11_MAPPED_SUBRESOURCE map;
-        pDeviceContext->Map(pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map);
-        memcpy(map.pData, &value.x, 16);
-        pDeviceContext->Unmap(pBuffer, 0);
+    void ShaderD3D11::setVector4(int varId, const Vector4& value)
+    {
+        setUniformData(varId, &value.x, 16);
     }
 
     void ShaderD3D11::setMatrix(int varId, const Matrix& value)
     {
-        auto& uniform = m_uniforms[varId];
-        uniform.dirty = true;
-        auto pBuffer = uniform.pBuffer;
-        auto pRendererD3D11 = std::dynamic_pointer_cast<ORendererD3D11>(oRenderer);
-        auto pDeviceContext = pRendererD3D11->getDeviceContext();
         auto finalValue = value.Transpose();
-
-        D3D11_MAPPED_SUBRESOURCE map;
-        pDeviceContext->Map(pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map);
-        memcpy(map.pData, &finalValue._11, 64);
-        pDeviceContext->Unmap(pBuffer, 0);
+        setUniformData(varId, &finalValue._11, 64);
     }
 
     void ShaderD3D11::setMatrixArray(int varId, const Matrix* values, int count)
     {
+        if (varId < 0 || varId >= (int)m_uniforms.size()) return;
         auto& uniform = m_uniforms[varId];
-        uniform.dirty = true;
-        auto pBuffer = uniform.pBuffer;
-        auto pRendererD3D11 = std::dynamic_pointer_cast<ORendererD3D11>(oRenderer);
-        auto pDeviceContext = pRendererD3D11->getDeviceContext();
-
-        static std::vector<Matrix> transposed;
-        if ((int)transposed.size() < count) transposed.resize(count);
+        auto pMatrices = reinterpret_cast<Matrix*>(m_uniformData.data() + uniform.offset);
+        count = std::min(count, uniform.count);
         for (int i = 0; i < count; ++i)
         {
-            transposed[i] = values[i].Transpose();
+            pMatrices[i] = values[i].Transpose();
         }
-
-        D3D11_MAPPED_SUBRESOURCE map;
-        pDeviceContext->Map(pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map);
-        memcpy(map.pData, transposed.data(), 64 * count);
-        pDeviceContext->Unmap(pBuffer, 0);
+        m_isUniformBufferDirty = true;
     }
 
     void ShaderD3D11::setFloat(const std::string& varName, float value)
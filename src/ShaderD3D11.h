@@ -23,13 +23,16 @@ namespace onut
 
         struct Uniform
         {
-            bool dirty = true;
-            ID3D11Buffer* pBuffer = nullptr;
+            VarType type;
+            int count = 1;
+            uint32_t offset = 0; // Into the constant buffer
             std::string name;
         };
 
         using Uniforms = std::vector<Uniform>;
 
+        static const UINT UNIFORM_BUFFER_SLOT = 4;
+
         ID3D11VertexShader* getVertexShader() const;
         ID3D11PixelShader* getPixelShader() const;
         ID3D11InputLayout* getInputLayout() const;
@@ -38,6 +41,12 @@ namespace onut
         int getSamplerStatesCount() const;
         int getVSSamplerStatesCount() const;
         Uniforms& getUniforms();
+        ID3D11Buffer* getUniformBuffer() const { return m_pUniformBuffer; }
+
+        /**
+        Send the uniforms to the constant buffer if they changed.
+        */
+        void updateUniformBuffer(ID3D11DeviceContext* pDeviceContext);
 
         int getUniformId(const std::string& varName) const override;
         void setFloat(int varId, float value) override;
@@ -65,7 +74,13 @@ namespace onut
         int m_samplerStatesCount = 0;
         int m_vsSamplerStatesCount = 0;
 
+        void initUniforms(const ParsedUniforms& parsedUniforms, const std::vector<uint32_t>& offsets, uint32_t blockSize);
+        void setUniformData(int varId, const void* pData, uint32_t size);
+
         Uniforms m_uniforms;
+        std::vector<uint8_t> m_uniformData;
+        ID3D11Buffer* m_pUniformBuffer = nullptr;
+        bool m_isUniformBufferDirty = false;
     };
 };
 
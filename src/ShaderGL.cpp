@@ -10,7 +10,9 @@
 #include "RendererGL.h"
 
 // STL
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <regex>
 #include <set>
 
@@ -26,12 +28,19 @@ namespace onut
         case Shader::VarType::Float2: return "vec2";
         case Shader::VarType::Float3: return "vec3";
         case Shader::VarType::Float4: return "vec4";
+        case Shader::VarType::UByte4: return "vec4";
         case Shader::VarType::Matrix: return "mat4";
         default: assert(false);
         }
         return "";
     }
 
+    static std::string getArraySuffix(const Shader::ParsedUniform& uniform)
+    {
+        if (uniform.count > 1) return "[" + std::to_string(uniform.count) + "]";
+        return "";
+    }
+
     static void bakeTokens(std::string& source, const std::vector<Shader::Token>& tokens)
     {
         for (const auto& token : tokens)
@@ -170,6 +179,7 @@ namespace onut
 
             // Add engine default constant buffers
             source += "#version " SHADER_VERSION "\n\n";
+            if (ShaderGL::hasUniformBlocks()) source += "#extension GL_ARB_uniform_buffer_object : require\n\n";
             source += "uniform mat4 oViewProjection;\n\n";
             source += "uniform mat4 oModel;\n\n";
 
@@ -202,6 +212,7 @@ namespace onut
                 case VarType::Float2: elementStructsSource += "attribute vec2 "; break;
                 case VarType::Float3: elementStructsSource += "attribute vec3 "; break;
                 case VarType::Float4: elementStructsSource += "attribute vec4 "; break;
+                case VarType::UByte4: elementStructsSource += "attribute vec4 "; break; // Normalized by glVertexAttribPointer
                 default: assert(false);
                 }
                 elementStructsSource += element.name + ";\n";
@@ -232,15 +243,16 @@ namespace onut
             source += elementStructsSource;
 
             // Create uniforms
-            ShaderGL::Uniforms uniforms;
-            for (auto it = parsed.uniforms.begin(); it != parsed.uniforms.end(); ++it)
+            std::vector<uint32_t> uniformOffsets;
+            auto uniformBlockSize = packUniforms(parsed.uniforms, uniformOffsets);
+            bool useUniformBlock = ShaderGL::hasUniformBlocks() && !parsed.uniforms.empty();
+            if (useUniformBlock) source += "layout(std140) uniform OVSUniforms\n{\n";
+            for (const auto& uniform : parsed.uniforms)
             {
-                ShaderGL::Uniform uniform;
-                uniform.name = it->name;
-                uniform.type = it->type;
-                source += "uniform " + getTypeName(it->type) + " " + uniform.name + ";\n";
-                uniforms.push_back(uniform);
+                source += useUniformBlock ? "    " : "uniform ";
+                source += getTypeName(uniform.type) + " " + uniform.name + getArraySuffix(uniform) + ";\n";
             }
+            if (useUniformBlock) source += "};\n";
 
             // Bake structures
             for (const auto& _struct : parsed.structs)
@@ -327,7 +339,7 @@ namespace onut
                 attribute.index = i++;
                 ((ShaderGL*)(pRet.get()))->m_inputLayout.push_back(attribute);
             }
-            ((ShaderGL*)(pRet.get()))->m_uniforms = uniforms;
+            ((ShaderGL*)(pRet.get()))->initUniforms(parsed.uniforms, uniformOffsets, uniformBlockSize);
             ((ShaderGL*)(pRet.get()))->m_vsTextures = parsed.textures;
 
 #if defined(_DEBUG)
@@ -342,6 +354,7 @@ namespace onut
             source.reserve(5000);
 
             source += "#version " SHADER_VERSION "\n\n";
+            if (ShaderGL::hasUniformBlocks()) source += "#extension GL_ARB_uniform_buffer_object : require\n\n";
             //source += "layout( location = 0 ) out vec4 oColor;\n\n";
             //source += "out vec4 oColor;\n\n";
 
@@ -380,16 +393,21 @@ namespace onut
             elementStructsSource += "\n";
             source += elementStructsSource;
 
-            // Create uniforms
-            ShaderGL::Uniforms uniforms;
-            for (auto it = parsed.uniforms.begin(); it != parsed.uniforms.end(); ++it)
+            // Create uniforms. They are suffixed so they don't clash with the vertex shader ones.
+            std::vector<uint32_t> uniformOffsets;
+            auto uniformBlockSize = packUniforms(parsed.uniforms, uniformOffsets);
+            bool useUniformBlock = ShaderGL::hasUniformBlocks() && !parsed.uniforms.empty();
+            if (useUniformBlock) source += "layout(std140) uniform OPSUniforms\n{\n";
+            for (const auto& uniform : parsed.uniforms)
+            {
+                source += useUniformBlock ? "    " : "uniform ";
+                source += getTypeName(uniform.type) + " " + uniform.name + "_PS" + getArraySuffix(uniform) + ";\n";
+            }
+            if (useUniformBlock) source += "};\n";
+            for (const auto& uniform : parsed.uniforms)
             {
-                ShaderGL::Uniform uniform;
-                uniform.name = it->name;
-                uniform.type = it->type;
-                source += "uniform " + getTypeName(it->type) + " " + uniform.name + "_PS;\n";
-                source += getTypeName(it->type) + " " + uniform.name + " = " + uniform.name + "_PS;\n";
-                uniforms.push_back(uniform);
+                if (uniform.count > 1) source += "#define " + uniform.name + " " + uniform.name + "_PS\n";
+                else source += getTypeName(uniform.type) + " " + uniform.name + " = " + uniform.name + "_PS;\n";
             }
 
             // Bake structures
@@ -485,7 +503,7 @@ namespace onut
 
             // Now compile it
             auto pRet = createFromNativeSource(source, Type::Pixel);
-            ((ShaderGL*)(pRet.get()))->m_uniforms = uniforms;
+            ((ShaderGL*)(pRet.get()))->initUniforms(parsed.uniforms, uniformOffsets, uniformBlockSize);
             ((ShaderGL*)(pRet.get()))->m_textures = parsed.textures;
 #if defined(_DEBUG)
             ((ShaderGL*)(pRet.get()))->m_source = std::move(source);
@@ -599,6 +617,11 @@ namespace onut
 
     ShaderGL::~ShaderGL()
     {
+        if (m_uniformBuffer)
+        {
+            glDeleteBuffers(1, &m_uniformBuffer);
+            m_uniformBuffer = 0;
+        }
         if (m_shader)
         {
             glDeleteShader(m_shader);
@@ -623,45 +646,123 @@ namespace onut
         return -1;
     }
 
-    void ShaderGL::setFloat(int varId, float value)
+    void ShaderGL::initUniforms(const ParsedUniforms& parsedUniforms, const std::vector<uint32_t>& offsets, uint32_t blockSize)
     {
+        m_uniforms.clear();
+        for (int i = 0; i < (int)parsedUniforms.size(); ++i)
+        {
+            Uniform uniform;
+            uniform.type = parsedUniforms[i].type;
+            uniform.count = parsedUniforms[i].count;
+            uniform.offset = offsets[i];
+            uniform.name = parsedUniforms[i].name;
+            m_uniforms.push_back(uniform);
+        }
+        m_uniformData.assign(blockSize, 0);
+
+        if (hasUniformBlocks() && blockSize)
+        {
+            glGenBuffers(1, &m_uniformBuffer);
+            glBindBuffer(GL_UNIFORM_BUFFER, m_uniformBuffer);
+            glBufferData(GL_UNIFORM_BUFFER, blockSize, m_uniformData.data(), GL_DYNAMIC_DRAW);
+            m_isUniformBlockDirty = false;
+        }
+    }
+
+    bool ShaderGL::hasUniformBlocks()
+    {
+        static int hasUniformBlocks = -1;
+        if (hasUniformBlocks == -1)
+        {
+            hasUniformBlocks = RendererGL::hasExtension("GL_ARB_uniform_buffer_object") ? 1 : 0;
+        }
+        return hasUniformBlocks == 1;
+    }
+
+    void ShaderGL::setUniformData(int varId, const void* pData, uint32_t size)
+    {
+        if (varId < 0 || varId >= (int)m_uniforms.size()) return;
         auto& uniform = m_uniforms[varId];
         uniform.dirty = true;
-        uniform.value._11 = value;
+        m_isUniformBlockDirty = true;
+        memcpy(m_uniformData.data() + uniform.offset, pData, size);
+    }
+
+    bool ShaderGL::updateUniformBlock()
+    {
+        if (!m_isUniformBlockDirty || !m_uniformBuffer) return false;
+        glBindBuffer(GL_UNIFORM_BUFFER, m_uniformBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, m_uniformData.size(), m_uniformData.data());
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, (uint32_t)m_uniformData.size());
+        m_isUniformBlockDirty = false;
+        return true;
+    }
+
+    void ShaderGL::uploadUniform(GLint location, const Uniform& uniform) const
+    {
+        auto pData = reinterpret_cast<const GLfloat*>(m_uniformData.data() + uniform.offset);
+        switch (uniform.type)
+        {
+            case VarType::Float4:
+                glUniform4fv(location, uniform.count, pData);
+                break;
+            case VarType::Matrix:
+                glUniformMatrix4fv(location, uniform.count, GL_FALSE, pData);
+                break;
+            default:
+                // Smaller types are padded to 16 bytes in arrays
+                for (int i = 0; i < uniform.count; ++i, pData += 4)
+                {
+                    switch (uniform.type)
+                    {
+                        case VarType::Float: glUniform1fv(location + i, 1, pData); break;
+                        case VarType::Float2: glUniform2fv(location + i, 1, pData); break;
+                        case VarType::Float3: glUniform3fv(location + i, 1, pData); break;
+                        default: break;
+                    }
+                }
+                break;
+        }
+    }
+
+    void ShaderGL::setFloat(int varId, float value)
+    {
+        setUniformData(varId, &value, 4);
     }
 
     void ShaderGL::setVector2(int varId, const Vector2& value)
     {
-        auto& uniform = m_uniforms[varId];
-        uniform.dirty = true;
-        uniform.value._11 = value.x;
-        uniform.value._12 = value.y;
+        setUniformData(varId, &value.x, 8);
     }
 
     void ShaderGL::setVector3(int varId, const Vector3& value)
     {
-        auto& uniform = m_uniforms[varId];
-        uniform.dirty = true;
-        uniform.value._11 = value.x;
-        uniform.value._12 = value.y;
-        uniform.value._13 = value.z;
+        setUniformData(varId, &value.x, 12);
     }
 
     void ShaderGL::setVector4(int varId, const Vector4& value)
     {
-        auto& uniform = m_uniforms[varId];
-        uniform.dirty = true;
-        uniform.value._11 = value.x;
-        uniform.value._12 = value.y;
-        uniform.value._13 = value.z;
-        uniform.value._14 = value.w;
+        setUniformData(varId, &value.x, 16);
     }
 
     void ShaderGL::setMatrix(int varId, const Matrix& value)
     {
+        auto finalValue = value.Transpose();
+        setUniformData(varId, &finalValue._11, 64);
+    }
+
+    void ShaderGL::setMatrixArray(int varId, const Matrix* values, int count)
+    {
+        if (varId < 0 || varId >= (int)m_uniforms.size()) return;
         auto& uniform = m_uniforms[varId];
         uniform.dirty = true;
-        uniform.value = value.Transpose();
+        m_isUniformBlockDirty = true;
+        auto pMatrices = reinterpret_cast<Matrix*>(m_uniformData.data() + uniform.offset);
+        count = std::min(count, uniform.count);
+        for (int i = 0; i < count; ++i)
+        {
+            pMatrices[i] = values[i].Transpose();
+        }
     }
 
     void ShaderGL::setFloat(const std::string& varName, float value)
@@ -689,6 +790,11 @@ namespace onut
         setMatrix(getUniformId(varName), value);
     }
 
+    void ShaderGL::setMatrixArray(const std::string& varName, const Matrix* values, int count)
+    {
+        setMatrixArray(getUniformId(varName), values, count);
+    }
+
     ShaderGL::Uniforms& ShaderGL::getUniforms()
     {
         return m_uniforms;
@@ -748,13 +854,23 @@ namespace onut
         // Now find all uniforms
         pProgram->oViewProjectionUniform = glGetUniformLocation(program, "oViewProjection");
         pProgram->oModelUniform = glGetUniformLocation(program, "oModel");
-        for (const auto& uniform : pVertexShaderRaw->m_uniforms)
+        if (hasUniformBlocks())
         {
-            pProgramRaw->uniformsVS.push_back(glGetUniformLocation(program, uniform.name.c_str()));
+            auto blockIndex = glGetUniformBlockIndex(program, "OVSUniforms");
+            if (blockIndex != GL_INVALID_INDEX) glUniformBlockBinding(program, blockIndex, VS_UNIFORM_BLOCK_BINDING);
+            blockIndex = glGetUniformBlockIndex(program, "OPSUniforms");
+            if (blockIndex != GL_INVALID_INDEX) glUniformBlockBinding(program, blockIndex, PS_UNIFORM_BLOCK_BINDING);
         }
-        for (const auto& uniform : m_uniforms)
+        else
         {
-            pProgramRaw->uniformsPS.push_back(glGetUniformLocation(program, (uniform.name + "_PS").c_str()));
+            for (const auto& uniform : pVertexShaderRaw->m_uniforms)
+            {
+                pProgramRaw->uniformsVS.push_back(glGetUniformLocation(program, uniform.name.c_str()));
+            }
+            for (const auto& uniform : m_uniforms)
+            {
+                pProgramRaw->uniformsPS.push_back(glGetUniformLocation(program, (uniform.name + "_PS").c_str()));
+            }
         }
 
         // Find texture locations
@@ -24,12 +24,22 @@ namespace onut
         {
             bool dirty = true;
             VarType type;
-            Matrix value; // We just store everything in a matrix for easy copying
+            int count = 1;
+            uint32_t offset = 0; // Into the uniform block data
             std::string name;
         };
 
         using Uniforms = std::vector<Uniform>;
 
+        static const GLuint VS_UNIFORM_BLOCK_BINDING = 0;
+        static const GLuint PS_UNIFORM_BLOCK_BINDING = 1;
+
+        /**
+        Uniforms are grouped in one std140 block per shader when the driver
+        has uniform buffer objects. Otherwise they are set one by one.
+        */
+        static bool hasUniformBlocks();
+
         Uniforms& getUniforms();
 
         int getUniformId(const std::string& varName) const override;
@@ -38,13 +48,13 @@ namespace onut
         void setVector3(int varId, const Vector3& value) override;
         void setVector4(int varId, const Vector4& value) override;
         void setMatrix(int varId, const Matrix& value) override;
-        void setMatrixArray(int varId, const Matrix* values, int count) override {}; // TODO
+        void setMatrixArray(int varId, const Matrix* values, int count) override;
         void setFloat(const std::string& varName, float value) override;
         void setVector2(const std::string& varName, const Vector2& value) override;
         void setVector3(const std::string& varName, const Vector3& value) override;
         void setVector4(const std::string& varName, const Vector4& value) override;
         void setMatrix(const std::string& varName, const Matrix& value) override;
-        void setMatrixArray(const std::string& varName, const Matrix* values, int count) override {}; // TODO
+        void setMatrixArray(const std::string& varName, const Matrix* values, int count) override;
 
     private:
         friend class Shader;
@@ -74,9 +84,16 @@ namespace onut
         using Programs = std::vector<ProgramRef>;
 
         const ProgramRef& getProgram(const OShaderGLRef& pVertexShader);
+        void initUniforms(const ParsedUniforms& parsedUniforms, const std::vector<uint32_t>& offsets, uint32_t blockSize);
+        void setUniformData(int varId, const void* pData, uint32_t size);
+        bool updateUniformBlock();
+        void uploadUniform(GLint location, const Uniform& uniform) const;
 
         GLenum m_shader = 0;
         Uniforms m_uniforms;
+        std::vector<uint8_t> m_uniformData;
+        GLuint m_uniformBuffer = 0;
+        bool m_isUniformBlockDirty = true;
         Programs m_programs;
         ParsedTextures m_textures;
         ParsedTextures m_vsTextures;
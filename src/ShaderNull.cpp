@@ -0,0 +1,161 @@
+// Private
+#include "ShaderNull.h"
+
+// STL
+#include <cassert>
+
+namespace onut
+{
+    static ShaderNull::Uniforms createUniforms(const Shader::ParsedUniforms& parsedUniforms)
+    {
+        ShaderNull::Uniforms uniforms;
+        for (const auto& parsedUniform : parsedUniforms)
+        {
+            ShaderNull::Uniform uniform;
+            uniform.type = parsedUniform.type;
+            uniform.name = parsedUniform.name;
+            uniforms.push_back(uniform);
+        }
+        return uniforms;
+    }
+
+    OShaderRef Shader::createFromBinaryFile(const std::string& filename, Type in_type, const VertexElements& vertexElements)
+    {
+        return nullptr;
+    }
+
+    OShaderRef Shader::createFromBinaryData(const uint8_t* pData, uint32_t size, Type in_type, const VertexElements& vertexElements)
+    {
+        return nullptr;
+    }
+
+    OShaderRef Shader::createFromSource(const std::string& source, Type in_type, const VertexElements& vertexElements)
+    {
+        if (in_type == OVertexShader)
+        {
+            auto parsed = parseVertexShader(source);
+            VertexElements inputElements;
+            for (const auto& element : parsed.inputs)
+            {
+                inputElements.push_back({element.type, "INPUT_ELEMENT"});
+            }
+            auto pRet = createFromNativeSource(source, in_type, inputElements);
+            ((ShaderNull*)(pRet.get()))->m_uniforms = createUniforms(parsed.uniforms);
+            return pRet;
+        }
+        else if (in_type == OPixelShader)
+        {
+            auto parsed = parsePixelShader(source);
+            auto pRet = createFromNativeSource(source, in_type, vertexElements);
+            ((ShaderNull*)(pRet.get()))->m_uniforms = createUniforms(parsed.uniforms);
+            return pRet;
+        }
+        else
+        {
+            assert(false);
+        }
+
+        return nullptr;
+    }
+
+    OShaderRef Shader::createFromNativeSource(const std::string& source, Type in_type, const VertexElements& vertexElements)
+    {
+        auto pRet = std::make_shared<ShaderNull>();
+        pRet->m_type = in_type;
+        for (const auto& element : vertexElements)
+        {
+            pRet->m_vertexSize += (element.type == VarType::UByte4) ? 4 : (int)element.type * 4;
+        }
+        return pRet;
+    }
+
+    ShaderNull::ShaderNull()
+    {
+    }
+
+    ShaderNull::~ShaderNull()
+    {
+    }
+
+    int ShaderNull::getUniformId(const std::string& varName) const
+    {
+        for (int i = 0; i < (int)m_uniforms.size(); ++i)
+        {
+            if (m_uniforms[i].name == varName)
+            {
+                return i;
+            }
+        }
+        assert(false);
+        return -1;
+    }
+
+    void ShaderNull::setFloat(int varId, float value)
+    {
+        m_uniforms[varId].value._11 = value;
+    }
+
+    void ShaderNull::setVector2(int varId, const Vector2& value)
+    {
+        auto& uniform = m_uniforms[varId];
+        uniform.value._11 = value.x;
+        uniform.value._12 = value.y;
+    }
+
+    void ShaderNull::setVector3(int varId, const Vector3& value)
+    {
+        auto& uniform = m_uniforms[varId];
+        uniform.value._11 = value.x;
+        uniform.value._12 = value.y;
+        uniform.value._13 = value.z;
+    }
+
+    void ShaderNull::setVector4(int varId, const Vector4& value)
+    {
+        auto& uniform = m_uniforms[varId];
+        uniform.value._11 = value.x;
+        uniform.value._12 = value.y;
+        uniform.value._13 = value.z;
+        uniform.value._14 = value.w;
+    }
+
+    void ShaderNull::setMatrix(int varId, const Matrix& value)
+    {
+        m_uniforms[varId].value = value;
+    }
+
+    void ShaderNull::setMatrixArray(int varId, const Matrix* values, int count)
+    {
+        if (count > 0) setMatrix(varId, values[0]);
+    }
+
+    void ShaderNull::setFloat(const std::string& varName, float value)
+    {
+        setFloat(getUniformId(varName), value);
+    }
+
+    void ShaderNull::setVector2(const std::string& varName, const Vector2& value)
+    {
+        setVector2(getUniformId(varName), value);
+    }
+
+    void ShaderNull::setVector3(const std::string& varName, const Vector3& value)
+    {
+        setVector3(getUniformId(varName), value);
+    }
+
+    void ShaderNull::setVector4(const std::string& varName, const Vector4& value)
+    {
+        setVector4(getUniformId(varName), value);
+    }
+
+    void ShaderNull::setMatrix(const std::string& varName, const Matrix& value)
+    {
+        setMatrix(getUniformId(varName), value);
+    }
+
+    void ShaderNull::setMatrixArray(const std::string& varName, const Matrix* values, int count)
+    {
+        setMatrixArray(getUniformId(varName), values, count);
+    }
+}
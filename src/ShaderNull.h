@@ -0,0 +1,55 @@
+#ifndef SHADERNULL_H_INCLUDED
+#define SHADERNULL_H_INCLUDED
+
+// Onut
+#include <onut/Shader.h>
+
+// Forward
+#include <onut/ForwardDeclaration.h>
+OForwardDeclare(ShaderNull)
+
+namespace onut
+{
+    /**
+    Shader of the null renderer. Sources are parsed so uniforms and the vertex
+    layout are known, nothing is compiled. Uniform values are kept for inspection.
+    */
+    class ShaderNull final : public Shader
+    {
+    public:
+        ShaderNull();
+        ~ShaderNull();
+
+        struct Uniform
+        {
+            VarType type;
+            Matrix value; // Everything is stored in a matrix, like GL
+            std::string name;
+        };
+
+        using Uniforms = std::vector<Uniform>;
+
+        const Uniforms& getUniforms() const { return m_uniforms; }
+
+        int getUniformId(const std::string& varName) const override;
+        void setFloat(int varId, float value) override;
+        void setVector2(int varId, const Vector2& value) override;
+        void setVector3(int varId, const Vector3& value) override;
+        void setVector4(int varId, const Vector4& value) override;
+        void setMatrix(int varId, const Matrix& value) override;
+        void setMatrixArray(int varId, const Matrix* values, int count) override;
+        void setFloat(const std::string& varName, float value) override;
+        void setVector2(const std::string& varName, const Vector2& value) override;
+        void setVector3(const std::string& varName, const Vector3& value) override;
+        void setVector4(const std::string& varName, const Vector4& value) override;
+        void setMatrix(const std::string& varName, const Matrix& value) override;
+        void setMatrixArray(const std::string& varName, const Matrix* values, int count) override;
+
+    private:
+        friend class Shader;
+
+        Uniforms m_uniforms;
+    };
+};
+
+#endif
@@ -8,57 +8,98 @@
 #include <onut/Texture.h>
 #include <onut/VertexBuffer.h>
 
+// Private
+#include "RadixSort.h"
+#include "SIMD.h"
+
 // STL
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstring>
 
 OSpriteBatchRef oSpriteBatch;
 
 namespace onut
 {
-    OSpriteBatchRef SpriteBatch::create()
+    OSpriteBatchRef SpriteBatch::create(uint32_t maxSpriteCount, uint32_t bufferCount)
     {
-        return OMake<SpriteBatch>();
+        return OMake<SpriteBatch>(maxSpriteCount, bufferCount);
     }
 
-    SpriteBatch::SpriteBatch()
+    OSpriteBatchRef SpriteBatch::createRecorder()
     {
-        // Create a white texture for rendering "without" texture
-        unsigned char white[4] = {255, 255, 255, 255};
-        m_pTexWhite = Texture::createFromData(white, {1, 1}, false);
+        return OMake<SpriteBatch>(DEFAULT_SPRITE_COUNT, 0);
+    }
 
-        // Create dynamic vertex buffer
-        m_pVertexBuffer = OVertexBuffer::createDynamic(sizeof(SVertexP2T2C4) * MAX_SPRITE_COUNT * 4);
+    SpriteBatch::SpriteBatch(uint32_t maxSpriteCount, uint32_t bufferCount)
+    {
+        m_maxSpriteCount = std::max<uint32_t>(1, std::min(maxSpriteCount, MAX_SPRITE_COUNT));
+        m_snapToPixel = oSettings->getIsRetroMode();
 
-        // Create index buffer
-        unsigned short indices[MAX_SPRITE_COUNT * 6];
-        for (unsigned int i = 0; i < MAX_SPRITE_COUNT; ++i)
+        // Create a white texture for rendering "without" texture. Share the main batch's one
+        // when we can, so untextured sprites from recorders don't break batches.
+        if (oSpriteBatch)
         {
-            indices[i * 6 + 0] = i * 4 + 0;
-            indices[i * 6 + 1] = i * 4 + 1;
-            indices[i * 6 + 2] = i * 4 + 2;
-            indices[i * 6 + 3] = i * 4 + 2;
-            indices[i * 6 + 4] = i * 4 + 3;
-            indices[i * 6 + 5] = i * 4 + 0;
+            m_pTexWhite = oSpriteBatch->m_pTexWhite;
+        }
+        else
+        {
+            unsigned char white[4] = {255, 255, 255, 255};
+            m_pTexWhite = Texture::createFromData(white, {1, 1}, false);
         }
-        m_pIndexBuffer = OIndexBuffer::createStatic(indices, sizeof(indices));
 
-        m_snapToPixel = oSettings->getIsRetroMode();
+        if (bufferCount == 0)
+        {
+            m_pRecordStates = OMake<RenderStates>();
+            m_pRecordStates->blendMode = OBlendPreMultiplied; // Same as setupFor2D()
+            m_pRenderStates = m_pRecordStates.get();
+            return;
+        }
+
+        // Create the ring of dynamic vertex buffers
+        for (uint32_t i = 0; i < bufferCount; ++i)
+        {
+            // Sized for the bigger multi-texture vertex, so the mode can change between batches
+            m_vertexBuffers.push_back(OVertexBuffer::createDynamic(sizeof(SVertexP2T2C4T1) * m_maxSpriteCount * 4));
+        }
+        m_pVertexBuffer = m_vertexBuffers.front();
+
+        // Share the renderer's quad indices. 16 bits indices address 16384 sprites
+        if (m_maxSpriteCount <= Renderer::QUAD_INDEX_BUFFER_QUAD_COUNT)
+        {
+            m_pIndexBuffer = oRenderer->getQuadIndexBuffer();
+        }
+        else
+        {
+            m_pIndexBuffer = Renderer::createQuadIndexBuffer(m_maxSpriteCount);
+        }
     }
 
     SpriteBatch::~SpriteBatch()
     {
     }
 
-    void SpriteBatch::begin()
+    void SpriteBatch::begin(SpriteSortMode sortMode)
     {
-        begin(Matrix::Identity);
+        begin(Matrix::Identity, sortMode);
     }
 
-    void SpriteBatch::begin(const Matrix& in_transform)
+    void SpriteBatch::begin(const Matrix& in_transform, SpriteSortMode sortMode)
     {
         if (m_isDrawing) return;
 
+        // Recorders only keep quads, the batch drawing them has the transform and sort mode
+        if (isRecorder())
+        {
+            clearCommands();
+            m_pTexture = nullptr;
+            m_pPageTexture = nullptr;
+            m_layer = 0.f;
+            m_isDrawing = true;
+            return;
+        }
+
         auto transform = in_transform;
         if (m_snapToPixel)
         {
@@ -69,11 +110,26 @@ namespace onut
         oRenderer->setupFor2D(transform);
         m_pRenderStates = &oRenderer->renderStates;
 
+        m_isMultiTexturing = m_multiTexture;
+        m_isPackingColors = m_packedColors;
+        if (m_isMultiTexturing)
+        {
+            m_pRenderStates->vertexShader = m_isPackingColors ? oRenderer->get2DMultiTexturePackedColorVS() : oRenderer->get2DMultiTextureVS();
+            m_pRenderStates->pixelShader = oRenderer->get2DMultiTexturePS();
+        }
+        else if (m_isPackingColors)
+        {
+            m_pRenderStates->vertexShader = oRenderer->get2DPackedColorVS();
+        }
+
         m_currentTransform = transform;
         m_pTexture = nullptr;
+        m_pPageTexture = nullptr;
         m_isDrawing = true;
+        m_sortMode = sortMode;
+        m_layer = 0.f;
 
-        m_pMappedVertexBuffer = reinterpret_cast<SVertexP2T2C4*>(m_pVertexBuffer->map());
+        m_pMappedVertexBuffer = reinterpret_cast<uint8_t*>(m_pVertexBuffer->map());
     }
 
     void SpriteBatch::drawRectWithColors(const OTextureRef& pTexture, const Rect& rect, const std::vector<Color>& colors)
@@ -82,10 +138,10 @@ namespace onut
         assert(colors.size() == 4); // Needs 4 colors
 
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         changeTexture(pTexture);
 
-        SVertexP2T2C4* pVerts = m_pMappedVertexBuffer + (m_spriteCount * 4);
+        SVertexP2T2C4* pVerts = nextQuad();
         pVerts[0].position = {rect.x, rect.y};
         pVerts[0].texCoord = {0, 0};
         pVerts[0].color = colors[0];
@@ -102,18 +158,13 @@ namespace onut
         pVerts[3].texCoord = {1, 0};
         pVerts[3].color = colors[3];
 
-        ++m_spriteCount;
-
-        if (m_spriteCount == MAX_SPRITE_COUNT)
-        {
-            flush();
-        }
+        commitQuad();
     }
 
     void SpriteBatch::drawAbsoluteRect(const OTextureRef& pTexture, const Rect& rect, const Color& color)
     {
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         drawRect(pTexture, {rect.x, rect.y, rect.z - rect.x, rect.w - rect.y}, color);
     }
 
@@ -121,7 +172,7 @@ namespace onut
     {
         assert(m_isDrawing); // Should call begin() before calling draw()
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
 
         drawRect(m_pTexWhite, {rect.x, rect.y, rect.z, thickness}, color);
         drawRect(m_pTexWhite, {rect.x, rect.y + rect.w - thickness, rect.z, thickness}, color);
@@ -133,7 +184,7 @@ namespace onut
     {
         assert(m_isDrawing); // Should call begin() before calling draw()
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
 
         drawRect(m_pTexWhite, {rect.x - thickness, rect.y - thickness, rect.z + thickness * 2, thickness}, color);
         drawRect(m_pTexWhite, {rect.x - thickness, rect.y + rect.w, rect.z + thickness * 2, thickness}, color);
@@ -146,10 +197,10 @@ namespace onut
         assert(m_isDrawing); // Should call begin() before calling draw()
 
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         changeTexture(pTexture);
 
-        SVertexP2T2C4* pVerts = m_pMappedVertexBuffer + (m_spriteCount * 4);
+        SVertexP2T2C4* pVerts = nextQuad();
         pVerts[0].position = {rect.x, rect.y};
         pVerts[0].texCoord = {0, 0};
         pVerts[0].color = color;
@@ -166,12 +217,7 @@ namespace onut
         pVerts[3].texCoord = {1, 0};
         pVerts[3].color = color;
 
-        ++m_spriteCount;
-
-        if (m_spriteCount == MAX_SPRITE_COUNT)
-        {
-            flush();
-        }
+        commitQuad();
     }
 
     void SpriteBatch::drawRectScaled9(const OTextureRef& pTexture, const Rect& rect, const Vector4& padding, const Color& color)
@@ -179,7 +225,7 @@ namespace onut
         assert(m_isDrawing); // Should call begin() before calling draw()
 
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         changeTexture(pTexture);
 
         auto textureSize = m_pTexture->getSize();
@@ -223,7 +269,7 @@ namespace onut
         assert(m_isDrawing); // Should call begin() before calling draw()
 
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         changeTexture(pTexture);
 
         auto textureSize = m_pTexture->getSize();
@@ -303,10 +349,10 @@ namespace onut
         assert(m_isDrawing); // Should call begin() before calling draw()
 
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         changeTexture(pTexture);
 
-        SVertexP2T2C4* pVerts = m_pMappedVertexBuffer + (m_spriteCount * 4);
+        SVertexP2T2C4* pVerts = nextQuad();
         pVerts[0].position = {rect.x, rect.y};
         pVerts[0].texCoord = {0, 0};
         pVerts[0].color = color;
@@ -323,12 +369,7 @@ namespace onut
         pVerts[3].texCoord = {1, 0};
         pVerts[3].color = color;
 
-        ++m_spriteCount;
-
-        if (m_spriteCount == MAX_SPRITE_COUNT)
-        {
-            flush();
-        }
+        commitQuad();
     }
 
     void SpriteBatch::drawRectWithUVs(const OTextureRef& pTexture, const Rect& rect, const Vector4& uvs, const Color& color)
@@ -336,10 +377,10 @@ namespace onut
         assert(m_isDrawing); // Should call begin() before calling draw()
 
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         changeTexture(pTexture);
 
-        SVertexP2T2C4* pVerts = m_pMappedVertexBuffer + (m_spriteCount * 4);
+        SVertexP2T2C4* pVerts = nextQuad();
         pVerts[0].position = {rect.x, rect.y};
         pVerts[0].texCoord = {uvs.x, uvs.y};
         pVerts[0].color = color;
@@ -356,12 +397,7 @@ namespace onut
         pVerts[3].texCoord = {uvs.z, uvs.y};
         pVerts[3].color = color;
 
-        ++m_spriteCount;
-
-        if (m_spriteCount == MAX_SPRITE_COUNT)
-        {
-            flush();
-        }
+        commitQuad();
     }
 
     void SpriteBatch::drawRectWithUVsColors(const OTextureRef& pTexture, const Rect& rect, const Vector4& uvs, const std::vector<Color>& colors)
@@ -370,10 +406,10 @@ namespace onut
         assert(colors.size() == 4); // Needs 4 colors
 
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         changeTexture(pTexture);
 
-        SVertexP2T2C4* pVerts = m_pMappedVertexBuffer + (m_spriteCount * 4);
+        SVertexP2T2C4* pVerts = nextQuad();
         pVerts[0].position = {rect.x, rect.y};
         pVerts[0].texCoord = {uvs.x, uvs.y};
         pVerts[0].color = colors[0];
@@ -390,30 +426,53 @@ namespace onut
         pVerts[3].texCoord = {uvs.z, uvs.y};
         pVerts[3].color = colors[3];
 
-        ++m_spriteCount;
-
-        if (m_spriteCount == MAX_SPRITE_COUNT)
-        {
-            flush();
-        }
+        commitQuad();
     }
 
     void SpriteBatch::changeTexture(const OTextureRef& pTexture)
     {
-        if (!pTexture && m_pTexture == m_pTexWhite) return;
-        if (pTexture != m_pTexture)
+        auto& pNewTexture = pTexture ? pTexture : m_pTexWhite;
+        if (pNewTexture == m_pTexture) return;
+
+        // Textures packed in the same atlas page don't break the batch
+        auto& pNewPage = pNewTexture->getAtlasPage() ? pNewTexture->getAtlasPage() : pNewTexture;
+        m_remapUVs = pNewTexture->getAtlasPage() != nullptr;
+        m_uvRect = pNewTexture->getAtlasUVs();
+
+        // Recording sorted sprites only needs the current texture
+        if (m_isMultiTexturing && m_sortMode == SpriteSortMode::Immediate)
+        {
+            int slot = 0;
+            while (slot < m_slotCount && m_slotTextures[slot] != pNewPage) ++slot;
+            if (slot == m_slotCount)
+            {
+                // A 9th texture, draw what we have and start over
+                if (m_slotCount == MAX_BATCH_TEXTURES)
+                {
+                    flush(FlushReason::TextureChange);
+                    slot = 0;
+                }
+                m_slotTextures[slot] = pNewPage;
+                m_slotCount = slot + 1;
+            }
+            m_pTexture = pNewTexture;
+            m_pPageTexture = pNewPage;
+            m_textureSlot = static_cast<float>(slot);
+            return;
+        }
+
+        if (pNewPage != m_pPageTexture)
         {
-            flush();
-            if (!pTexture) m_pTexture = m_pTexWhite;
-            else m_pTexture = pTexture;
+            flush(FlushReason::TextureChange);
+            m_pPageTexture = pNewPage;
         }
-        if (!m_pTexture) m_pTexture = m_pTexWhite;
+        m_pTexture = pNewTexture;
     }
 
     void SpriteBatch::draw4Corner(const OTextureRef& pTexture, const Rect& rect, const Color& color)
     {
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         changeTexture(pTexture);
 
         auto textureSize = m_pTexture->getSize();
@@ -429,7 +488,7 @@ namespace onut
     void SpriteBatch::drawSprite(const OTextureRef& pTexture, const Vector2& position, const Color& color, const Vector2& origin)
     {
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         changeTexture(pTexture);
 
         auto& textureSize = m_pTexture->getSize();
@@ -441,14 +500,14 @@ namespace onut
     void SpriteBatch::drawSprite(const OTextureRef& pTexture, const Matrix& transform, const Color& color, const Vector2& origin)
     {
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         changeTexture(pTexture);
 
         auto sizef = m_pTexture->getSizef();
 
         auto invOrigin = Vector2(1.f - origin.x, 1.f - origin.y);
 
-        SVertexP2T2C4* pVerts = m_pMappedVertexBuffer + (m_spriteCount * 4);
+        SVertexP2T2C4* pVerts = nextQuad();
         pVerts[0].position = Vector2::Transform(Vector2(-sizef.x * origin.x, -sizef.y * origin.y), transform);
         pVerts[0].texCoord = {0, 0};
         pVerts[0].color = color;
@@ -465,24 +524,19 @@ namespace onut
         pVerts[3].texCoord = {1, 0};
         pVerts[3].color = color;
 
-        ++m_spriteCount;
-
-        if (m_spriteCount == MAX_SPRITE_COUNT)
-        {
-            flush();
-        }
+        commitQuad();
     }
     void SpriteBatch::drawSprite(const OTextureRef& pTexture, const Matrix& transform, const Vector2& scale, const Color& color, const Vector2& origin)
     {
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         changeTexture(pTexture);
 
         auto sizef = m_pTexture->getSizef() * scale;
 
         auto invOrigin = Vector2(1.f - origin.x, 1.f - origin.y);
 
-        SVertexP2T2C4* pVerts = m_pMappedVertexBuffer + (m_spriteCount * 4);
+        SVertexP2T2C4* pVerts = nextQuad();
         pVerts[0].position = Vector2::Transform(Vector2(-sizef.x * origin.x, -sizef.y * origin.y), transform);
         pVerts[0].texCoord = {0, 0};
         pVerts[0].color = color;
@@ -499,18 +553,13 @@ namespace onut
         pVerts[3].texCoord = {1, 0};
         pVerts[3].color = color;
 
-        ++m_spriteCount;
-
-        if (m_spriteCount == MAX_SPRITE_COUNT)
-        {
-            flush();
-        }
+        commitQuad();
     }
 
     void SpriteBatch::drawSpriteWithUVs(const OTextureRef& pTexture, const Matrix& transform, const Vector4& uvs, const Color& color, const Vector2& origin)
     {
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         changeTexture(pTexture);
 
         auto sizef = m_pTexture->getSizef();
@@ -519,7 +568,7 @@ namespace onut
 
         auto invOrigin = Vector2(1.f - origin.x, 1.f - origin.y);
 
-        SVertexP2T2C4* pVerts = m_pMappedVertexBuffer + (m_spriteCount * 4);
+        SVertexP2T2C4* pVerts = nextQuad();
         pVerts[0].position = Vector2::Transform(Vector2(-sizef.x * origin.x, -sizef.y * origin.y), transform);
         pVerts[0].texCoord = {uvs.x, uvs.y};
         pVerts[0].color = color;
@@ -536,18 +585,13 @@ namespace onut
         pVerts[3].texCoord = {uvs.z, uvs.y};
         pVerts[3].color = color;
 
-        ++m_spriteCount;
-
-        if (m_spriteCount == MAX_SPRITE_COUNT)
-        {
-            flush();
-        }
+        commitQuad();
     }
 
     void SpriteBatch::drawSpriteWithUVs(const OTextureRef& pTexture, const Matrix& transform, const Vector2& scale, const Vector4& uvs, const Color& color, const Vector2& origin)
     {
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         changeTexture(pTexture);
 
         auto sizef = m_pTexture->getSizef();
@@ -558,7 +602,7 @@ namespace onut
 
         auto invOrigin = Vector2(1.f - origin.x, 1.f - origin.y);
 
-        SVertexP2T2C4* pVerts = m_pMappedVertexBuffer + (m_spriteCount * 4);
+        SVertexP2T2C4* pVerts = nextQuad();
         pVerts[0].position = Vector2::Transform(Vector2(-sizef.x * origin.x, -sizef.y * origin.y), transform);
         pVerts[0].texCoord = {uvs.x, uvs.y};
         pVerts[0].color = color;
@@ -575,18 +619,13 @@ namespace onut
         pVerts[3].texCoord = {uvs.z, uvs.y};
         pVerts[3].color = color;
 
-        ++m_spriteCount;
-
-        if (m_spriteCount == MAX_SPRITE_COUNT)
-        {
-            flush();
-        }
+        commitQuad();
     }
 
     void SpriteBatch::drawSpriteWithUVs(const OTextureRef& pTexture, const Vector2& position, const Vector4& uvs, const Color& color, float rotation, float scale, const Vector2& origin)
     {
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         changeTexture(pTexture);
 
         auto textureSize = m_pTexture->getSize();
@@ -603,7 +642,7 @@ namespace onut
         Vector2 right{cosTheta * hSize.x, sinTheta * hSize.x};
         Vector2 down{-sinTheta * hSize.y, cosTheta * hSize.y};
 
-        SVertexP2T2C4* pVerts = m_pMappedVertexBuffer + (m_spriteCount * 4);
+        SVertexP2T2C4* pVerts = nextQuad();
         pVerts[0].position = position;
         pVerts[0].position -= right * origin.x * 2.f;
         pVerts[0].position -= down * origin.y * 2.f;
@@ -628,18 +667,13 @@ namespace onut
         pVerts[3].texCoord = {uvs.z, uvs.y};
         pVerts[3].color = color;
 
-        ++m_spriteCount;
-
-        if (m_spriteCount == MAX_SPRITE_COUNT)
-        {
-            flush();
-        }
+        commitQuad();
     }
 
     void SpriteBatch::drawBeam(const OTextureRef& pTexture, const Vector2& from, const Vector2& to, float size, const Color& color, float uOffset, float uScale)
     {
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         changeTexture(pTexture);
 
         auto texSize = m_pTexture->getSizef();
@@ -650,7 +684,7 @@ namespace onut
         Vector2 right{-dir.y, dir.x};
         right *= size * .5f;
 
-        SVertexP2T2C4* pVerts = m_pMappedVertexBuffer + (m_spriteCount * 4);
+        SVertexP2T2C4* pVerts = nextQuad();
         pVerts[0].position = Vector2(from.x - right.x, from.y - right.y);
         pVerts[0].texCoord = {uOffset, 0};
         pVerts[0].color = color;
@@ -667,18 +701,13 @@ namespace onut
         pVerts[3].texCoord = {uOffset + len * uScale / texSize.x, 0};
         pVerts[3].color = color;
 
-        ++m_spriteCount;
-
-        if (m_spriteCount == MAX_SPRITE_COUNT)
-        {
-            flush();
-        }
+        commitQuad();
     }
 
     void SpriteBatch::drawCross(const Vector2& position, float size, const Color& color, float thickness)
     {
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
 
         drawRect(nullptr, {position.x - thickness * .5f, position.y - size, thickness, size * 2.f}, color);
         drawRect(nullptr, {position.x - size, position.y - thickness * .5f, size * 2.f, thickness}, color);
@@ -687,7 +716,7 @@ namespace onut
     void SpriteBatch::drawSprite(const OTextureRef& pTexture, const Vector2& position, const Color& color, float rotation, float scale, const Vector2& origin)
     {
         if (m_pRenderStates->blendMode.isDirty() ||
-            m_pRenderStates->sampleFiltering.isDirty()) flush();
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
         changeTexture(pTexture);
 
         auto textureSize = m_pTexture->getSize();
@@ -702,7 +731,7 @@ namespace onut
         Vector2 right{cosTheta * hSize.x, sinTheta * hSize.x};
         Vector2 down{-sinTheta * hSize.y, cosTheta * hSize.y};
 
-        SVertexP2T2C4* pVerts = m_pMappedVertexBuffer + (m_spriteCount * 4);
+        SVertexP2T2C4* pVerts = nextQuad();
         pVerts[0].position = position;
         pVerts[0].position -= right * origin.x * 2.f;
         pVerts[0].position -= down * origin.y * 2.f;
@@ -727,11 +756,138 @@ namespace onut
         pVerts[3].texCoord = {1, 0};
         pVerts[3].color = color;
 
-        ++m_spriteCount;
+        commitQuad();
+    }
+
+    void SpriteBatch::drawSprites(const OTextureRef& pTexture, const std::vector<SpriteInstance>& sprites)
+    {
+        drawSprites(pTexture, sprites.data(), sprites.size());
+    }
+
+    void SpriteBatch::drawSprites(const OTextureRef& pTexture, const SpriteInstance* pSprites, size_t count)
+    {
+        if (m_pRenderStates->blendMode.isDirty() ||
+            m_pRenderStates->sampleFiltering.isDirty()) flush(FlushReason::StateChange);
+
+        // Plain immediate batches get the vertices written in place. Other modes
+        // finish the quads their own way through nextQuad() and commitQuad().
+        auto isDirect = m_sortMode == SpriteSortMode::Immediate && !isRecorder() && !m_isMultiTexturing && !m_isPackingColors;
+        SVertexP2T2C4 quads[Float4::WIDTH * 4];
+        for (size_t i = 0; i < count; i += Float4::WIDTH)
+        {
+            auto groupCount = std::min(Float4::WIDTH, count - i);
+            changeTexture(pTexture); // A full flush unsets it
+            if (isDirect && m_maxSpriteCount - m_spriteCount >= Float4::WIDTH)
+            {
+                auto pVerts = reinterpret_cast<SVertexP2T2C4*>(m_pMappedVertexBuffer) + (m_spriteCount * 4);
+                generateSprites(pSprites + i, groupCount, pVerts, true);
+                m_spriteCount += static_cast<unsigned int>(groupCount);
+                if (m_spriteCount == m_maxSpriteCount)
+                {
+                    flush(FlushReason::Full);
+                }
+                continue;
+            }
+
+            generateSprites(pSprites + i, groupCount, quads, false);
+            for (size_t j = 0; j < groupCount; ++j)
+            {
+                changeTexture(pTexture);
+                memcpy(nextQuad(), quads + j * 4, sizeof(SVertexP2T2C4) * 4);
+                commitQuad();
+            }
+        }
+    }
+
+    void SpriteBatch::generateSprites(const SpriteInstance* pSprites, size_t count, SVertexP2T2C4* pVerts, bool isFinal)
+    {
+        // Transpose to one lane per sprite. Unused lanes get a default sprite and are ignored.
+        static const SpriteInstance DEFAULT_SPRITE;
+        float positionX[4], positionY[4], rotation[4], sizeX[4], sizeY[4], originX[4], originY[4];
+        float u1[4], v1[4], u2[4], v2[4];
+        auto textureSize = m_pTexture->getSizef();
+        for (size_t i = 0; i < Float4::WIDTH; ++i)
+        {
+            auto& sprite = (i < count) ? pSprites[i] : DEFAULT_SPRITE;
+            positionX[i] = sprite.position.x;
+            positionY[i] = sprite.position.y;
+            rotation[i] = sprite.rotation;
+            sizeX[i] = textureSize.x * std::abs(sprite.uvs.z - sprite.uvs.x) * sprite.scale.x;
+            sizeY[i] = textureSize.y * std::abs(sprite.uvs.w - sprite.uvs.y) * sprite.scale.y;
+            originX[i] = sprite.origin.x;
+            originY[i] = sprite.origin.y;
+            u1[i] = sprite.uvs.x;
+            v1[i] = sprite.uvs.y;
+            u2[i] = sprite.uvs.z;
+            v2[i] = sprite.uvs.w;
+        }
+
+        Float4 sinTheta, cosTheta;
+        sinCos(Float4::load(rotation) * Float4(OPI / 180.f), sinTheta, cosTheta);
+        auto sx = Float4::load(sizeX);
+        auto sy = Float4::load(sizeY);
+        auto rightX = cosTheta * sx;
+        auto rightY = sinTheta * sx;
+        auto downX = Float4(0.f) - sinTheta * sy;
+        auto downY = cosTheta * sy;
+
+        // Corners relative to the origin
+        auto ox = Float4::load(originX);
+        auto oy = Float4::load(originY);
+        auto ix = Float4(1.f) - ox;
+        auto iy = Float4(1.f) - oy;
+        auto px = Float4::load(positionX);
+        auto py = Float4::load(positionY);
+        Float4 cornersX[4] = {
+            px - rightX * ox - downX * oy,
+            px - rightX * ox + downX * iy,
+            px + rightX * ix + downX * iy,
+            px + rightX * ix - downX * oy
+        };
+        Float4 cornersY[4] = {
+            py - rightY * ox - downY * oy,
+            py - rightY * ox + downY * iy,
+            py + rightY * ix + downY * iy,
+            py + rightY * ix - downY * oy
+        };
+
+        // Written in place, the quads need to be final: snapped and in atlas UVs
+        Float4 uvs[4] = {Float4::load(u1), Float4::load(v1), Float4::load(u2), Float4::load(v2)};
+        if (isFinal)
+        {
+            if (m_snapToPixel)
+            {
+                for (int c = 0; c < 4; ++c)
+                {
+                    cornersX[c] = round(cornersX[c]);
+                    cornersY[c] = round(cornersY[c]);
+                }
+            }
+            if (m_remapUVs)
+            {
+                auto uvSizeX = Float4(m_uvRect.z - m_uvRect.x);
+                auto uvSizeY = Float4(m_uvRect.w - m_uvRect.y);
+                uvs[0] = Float4(m_uvRect.x) + uvs[0] * uvSizeX;
+                uvs[1] = Float4(m_uvRect.y) + uvs[1] * uvSizeY;
+                uvs[2] = Float4(m_uvRect.x) + uvs[2] * uvSizeX;
+                uvs[3] = Float4(m_uvRect.y) + uvs[3] * uvSizeY;
+            }
+        }
 
-        if (m_spriteCount == MAX_SPRITE_COUNT)
+        float x[4][4], y[4][4], uv[4][4];
+        for (int c = 0; c < 4; ++c)
         {
-            flush();
+            cornersX[c].store(x[c]);
+            cornersY[c].store(y[c]);
+            uvs[c].store(uv[c]);
+        }
+        for (size_t i = 0; i < count; ++i, pVerts += 4)
+        {
+            auto& color = pSprites[i].color;
+            pVerts[0] = {{x[0][i], y[0][i]}, {uv[0][i], uv[1][i]}, color};
+            pVerts[1] = {{x[1][i], y[1][i]}, {uv[0][i], uv[3][i]}, color};
+            pVerts[2] = {{x[2][i], y[2][i]}, {uv[2][i], uv[3][i]}, color};
+            pVerts[3] = {{x[3][i], y[3][i]}, {uv[2][i], uv[1][i]}, color};
         }
     }
 
@@ -765,48 +921,297 @@ namespace onut
     void SpriteBatch::end()
     {
         if (!m_isDrawing) return;
+        if (isRecorder())
+        {
+            m_isDrawing = false;
+            return;
+        }
 
         m_isDrawing = false;
-        if (m_spriteCount)
+        flush(FlushReason::Explicit);
+
+        m_pVertexBuffer->unmap(getVertexSize() * m_spriteCount * 4);
+    }
+
+    void SpriteBatch::setMultiTexture(bool multiTexture)
+    {
+        m_multiTexture = multiTexture;
+    }
+
+    void SpriteBatch::setPackedColors(bool packedColors)
+    {
+        m_packedColors = packedColors;
+    }
+
+    uint32_t SpriteBatch::getVertexSize() const
+    {
+        if (m_isPackingColors) return m_isMultiTexturing ? sizeof(SVertexP2T2C4ubT1) : sizeof(SVertexP2T2C4ub);
+        return m_isMultiTexturing ? sizeof(SVertexP2T2C4T1) : sizeof(SVertexP2T2C4);
+    }
+
+    void SpriteBatch::setLayer(float layer)
+    {
+        m_layer = std::max(0.f, std::min(1.f, layer));
+    }
+
+    SpriteBatch::SVertexP2T2C4* SpriteBatch::nextQuad()
+    {
+        if (m_sortMode == SpriteSortMode::Immediate && !isRecorder())
+        {
+            // Multi-texture and packed color vertices are completed in commitQuad()
+            if (m_isMultiTexturing || m_isPackingColors) m_pQuad = m_quad;
+            else m_pQuad = reinterpret_cast<SVertexP2T2C4*>(m_pMappedVertexBuffer) + (m_spriteCount * 4);
+            return m_pQuad;
+        }
+
+        // Textures are referred to by their order of first use, which keeps the sort stable between frames.
+        // Packed textures record their page, their UVs are already remapped when replayed.
+        auto pTexture = m_pPageTexture.get();
+        if (pTexture != m_pLastCommandTexture)
+        {
+            auto it = m_commandTextureIndices.find(pTexture);
+            if (it == m_commandTextureIndices.end())
+            {
+                it = m_commandTextureIndices.insert({pTexture, static_cast<uint32_t>(m_commandTextures.size())}).first;
+                m_commandTextures.push_back(m_pPageTexture);
+            }
+            m_pLastCommandTexture = pTexture;
+            m_lastCommandTextureIndex = it->second;
+        }
+
+        SpriteCommand command;
+        command.textureIndex = m_lastCommandTextureIndex;
+        command.layer = static_cast<uint16_t>(m_layer * 65535.f);
+        command.blendMode = static_cast<uint8_t>(m_pRenderStates->blendMode.get());
+        command.filtering = static_cast<uint8_t>(m_pRenderStates->sampleFiltering.get());
+        m_commands.push_back(command);
+
+        auto vertexCount = m_commandVertices.size();
+        m_commandVertices.resize(vertexCount + 4);
+        m_pQuad = m_commandVertices.data() + vertexCount;
+        return m_pQuad;
+    }
+
+    void SpriteBatch::commitQuad()
+    {
+        if (m_snapToPixel)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                auto& position = m_pQuad[i].position;
+                position.x = std::round(position.x);
+                position.y = std::round(position.y);
+            }
+        }
+        if (m_remapUVs)
+        {
+            auto uvSize = Vector2(m_uvRect.z - m_uvRect.x, m_uvRect.w - m_uvRect.y);
+            for (int i = 0; i < 4; ++i)
+            {
+                auto& texCoord = m_pQuad[i].texCoord;
+                texCoord.x = m_uvRect.x + texCoord.x * uvSize.x;
+                texCoord.y = m_uvRect.y + texCoord.y * uvSize.y;
+            }
+        }
+
+        if (m_sortMode != SpriteSortMode::Immediate || isRecorder()) return;
+
+        if (m_isPackingColors)
+        {
+            uint32_t colors[4];
+            for (int i = 0; i < 4; ++i)
+            {
+                Color color;
+                m_quad[i].color.Saturate(color);
+                colors[i] = color.pack();
+            }
+            if (m_isMultiTexturing)
+            {
+                auto pVerts = reinterpret_cast<SVertexP2T2C4ubT1*>(m_pMappedVertexBuffer) + (m_spriteCount * 4);
+                for (int i = 0; i < 4; ++i)
+                {
+                    pVerts[i].position = m_quad[i].position;
+                    pVerts[i].texCoord = m_quad[i].texCoord;
+                    pVerts[i].color = colors[i];
+                    pVerts[i].textureIndex = m_textureSlot;
+                }
+            }
+            else
+            {
+                auto pVerts = reinterpret_cast<SVertexP2T2C4ub*>(m_pMappedVertexBuffer) + (m_spriteCount * 4);
+                for (int i = 0; i < 4; ++i)
+                {
+                    pVerts[i].position = m_quad[i].position;
+                    pVerts[i].texCoord = m_quad[i].texCoord;
+                    pVerts[i].color = colors[i];
+                }
+            }
+        }
+        else if (m_isMultiTexturing)
+        {
+            auto pVerts = reinterpret_cast<SVertexP2T2C4T1*>(m_pMappedVertexBuffer) + (m_spriteCount * 4);
+            for (int i = 0; i < 4; ++i)
+            {
+                pVerts[i].position = m_quad[i].position;
+                pVerts[i].texCoord = m_quad[i].texCoord;
+                pVerts[i].color = m_quad[i].color;
+                pVerts[i].textureIndex = m_textureSlot;
+            }
+        }
+
+        ++m_spriteCount;
+        if (m_spriteCount == m_maxSpriteCount)
+        {
+            flush(FlushReason::Full);
+        }
+    }
+
+    void SpriteBatch::drawSorted()
+    {
+        auto count = m_commands.size();
+        if (!count) return;
+
+        // Layer, then states, then texture. Texture mode ignores the layer.
+        m_sortKeys.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto& command = m_commands[i];
+            uint64_t layer = 0;
+            if (m_sortMode == SpriteSortMode::BackToFront) layer = 65535 - command.layer;
+            else if (m_sortMode == SpriteSortMode::FrontToBack) layer = command.layer;
+            m_sortKeys[i] =
+                (layer << 48) |
+                (static_cast<uint64_t>(command.blendMode) << 40) |
+                (static_cast<uint64_t>(command.filtering) << 32) |
+                static_cast<uint64_t>(command.textureIndex);
+        }
+        if (!m_pSort) m_pSort = OMake<RadixSort>();
+        auto pOrder = m_pSort->sort(m_sortKeys.data(), count);
+
+        // Replay in order through the immediate path, it takes care of grouping the draws
+        auto sortMode = m_sortMode;
+        m_sortMode = SpriteSortMode::Immediate;
+        replay(*this, pOrder);
+        flush(FlushReason::Explicit);
+        m_sortMode = sortMode;
+        clearCommands();
+    }
+
+    void SpriteBatch::drawRecorded(const OSpriteBatchRef& pRecorder)
+    {
+        if (!pRecorder || !m_isDrawing) return;
+        assert(pRecorder.get() != this);
+        replay(*pRecorder, nullptr);
+    }
+
+    void SpriteBatch::replay(const SpriteBatch& source, const uint32_t* pOrder)
+    {
+        auto blendMode = m_pRenderStates->blendMode.get();
+        auto filtering = m_pRenderStates->sampleFiltering.get();
+        auto layer = m_layer;
+        m_pTexture = nullptr;
+        m_pPageTexture = nullptr;
+        auto count = source.m_commands.size();
+        for (size_t i = 0; i < count; ++i)
         {
-            flush();
+            auto index = pOrder ? pOrder[i] : static_cast<uint32_t>(i);
+            auto& command = source.m_commands[index];
+            auto commandBlendMode = static_cast<BlendMode>(command.blendMode);
+            auto commandFiltering = static_cast<sample::Filtering>(command.filtering);
+            if (commandBlendMode != m_pRenderStates->blendMode.get() ||
+                commandFiltering != m_pRenderStates->sampleFiltering.get())
+            {
+                flush(FlushReason::StateChange);
+                m_pRenderStates->blendMode = commandBlendMode;
+                m_pRenderStates->sampleFiltering = commandFiltering;
+            }
+            m_layer = static_cast<float>(command.layer) / 65535.f;
+            changeTexture(source.m_commandTextures[command.textureIndex]);
+            memcpy(nextQuad(), source.m_commandVertices.data() + index * 4, sizeof(SVertexP2T2C4) * 4);
+            commitQuad();
         }
 
-        m_pVertexBuffer->unmap(sizeof(SVertexP2T2C4) * m_spriteCount * 4);
+        // What's left was drawn with the replayed states
+        if (blendMode != m_pRenderStates->blendMode.get() ||
+            filtering != m_pRenderStates->sampleFiltering.get())
+        {
+            flush(FlushReason::StateChange);
+            m_pRenderStates->blendMode = blendMode;
+            m_pRenderStates->sampleFiltering = filtering;
+        }
+        m_layer = layer;
+    }
+
+    void SpriteBatch::clearCommands()
+    {
+        m_commands.clear();
+        m_commandVertices.clear();
+        m_commandTextures.clear();
+        m_commandTextureIndices.clear();
+        m_pLastCommandTexture = nullptr;
+    }
+
+    void SpriteBatch::resetFlushStats()
+    {
+        m_flushStats = FlushStats();
     }
 
     void SpriteBatch::flush()
     {
+        flush(FlushReason::Explicit);
+    }
+
+    void SpriteBatch::flush(FlushReason reason)
+    {
+        // Recorders keep everything until they are drawn
+        if (isRecorder()) return;
+
+        // Sorted modes only draw when asked to, texture and state changes are recorded per sprite
+        if (m_sortMode != SpriteSortMode::Immediate)
+        {
+            if (reason == FlushReason::Explicit) drawSorted();
+            return;
+        }
+
         if (!m_spriteCount)
         {
             return; // Nothing to flush
         }
 
-        if (m_snapToPixel)
+        ++m_flushStats.reasons[(int)reason];
+        ++m_flushStats.drawCalls;
+        m_flushStats.spriteCount += m_spriteCount;
+
+        auto previousStatsSource = oRenderer->setStatsSource(FrameStats::Source::SpriteBatch);
+
+        m_pVertexBuffer->unmap(getVertexSize() * m_spriteCount * 4);
+
+        if (m_isMultiTexturing)
         {
-            auto len = m_spriteCount * 4;
-            auto pVert = m_pMappedVertexBuffer;
-            float xy[2];
-            for (unsigned int i = 0; i < len; ++i, ++pVert)
+            for (int i = 0; i < m_slotCount; ++i)
             {
-                memcpy(xy, pVert, sizeof(xy));
-                xy[0] = std::round(xy[0]);
-                xy[1] = std::round(xy[1]);
-                memcpy(pVert, xy, sizeof(xy));
+                m_pRenderStates->textures[i] = m_slotTextures[i];
+                m_slotTextures[i] = nullptr;
             }
+            m_slotCount = 0;
+        }
+        else
+        {
+            m_pRenderStates->textures[0] = m_pPageTexture;
         }
-
-        m_pVertexBuffer->unmap(sizeof(SVertexP2T2C4) * m_spriteCount * 4);
-
-        m_pRenderStates->textures[0] = m_pTexture;
         m_pRenderStates->primitiveMode = OPrimitiveTriangleList;
         m_pRenderStates->indexBuffer = m_pIndexBuffer;
         m_pRenderStates->vertexBuffer = m_pVertexBuffer;
         oRenderer->drawIndexed(6 * m_spriteCount);
+        oRenderer->setStatsSource(previousStatsSource);
 
-        m_pMappedVertexBuffer = reinterpret_cast<SVertexP2T2C4*>(m_pVertexBuffer->map());
+        // Fill the next buffer of the ring while the GPU reads this one
+        m_currentVertexBuffer = (m_currentVertexBuffer + 1) % m_vertexBuffers.size();
+        m_pVertexBuffer = m_vertexBuffers[m_currentVertexBuffer];
+        m_pMappedVertexBuffer = reinterpret_cast<uint8_t*>(m_pVertexBuffer->map());
 
         m_spriteCount = 0;
         m_pTexture = nullptr;
+        m_pPageTexture = nullptr;
     }
 }
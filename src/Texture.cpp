@@ -1,8 +1,13 @@
 // Onut
 #include <onut/ContentManager.h>
+#include <onut/Files.h>
 #include <onut/Renderer.h>
 #include <onut/Texture.h>
 
+// Third party
+#include <stb/stb_image.h>
+#include <json/json.h>
+
 // STL
 #include <cassert>
 
@@ -14,6 +19,82 @@ namespace onut
     {
     }
 
+    OTextureRef Texture::createFromFile(const std::string& filename, const OContentManagerRef& pContentManager, bool generateMipmaps)
+    {
+        Decoded decoded;
+        if (!decodeFile(filename, pContentManager, decoded)) return nullptr;
+        return createFromDecoded(filename, decoded, pContentManager, generateMipmaps);
+    }
+
+    bool Texture::decodeFile(const std::string& filename, const OContentManagerRef& in_pContentManager, Decoded& out)
+    {
+        auto pContentManager = in_pContentManager ? in_pContentManager : oContentManager;
+        bool premultiplied = true;
+
+        std::string assetFilename = pContentManager->findResourceFile(filename);
+        if (assetFilename.empty())
+        {
+            assetFilename = filename;
+        }
+
+        // Load config json.texture (optional)
+        if (onut::getExtension(assetFilename) == "TEXTURE")
+        {
+            Json::Value json;
+            Json::Reader reader;
+            reader.parse(onut::getFileString(assetFilename), json);
+
+            if (json["name"].isString())
+            {
+                assetFilename = pContentManager->findResourceFile(json["name"].asString());
+            }
+            else
+            {
+                // Assume fnt
+                assetFilename = pContentManager->findResourceFile(onut::getFilenameWithoutExtension(assetFilename) + ".fnt");
+            }
+            if (json["premultiplied"].isBool())
+            {
+                premultiplied = json["premultiplied"].asBool();
+            }
+        }
+
+        int w, h, n;
+        uint8_t* image = nullptr;
+        onut::readFile(assetFilename, [&](const uint8_t* pData, size_t dataSize)
+        {
+            image = stbi_load_from_memory(pData, (int)dataSize, &w, &h, &n, 4);
+        });
+        if (!image) return false;
+        out.pData = std::shared_ptr<uint8_t>(image, stbi_image_free);
+        out.size = {w, h};
+
+        // Pre multiplied
+        if (premultiplied)
+        {
+            uint8_t* pImageData = image;
+            auto len = w * h;
+            for (decltype(len) i = 0; i < len; ++i, pImageData += 4)
+            {
+                pImageData[0] = pImageData[0] * pImageData[3] / 255;
+                pImageData[1] = pImageData[1] * pImageData[3] / 255;
+                pImageData[2] = pImageData[2] * pImageData[3] / 255;
+            }
+        }
+        return true;
+    }
+
+    OTextureRef Texture::createFromDecoded(const std::string& filename, const Decoded& decoded, const OContentManagerRef& pContentManager, bool generateMipmaps)
+    {
+        if (!decoded.pData) return nullptr;
+
+        auto pRet = createFromData(decoded.pData.get(), decoded.size, generateMipmaps);
+        if (!pRet) return nullptr;
+        pRet->setName(onut::getFilename(filename));
+        pRet->m_type = Type::Static;
+        return pRet;
+    }
+
     const Point& Texture::getSize() const
     {
         return m_size;
@@ -0,0 +1,205 @@
+// Onut
+#include <onut/ContentManager.h>
+#include <onut/Files.h>
+#include <onut/Texture.h>
+#include <onut/TextureAtlas.h>
+
+// Third party
+#include <stb/stb_image.h>
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imgui/imstb_rectpack.h"
+
+// STL
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace onut
+{
+    /**
+    Reference to a region of an atlas page. It has no GPU resource of its own,
+    the renderer binds the page instead.
+    */
+    class AtlasTexture final : public Texture
+    {
+    public:
+        AtlasTexture(const OTextureRef& pPage, const Point& size, const Vector4& uvs)
+        {
+            m_pAtlasPage = pPage;
+            m_atlasUVs = uvs;
+            m_size = size;
+            m_type = Type::Static;
+        }
+
+        void clearRenderTarget(const Color& color) override {}
+        void blur(float amountX, float amountY) override {}
+        void sepia(const Vector3& tone, float saturation, float sepiaAmount) override {}
+        void crt() override {}
+        void cartoon(const Vector3& tone) override {}
+        void vignette(float amount) override {}
+        void setData(const uint8_t* pData) override { assert(false); } // Packed textures are read only
+        void resizeTarget(const Point& size) override {}
+    };
+
+    struct TextureAtlas::Page
+    {
+        stbrp_context context;
+        std::vector<stbrp_node> nodes;
+        std::vector<uint8_t> pixels;
+        OTextureRef pTexture;
+        bool isDirty = false;
+    };
+
+    OTextureAtlasRef TextureAtlas::create(const Point& pageSize, int padding, int maxTextureSize)
+    {
+        return OMake<TextureAtlas>(pageSize, padding, maxTextureSize);
+    }
+
+    TextureAtlas::TextureAtlas(const Point& pageSize, int padding, int maxTextureSize)
+        : m_pageSize(pageSize)
+        , m_padding(padding)
+        , m_maxTextureSize(maxTextureSize)
+    {
+    }
+
+    TextureAtlas::~TextureAtlas()
+    {
+    }
+
+    OTextureRef TextureAtlas::add(const std::string& name, const uint8_t* pData, const Point& size)
+    {
+        if (size.x <= 0 || size.y <= 0 || size.x > m_maxTextureSize || size.y > m_maxTextureSize) return nullptr;
+
+        std::unique_lock<std::mutex> locker(m_mutex);
+
+        auto it = m_textures.find(name);
+        if (it != m_textures.end()) return it->second;
+
+        stbrp_rect rect;
+        rect.id = 0;
+        rect.w = size.x + m_padding * 2;
+        rect.h = size.y + m_padding * 2;
+        if (rect.w > m_pageSize.x || rect.h > m_pageSize.y) return nullptr;
+
+        // Try the pages we have, then start a new one
+        Page* pPage = nullptr;
+        for (auto& pCandidate : m_pages)
+        {
+            stbrp_pack_rects(&pCandidate->context, &rect, 1);
+            if (rect.was_packed)
+            {
+                pPage = pCandidate.get();
+                break;
+            }
+        }
+        if (!pPage)
+        {
+            auto pNewPage = std::make_unique<Page>();
+            pNewPage->nodes.resize(m_pageSize.x);
+            pNewPage->pixels.resize(m_pageSize.x * m_pageSize.y * 4, 0);
+            pNewPage->pTexture = Texture::createDynamic(m_pageSize);
+            stbrp_init_target(&pNewPage->context, m_pageSize.x, m_pageSize.y, pNewPage->nodes.data(), static_cast<int>(pNewPage->nodes.size()));
+            stbrp_pack_rects(&pNewPage->context, &rect, 1);
+            assert(rect.was_packed);
+            pPage = pNewPage.get();
+            m_pages.push_back(std::move(pNewPage));
+        }
+
+        // Copy, extruding the border pixels in the padding
+        auto pSrc = reinterpret_cast<const uint32_t*>(pData);
+        auto pDst = reinterpret_cast<uint32_t*>(pPage->pixels.data());
+        for (int y = 0; y < rect.h; ++y)
+        {
+            auto srcY = std::max(0, std::min(size.y - 1, y - m_padding));
+            auto pSrcRow = pSrc + srcY * size.x;
+            auto pDstRow = pDst + (rect.y + y) * m_pageSize.x + rect.x;
+            for (int x = 0; x < m_padding; ++x)
+            {
+                pDstRow[x] = pSrcRow[0];
+                pDstRow[m_padding + size.x + x] = pSrcRow[size.x - 1];
+            }
+            memcpy(pDstRow + m_padding, pSrcRow, size.x * 4);
+        }
+        pPage->isDirty = true;
+
+        Vector4 uvs(
+            static_cast<float>(rect.x + m_padding) / static_cast<float>(m_pageSize.x),
+            static_cast<float>(rect.y + m_padding) / static_cast<float>(m_pageSize.y),
+            static_cast<float>(rect.x + m_padding + size.x) / static_cast<float>(m_pageSize.x),
+            static_cast<float>(rect.y + m_padding + size.y) / static_cast<float>(m_pageSize.y));
+        OTextureRef pRet = std::make_shared<AtlasTexture>(pPage->pTexture, size, uvs);
+        pRet->setName(name);
+        m_textures[name] = pRet;
+        return pRet;
+    }
+
+    OTextureRef TextureAtlas::addFile(const std::string& filename)
+    {
+        int w, h, n;
+        auto image = stbi_load(filename.c_str(), &w, &h, &n, 4);
+        if (!image) return nullptr;
+        Point size{w, h};
+
+        // Pre multiplied
+        uint8_t* pImageData = image;
+        auto len = size.x * size.y;
+        for (decltype(len) i = 0; i < len; ++i, pImageData += 4)
+        {
+            pImageData[0] = pImageData[0] * pImageData[3] / 255;
+            pImageData[1] = pImageData[1] * pImageData[3] / 255;
+            pImageData[2] = pImageData[2] * pImageData[3] / 255;
+        }
+
+        auto pRet = add(getFilename(filename), image, size);
+        stbi_image_free(image);
+        if (pRet) pRet->setFilename(filename);
+        return pRet;
+    }
+
+    size_t TextureAtlas::addFolder(const std::string& folder, const OContentManagerRef& pContentManager, bool deepSearch)
+    {
+        size_t count = 0;
+        auto filenames = findAllFiles(folder, "png", deepSearch);
+        for (auto& filename : filenames)
+        {
+            auto pTexture = addFile(filename);
+            if (!pTexture) continue;
+            if (pContentManager) pContentManager->addResource(pTexture->getName(), pTexture);
+            ++count;
+        }
+        return count;
+    }
+
+    OTextureRef TextureAtlas::get(const std::string& name)
+    {
+        std::unique_lock<std::mutex> locker(m_mutex);
+        auto it = m_textures.find(name);
+        if (it == m_textures.end()) return nullptr;
+        return it->second;
+    }
+
+    void TextureAtlas::upload()
+    {
+        std::unique_lock<std::mutex> locker(m_mutex);
+        for (auto& pPage : m_pages)
+        {
+            if (!pPage->isDirty) continue;
+            pPage->pTexture->setData(pPage->pixels.data());
+            pPage->isDirty = false;
+        }
+    }
+
+    size_t TextureAtlas::getPageCount()
+    {
+        std::unique_lock<std::mutex> locker(m_mutex);
+        return m_pages.size();
+    }
+
+    OTextureRef TextureAtlas::getPage(size_t index)
+    {
+        std::unique_lock<std::mutex> locker(m_mutex);
+        if (index >= m_pages.size()) return nullptr;
+        return m_pages[index]->pTexture;
+    }
+}
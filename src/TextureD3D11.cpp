@@ -1,7 +1,5 @@
 #if defined(WIN32)
 // Onut
-#include <onut/ContentManager.h>
-#include <onut/Files.h>
 #include <onut/Settings.h>
 
 // Private
@@ -11,11 +9,9 @@
 // Third party
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
-#include <json/json.h>
 
 // STL
 #include <cassert>
-#include <fstream>
 #include <vector>
 
 #define MS_COUNT 4
@@ -138,64 +134,6 @@ namespace onut
         return pRet;
     }
 
-    OTextureRef Texture::createFromFile(const std::string& filename, const OContentManagerRef& pContentManager, bool generateMipmaps)
-    {
-        bool premultiplied = true;
-                
-        std::string assetFilename = pContentManager->findResourceFile(filename);
-        if (assetFilename.empty())
-        {
-            assetFilename = filename;
-        }
-
-        // Load config json.font (optional)
-        if (onut::getExtension(assetFilename) == "TEXTURE")
-        {
-            std::ifstream fic(assetFilename);
-            Json::Value json;
-            fic >> json;
-            fic.close();
-
-            if (json["name"].isString())
-            {
-                assetFilename = pContentManager->findResourceFile(json["name"].asString());
-            }
-            else
-            {
-                // Assume fnt
-                assetFilename = pContentManager->findResourceFile(onut::getFilenameWithoutExtension(assetFilename) + ".fnt");
-            }
-            if (json["premultiplied"].isBool())
-            {
-                premultiplied = json["premultiplied"].asBool();
-            }
-        }
-
-        int w, h, n;
-        auto image = stbi_load(assetFilename.c_str(), &w, &h, &n, 4);
-        if (!image) return nullptr;
-        Point size{w, h};
-
-        // Pre multiplied
-        if (premultiplied)
-        {
-            uint8_t* pImageData = image;
-            auto len = size.x * size.y;
-            for (decltype(len) i = 0; i < len; ++i, pImageData += 4)
-            {
-                pImageData[0] = pImageData[0] * pImageData[3] / 255;
-                pImageData[1] = pImageData[1] * pImageData[3] / 255;
-                pImageData[2] = pImageData[2] * pImageData[3] / 255;
-            }
-        }
-
-        auto pRet = createFromData(image, size, generateMipmaps);
-        stbi_image_free(image);
-        pRet->setName(onut::getFilename(filename));
-        pRet->m_type = Type::Static;
-        return pRet;
-    }
-
     OTextureRef Texture::createFromFileData(const uint8_t* pData, uint32_t dataSize, bool generateMipmaps)
     {
         int w, h, n;
@@ -401,6 +339,7 @@ namespace onut
             memcpy(reinterpret_cast<uint8_t*>(data.pData) + y * data.RowPitch, pData + y * m_size.x * 4, m_size.x * 4);
         }
         pDeviceContext->Unmap(m_pTexture, 0);
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, m_size.x * m_size.y * 4);
     }
 
     TextureD3D11::~TextureD3D11()
@@ -1,6 +1,4 @@
 // Onut
-#include <onut/ContentManager.h>
-#include <onut/Files.h>
 #include <onut/Settings.h>
 
 // Private
@@ -10,11 +8,9 @@
 // Third party
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
-#include <json/json.h>
 
 // STL
 #include <cassert>
-#include <fstream>
 #include <vector>
 
 static GLint convertFormat(onut::RenderTargetFormat format)
@@ -124,64 +120,6 @@ namespace onut
         return pRet;
     }
 
-    OTextureRef Texture::createFromFile(const std::string& filename, const OContentManagerRef& pContentManager, bool generateMipmaps)
-    {
-        bool premultiplied = true;
-                
-        std::string assetFilename = pContentManager->findResourceFile(filename);
-        if (assetFilename.empty())
-        {
-            assetFilename = filename;
-        }
-
-        // Load config json.font (optional)
-        if (onut::getExtension(assetFilename) == "TEXTURE")
-        {
-            std::ifstream fic(assetFilename);
-            Json::Value json;
-            fic >> json;
-            fic.close();
-
-            if (json["name"].isString())
-            {
-                assetFilename = pContentManager->findResourceFile(json["name"].asString());
-            }
-            else
-            {
-                // Assume fnt
-                assetFilename = pContentManager->findResourceFile(onut::getFilenameWithoutExtension(assetFilename) + ".fnt");
-            }
-            if (json["premultiplied"].isBool())
-            {
-                premultiplied = json["premultiplied"].asBool();
-            }
-        }
-
-        int w, h, n;
-        auto image = stbi_load(assetFilename.c_str(), &w, &h, &n, 4);
-        if (!image) return nullptr;
-        Point size{w, h};
-
-        // Pre multiplied
-        if (premultiplied)
-        {
-            uint8_t* pImageData = image;
-            auto len = size.x * size.y;
-            for (decltype(len) i = 0; i < len; ++i, pImageData += 4)
-            {
-                pImageData[0] = pImageData[0] * pImageData[3] / 255;
-                pImageData[1] = pImageData[1] * pImageData[3] / 255;
-                pImageData[2] = pImageData[2] * pImageData[3] / 255;
-            }
-        }
-
-        auto pRet = createFromData(image, size, generateMipmaps);
-        stbi_image_free(image);
-        pRet->setName(onut::getFilename(filename));
-        pRet->m_type = Type::Static;
-        return pRet;
-    }
-
     OTextureRef Texture::createFromFileData(const uint8_t* pData, uint32_t dataSize, bool generateMipmaps)
     {
         int w, h, n;
@@ -225,6 +163,7 @@ namespace onut
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, m_handle);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_size.x, m_size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pData);
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, m_size.x * m_size.y * 4);
         
         // Because opengl uses a global state and its dumb as fuck
         oRenderer->renderStates.textures[0].forceDirty();
@@ -457,6 +396,7 @@ namespace onut
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_2D, handle);
             glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_size.x, m_size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_dirtyData.data());
+            oRenderer->addStat(FrameStats::Counter::UploadedBytes, static_cast<uint32_t>(m_dirtyData.size()));
             m_dirtyData.clear();
 
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -0,0 +1,112 @@
+// Onut
+#include <onut/Renderer.h>
+#include <onut/Settings.h>
+
+// Private
+#include "TextureNull.h"
+
+// Third party
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+// STL
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+namespace onut
+{
+    OTextureRef Texture::createRenderTarget(const Point& size, bool willUseFX, RenderTargetFormat format)
+    {
+        auto pRet = std::shared_ptr<TextureNull>(new TextureNull());
+        pRet->m_size = size;
+        pRet->m_type = Type::RenderTarget;
+        pRet->m_format = format;
+        return pRet;
+    }
+
+    OTextureRef Texture::createScreenRenderTarget(bool willBeUsedInEffects, RenderTargetFormat format)
+    {
+        Point res = oRenderer->getTrueResolution();
+        if (oSettings->getIsRetroMode())
+        {
+            res = oSettings->getRetroResolution();
+        }
+
+        auto pRet = createRenderTarget(res, willBeUsedInEffects, format);
+        if (pRet)
+        {
+            pRet->m_isScreenRenderTarget = true;
+        }
+        pRet->m_type = Type::ScreenRenderTarget;
+        return pRet;
+    }
+
+    OTextureRef Texture::createDynamic(const Point& size)
+    {
+        auto pRet = std::shared_ptr<TextureNull>(new TextureNull());
+        pRet->m_type = Type::Dynamic;
+        pRet->m_size = size;
+        pRet->m_data.resize(size.x * size.y * 4, 0);
+        return pRet;
+    }
+
+    OTextureRef Texture::createFromFileData(const uint8_t* pData, uint32_t dataSize, bool generateMipmaps)
+    {
+        int w, h, n;
+        auto image = stbi_load_from_memory(pData, (int)dataSize, &w, &h, &n, 4);
+        if (!image) return nullptr;
+        Point size{static_cast<int>(w), static_cast<int>(h)};
+
+        // Pre multiplied
+        uint8_t* pImageData = image;
+        auto len = size.x * size.y;
+        for (int i = 0; i < len; ++i, pImageData += 4)
+        {
+            pImageData[0] = pImageData[0] * pImageData[3] / 255;
+            pImageData[1] = pImageData[1] * pImageData[3] / 255;
+            pImageData[2] = pImageData[2] * pImageData[3] / 255;
+        }
+
+        auto pRet = createFromData(image, size, generateMipmaps);
+        stbi_image_free(image);
+        return pRet;
+    }
+
+    OTextureRef Texture::createFromData(const uint8_t* pData, const Point& size, bool generateMipmaps)
+    {
+        auto pRet = std::shared_ptr<TextureNull>(new TextureNull());
+        pRet->m_type = Type::Static;
+        pRet->m_size = size;
+        pRet->m_data.assign(pData, pData + (size.x * size.y * 4));
+        return pRet;
+    }
+
+    OTextureRef Texture::createFromDataWithFormat(const uint8_t* pData, const Point& size, RenderTargetFormat format, bool generateMipmaps)
+    {
+        auto pRet = createFromData(pData, size, generateMipmaps);
+        pRet->m_format = format;
+        return pRet;
+    }
+
+    TextureNull::~TextureNull()
+    {
+    }
+
+    void TextureNull::setData(const uint8_t* pData)
+    {
+        assert(isDynamic());
+        memcpy(m_data.data(), pData, m_data.size());
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, static_cast<uint32_t>(m_data.size()));
+    }
+
+    void TextureNull::resizeTarget(const Point& size)
+    {
+        m_size = size;
+    }
+
+    void TextureNull::clearRenderTarget(const Color& color)
+    {
+        oRenderer->clear(color);
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef TEXTURENULL_H_INCLUDED
+#define TEXTURENULL_H_INCLUDED
+
+// Onut
+#include <onut/Texture.h>
+
+// STL
+#include <vector>
+
+// Forward
+#include <onut/ForwardDeclaration.h>
+OForwardDeclare(TextureNull);
+
+extern bool oGenerateMipmaps;
+
+namespace onut
+{
+    /**
+    Texture of the null renderer. Pixels are kept in memory, effects do nothing.
+    */
+    class TextureNull final : public Texture
+    {
+    public:
+        ~TextureNull();
+
+        void clearRenderTarget(const Color& color) override;
+
+        void blur(float amountX = 16.f, float amountY = -1.0f) override {}
+        void sepia(const Vector3& tone = Vector3(1.40f, 1.10f, 0.90f),
+                   float saturation = 0,
+                   float sepiaAmount = .75f) override {}
+        void crt() override {}
+        void cartoon(const Vector3& tone = Vector3(2, 5, 1)) override {}
+        void vignette(float amount = .5f) override {}
+
+        void setData(const uint8_t* pData) override;
+        void resizeTarget(const Point& size) override;
+
+        const std::vector<uint8_t>& getData() const { return m_data; }
+
+    protected:
+        TextureNull() {}
+
+    private:
+        friend Texture;
+
+        std::vector<uint8_t> m_data;
+    };
+}
+
+#endif
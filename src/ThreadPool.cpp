@@ -5,57 +5,203 @@ OThreadPoolRef oThreadPool;
 
 namespace onut
 {
+    // Which worker of which pool the current thread is. Other threads have no deque of their own.
+    static thread_local ThreadPool* t_pPool = nullptr;
+    static thread_local size_t t_workerIndex = 0;
+
+    // Jobs running on the current thread, nested when a job waits and helps with other jobs
+    static thread_local int t_runningCount = 0;
+
     OThreadPoolRef OThreadPool::create()
     {
         return std::shared_ptr<ThreadPool>(new ThreadPool());
     }
 
-    void ThreadPool::workerThread(ThreadPool::WorkerRef pWorker)
-    {
-        std::unique_lock<std::mutex> lock(pWorker->mutex);
-        while (pWorker->isRunning)
-        {
-            pWorker->waitForWork.wait(lock);
-            if (!pWorker->isRunning)
-            {
-                break;
-            }
-            pWorker->pDispatcher->processQueue();
-        }
-    }
-
     ThreadPool::ThreadPool()
-        : m_nextWorker(0)
     {
         auto threadCount = std::thread::hardware_concurrency();
+        if (threadCount == 0) threadCount = 1;
         for (decltype(threadCount) i = 0; i < threadCount; ++i)
         {
-            WorkerRef pWorker = OMake<Worker>();
-            pWorker->pDispatcher = OMake<ODispatcher>();
-            pWorker->thread = std::thread(workerThread, pWorker);
-            m_workers.push_back(pWorker);
+            m_workers.push_back(OMake<Worker>());
+        }
+
+        // Start threads only once all the deques exist, they steal from each other
+        for (size_t i = 0; i < m_workers.size(); ++i)
+        {
+            m_workers[i]->thread = std::thread(&ThreadPool::workerThread, this, i);
         }
     }
 
     ThreadPool::~ThreadPool()
     {
+        {
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_isRunning = false;
+            m_waitForWork.notify_all();
+        }
         for (auto& pWorker : m_workers)
         {
+            pWorker->thread.join();
+        }
+    }
+
+    void ThreadPool::workerThread(size_t index)
+    {
+        t_pPool = this;
+        t_workerIndex = index;
+
+        Task task;
+        while (m_isRunning)
+        {
+            if (pop(index, task) || steal(index, task))
             {
-                std::unique_lock<std::mutex> lock(pWorker->mutex);
-                pWorker->isRunning = false;
-                pWorker->waitForWork.notify_all();
+                run(task);
+                continue;
             }
-            pWorker->thread.join();
+
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            ++m_sleepingCount;
+            m_waitForWork.wait(lock, [this]
+            {
+                return !m_isRunning || m_queuedCount.load() > 0;
+            });
+            --m_sleepingCount;
+        }
+    }
+
+    ThreadPool::JobHandle ThreadPool::createJob(const JobHandle& pParent)
+    {
+        auto pJob = OMake<Job>();
+        if (pParent)
+        {
+            pParent->pending.fetch_add(1, std::memory_order_relaxed);
+            pJob->pParent = pParent;
+        }
+        return pJob;
+    }
+
+    void ThreadPool::finish(const JobHandle& pJob)
+    {
+        auto pCurrent = pJob.get();
+        while (pCurrent)
+        {
+            if (pCurrent->pending.fetch_sub(1, std::memory_order_acq_rel) != 1) break;
+            pCurrent = pCurrent->pParent.get();
+        }
+    }
+
+    ThreadPool::JobHandle ThreadPool::doChildWork(const JobHandle& pParent, const std::function<void()>& fn)
+    {
+        auto pJob = createJob(pParent);
+        push({fn, pJob});
+        return pJob;
+    }
+
+    void ThreadPool::push(Task&& task)
+    {
+        // Workers push on their own deque. Other threads spread jobs around,
+        // it doesn't matter much where since idle workers steal.
+        size_t index;
+        if (t_pPool == this)
+        {
+            index = t_workerIndex;
+        }
+        else
+        {
+            index = m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+        }
+
+        ++m_pendingCount;
+        {
+            auto& pWorker = m_workers[index];
+            std::lock_guard<std::mutex> lock(pWorker->mutex);
+            pWorker->tasks.push_back(std::move(task));
+        }
+        ++m_queuedCount;
+
+        if (m_sleepingCount.load() > 0)
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_waitForWork.notify_one();
+        }
+    }
+
+    bool ThreadPool::pop(size_t index, Task& task)
+    {
+        // Owner takes the newest job, its data is most likely still in cache
+        auto& pWorker = m_workers[index];
+        std::lock_guard<std::mutex> lock(pWorker->mutex);
+        if (pWorker->tasks.empty()) return false;
+        task = std::move(pWorker->tasks.back());
+        pWorker->tasks.pop_back();
+        --m_queuedCount;
+        return true;
+    }
+
+    bool ThreadPool::steal(size_t index, Task& task)
+    {
+        // Thieves take the oldest job, which tends to be the biggest chunk of work
+        auto count = m_workers.size();
+        for (size_t i = 1; i <= count; ++i)
+        {
+            auto& pVictim = m_workers[(index + i) % count];
+            std::unique_lock<std::mutex> lock(pVictim->mutex, std::try_to_lock);
+            if (!lock.owns_lock() || pVictim->tasks.empty()) continue;
+            task = std::move(pVictim->tasks.front());
+            pVictim->tasks.pop_front();
+            --m_queuedCount;
+            return true;
+        }
+        return false;
+    }
+
+    bool ThreadPool::runOne()
+    {
+        Task task;
+        if (t_pPool == this)
+        {
+            if (!pop(t_workerIndex, task) && !steal(t_workerIndex, task)) return false;
+        }
+        else
+        {
+            auto start = m_nextWorker.load(std::memory_order_relaxed) % m_workers.size();
+            if (!steal(start, task)) return false;
+        }
+        run(task);
+        return true;
+    }
+
+    void ThreadPool::run(Task& task)
+    {
+        ++t_runningCount;
+        task.fn();
+        --t_runningCount;
+        finish(task.pJob);
+        task = Task();
+        --m_pendingCount;
+    }
+
+    void ThreadPool::wait(const JobHandle& pJob)
+    {
+        if (!pJob) return;
+        while (!pJob->isDone())
+        {
+            if (!runOne()) std::this_thread::yield();
         }
     }
 
     void ThreadPool::wait()
     {
-        for (auto& pWorker : m_workers)
+        // Jobs on this thread's stack are pending until we return to them
+        while (m_pendingCount.load() > t_runningCount)
         {
-            std::unique_lock<std::mutex> lock(pWorker->mutex);
+            if (!runOne()) std::this_thread::yield();
         }
-        m_nextWorker = 0;
+    }
+
+    size_t ThreadPool::getWorkerCount() const
+    {
+        return m_workers.size();
     }
 }
@@ -19,7 +19,6 @@
 
 // STL
 #include <cassert>
-#include <fstream>
 
 #include <onut/Sound.h>
 
@@ -66,7 +65,11 @@ namespace onut
 
         Point size;
         int bpp;
-        auto data = stbi_load(pContentManager->findResourceFile(filename).c_str(), &size.x, &size.y, &bpp, 4);
+        uint8_t* data = nullptr;
+        onut::readFile(pContentManager->findResourceFile(filename), [&](const uint8_t* pFileData, size_t fileSize)
+        {
+            data = stbi_load_from_memory(pFileData, (int)fileSize, &size.x, &size.y, &bpp, 4);
+        });
         assert(data);
 
         // Pre multiplied
@@ -126,16 +129,16 @@ namespace onut
 
         if (onut::getExtension(filename) == "JSON")
         {
-            std::ifstream fic(filename);
             Json::Value json;
-            fic >> json;
-            fic.close();
+            Json::Reader reader;
+            reader.parse(onut::getFileString(filename), json);
             mapFilename = pContentManager->findResourceFile(json["name"].asString());
             if (json["padding"].isInt()) padding = json["padding"].asInt();
         }
 
         tinyxml2::XMLDocument doc;
-        doc.LoadFile(mapFilename.c_str());
+        auto mapContent = onut::getFileString(mapFilename);
+        doc.Parse(mapContent.c_str(), mapContent.size());
         if (doc.Error()) OLogE("Failed to open " + mapFilename);
         assert(!doc.Error());
         auto pXMLMap = doc.FirstChildElement("map");
@@ -163,7 +166,8 @@ namespace onut
             {
                 tinyxml2::XMLDocument docTXS;
                 auto fullpathTXS = pContentManager->findResourceFile(onut::getFilename(szSource));
-                docTXS.LoadFile(fullpathTXS.c_str());
+                auto contentTXS = onut::getFileString(fullpathTXS);
+                docTXS.Parse(contentTXS.c_str(), contentTXS.size());
                 if (docTXS.Error()) OLogE("Failed to load " + fullpathTXS);
                 assert(!docTXS.Error());
                 auto pTXSTileset = docTXS.FirstChildElement("tileset");
@@ -664,34 +668,21 @@ namespace onut
 
     void TiledMap::refreshChunk(Chunk* pChunk, TileLayerInternal* pLayer)
     {
+        // Chunks live in the renderer's vertex arena. Give the old range back first so it can be reused.
+        auto verticesSize = static_cast<uint32_t>(pChunk->tileCount * sizeof(OSpriteBatch::SVertexP2T2C4ub) * 4);
         if (pChunk->isSizeDirty)
         {
-            // Indices
-            pChunk->pIndexBuffer = OIndexBuffer::createDynamic(pChunk->tileCount * sizeof(uint16_t) * 6);
-            auto pIndices = (uint16_t*)pChunk->pIndexBuffer->map();
-            for (int j = 0; j < pChunk->tileCount; ++j)
-            {
-                pIndices[j * 6 + 0] = j * 4 + 0;
-                pIndices[j * 6 + 1] = j * 4 + 1;
-                pIndices[j * 6 + 2] = j * 4 + 2;
-                pIndices[j * 6 + 3] = j * 4 + 0;
-                pIndices[j * 6 + 4] = j * 4 + 2;
-                pIndices[j * 6 + 5] = j * 4 + 3;
-            }
-            pChunk->pIndexBuffer->unmap(pChunk->tileCount * sizeof(uint16_t) * 6);
+            pChunk->pVertices = nullptr;
+            pChunk->pVertices = oRenderer->getBufferArena(BufferArena::Type::Vertex)->allocate(verticesSize, sizeof(OSpriteBatch::SVertexP2T2C4ub));
         }
 
-        // Vertices
-        if (pChunk->isSizeDirty)
-        {
-            pChunk->pVertexBuffer = OVertexBuffer::createDynamic(pChunk->tileCount * sizeof(OSpriteBatch::SVertexP2T2C4) * 4);
-        }
-        auto pVertices = (OSpriteBatch::SVertexP2T2C4*)pChunk->pVertexBuffer->map();
+        static std::vector<OSpriteBatch::SVertexP2T2C4ub> vertices(CHUNK_SIZE * CHUNK_SIZE * 4);
+        auto pVertices = vertices.data();
         int j = 0;
         int layerW = pLayer->width;
         int layerH = pLayer->height;
         auto layerTiles = pLayer->tiles;
-        auto color = Color::White * pLayer->opacity;
+        auto color = (Color::White * pLayer->opacity).pack();
         for (int y = pChunk->y; y < pChunk->y + CHUNK_SIZE && y < layerH; ++y)
         {
             for (int x = pChunk->x; x < pChunk->x + CHUNK_SIZE && x < layerW; ++x)
@@ -728,7 +719,7 @@ namespace onut
                 ++j;
             }
         }
-        pChunk->pVertexBuffer->unmap(pChunk->tileCount * sizeof(OSpriteBatch::SVertexP2T2C4) * 4);
+        pChunk->pVertices->setData(pVertices, verticesSize);
 
         pChunk->isDirty = false;
         pChunk->isSizeDirty = false;
@@ -766,7 +757,10 @@ namespace onut
         {
             oRenderer->setupFor2D(getTransform());
         }
+        oRenderer->renderStates.vertexShader.push(oRenderer->get2DPackedColorVS());
         oRenderer->renderStates.sampleFiltering = m_filtering;
+        oRenderer->renderStates.indexBuffer = oRenderer->getQuadIndexBuffer();
+        auto previousStatsSource = oRenderer->setStatsSource(FrameStats::Source::TiledMap);
         for (int y = rect.top; y <= rect.bottom; ++y)
         {
             for (int x = rect.left; x <= rect.right; ++x)
@@ -775,11 +769,12 @@ namespace onut
                 if (!pChunk->tileCount) continue;
                 if (pChunk->isDirty) refreshChunk(pChunk, pLayer);
                 oRenderer->renderStates.textures[0] = pChunk->pTileset->pTexture;
-                oRenderer->renderStates.vertexBuffer = pChunk->pVertexBuffer;
-                oRenderer->renderStates.indexBuffer = pChunk->pIndexBuffer;
-                oRenderer->drawIndexed(pChunk->tileCount * 6);
+                oRenderer->renderStates.vertexBuffer = pChunk->pVertices->getVertexBuffer();
+                oRenderer->drawIndexed(pChunk->tileCount * 6, 0, pChunk->pVertices->getFirstElement());
             }
         }
+        oRenderer->setStatsSource(previousStatsSource);
+        oRenderer->renderStates.vertexShader.pop();
         if (isInBatch)
         {
             oSpriteBatch->begin(oSpriteBatch->getTransform());
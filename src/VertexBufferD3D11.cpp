@@ -74,7 +74,8 @@ namespace onut
 
             // Set up the description of the static vertex buffer.
             D3D11_BUFFER_DESC vertexBufferDesc;
-            vertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+            // Without initial data, the buffer is filled later with setSubData
+            vertexBufferDesc.Usage = pVertexData ? D3D11_USAGE_IMMUTABLE : D3D11_USAGE_DEFAULT;
             vertexBufferDesc.ByteWidth = static_cast<UINT>(size);
             vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
             vertexBufferDesc.CPUAccessFlags = 0;
@@ -87,9 +88,10 @@ namespace onut
             vertexData.SysMemPitch = 0;
             vertexData.SysMemSlicePitch = 0;
 
-            auto ret = pDevice->CreateBuffer(&vertexBufferDesc, &vertexData, &m_pBuffer);
+            auto ret = pDevice->CreateBuffer(&vertexBufferDesc, pVertexData ? &vertexData : nullptr, &m_pBuffer);
             if (ret != S_OK) OLogE("Failed to create vertex buffer");
             assert(ret == S_OK);
+            oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
 
             m_size = size;
         }
@@ -101,6 +103,18 @@ namespace onut
         }
     }
 
+    void VertexBufferD3D11::setSubData(const void* pVertexData, uint32_t offset, uint32_t size)
+    {
+        if (m_isDynamic) OLogE("Cannot update part of a dynamic vertex buffer");
+        assert(!m_isDynamic && offset + size <= m_size);
+        if (m_isDynamic) return;
+
+        auto pRendererD3D11 = std::dynamic_pointer_cast<ORendererD3D11>(oRenderer);
+        D3D11_BOX box = {offset, 0, 0, offset + size, 1, 1};
+        pRendererD3D11->getDeviceContext()->UpdateSubresource(m_pBuffer, 0, &box, pVertexData, 0, 0);
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
+    }
+
     void* VertexBufferD3D11::map()
     {
         if (!m_isDynamic) OLogE("Cannot map static vertex buffer");
@@ -122,6 +136,7 @@ namespace onut
         {
             auto pRendererD3D11 = std::dynamic_pointer_cast<ORendererD3D11>(oRenderer);
             pRendererD3D11->getDeviceContext()->Unmap(m_pBuffer, 0);
+            oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
         }
     }
 
@@ -23,6 +23,7 @@ namespace onut
         ID3D11Buffer* getBuffer() const;
 
         void setData(const void* pVertexData, uint32_t size) override;
+        void setSubData(const void* pVertexData, uint32_t offset, uint32_t size) override;
         void* map() override;
         void unmap(uint32_t size) override;
         uint32_t size() override;
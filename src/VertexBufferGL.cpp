@@ -2,11 +2,14 @@
 #include <onut/Log.h>
 
 // Private
+#include "DynamicBufferGL.h"
 #include "VertexBufferGL.h"
 #include "RendererGL.h"
 
 // STL
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 namespace onut
 {
@@ -21,14 +24,8 @@ namespace onut
     {
         auto pRet = OMake<VertexBufferGL>();
         
-        GLuint handle; 
-        glGenBuffers(1, &handle);
-        glBindBuffer(GL_ARRAY_BUFFER, handle);
-        glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
-        
-        pRet->m_handle = handle;
+        pRet->m_pDynamicBuffer = std::make_unique<DynamicBufferGL>(GL_ARRAY_BUFFER, size);
         pRet->m_size = size;
-        pRet->m_pData = new uint8_t[size];
         pRet->m_isDynamic = true;
         
         oRenderer->renderStates.vertexBuffer.forceDirty();
@@ -46,10 +43,6 @@ namespace onut
         {
             glDeleteBuffers(1, &m_handle);
         }
-        if (m_pData)
-        {
-            delete [] m_pData;
-        }
     }
 
     void VertexBufferGL::setData(const void* pVertexData, uint32_t size)
@@ -69,17 +62,32 @@ namespace onut
         }
         else
         {
-            glBindBuffer(GL_ARRAY_BUFFER, m_handle);
-            glBufferSubData(GL_ARRAY_BUFFER, 0, size, pVertexData);
+            size = std::min(size, m_size);
+            memcpy(m_pDynamicBuffer->map(), pVertexData, size);
+            m_pDynamicBuffer->unmap();
         }
         oRenderer->renderStates.vertexBuffer.forceDirty();
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
+    }
+
+    void VertexBufferGL::setSubData(const void* pVertexData, uint32_t offset, uint32_t size)
+    {
+        if (m_isDynamic) OLogE("Cannot update part of a dynamic vertex buffer");
+        assert(!m_isDynamic && offset + size <= m_size);
+        if (m_isDynamic) return;
+
+        glBindBuffer(GL_ARRAY_BUFFER, m_handle);
+        glBufferSubData(GL_ARRAY_BUFFER, offset, size, pVertexData);
+        oRenderer->renderStates.vertexBuffer.forceDirty();
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
     }
 
     void* VertexBufferGL::map()
     {
         if (!m_isDynamic) OLogE("Cannot map static vertex buffer");
         assert(m_isDynamic);
-        return m_pData;
+        oRenderer->renderStates.vertexBuffer.forceDirty();
+        return m_pDynamicBuffer->map();
     }
 
     void VertexBufferGL::unmap(uint32_t size)
@@ -88,9 +96,9 @@ namespace onut
         assert(m_isDynamic);
         if (m_isDynamic)
         {
-            glBindBuffer(GL_ARRAY_BUFFER, m_handle);
-            glBufferSubData(GL_ARRAY_BUFFER, 0, size, m_pData);
+            m_pDynamicBuffer->unmap();
             oRenderer->renderStates.vertexBuffer.forceDirty();
+            oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
         }
     }
 
@@ -101,6 +109,13 @@ namespace onut
 
     GLuint VertexBufferGL::getHandle() const
     {
+        if (m_pDynamicBuffer) return m_pDynamicBuffer->getHandle();
         return m_handle;
     }
+
+    uint32_t VertexBufferGL::getOffset() const
+    {
+        if (m_pDynamicBuffer) return m_pDynamicBuffer->getOffset();
+        return 0;
+    }
 }
@@ -0,0 +1,79 @@
+// Onut
+#include <onut/Log.h>
+#include <onut/Renderer.h>
+
+// Private
+#include "VertexBufferNull.h"
+
+// STL
+#include <cassert>
+#include <cstring>
+
+namespace onut
+{
+    OVertexBufferRef VertexBuffer::createStatic(const void* pVertexData, uint32_t size)
+    {
+        auto pRet = OMake<VertexBufferNull>();
+        pRet->setData(pVertexData, size);
+        return pRet;
+    }
+
+    OVertexBufferRef VertexBuffer::createDynamic(uint32_t size)
+    {
+        auto pRet = OMake<VertexBufferNull>();
+        pRet->m_data.resize(size);
+        pRet->m_isDynamic = true;
+        return pRet;
+    }
+
+    VertexBufferNull::VertexBufferNull()
+    {
+    }
+
+    VertexBufferNull::~VertexBufferNull()
+    {
+    }
+
+    void VertexBufferNull::setData(const void* pVertexData, uint32_t size)
+    {
+        if (!m_isDynamic)
+        {
+            m_data.resize(size);
+        }
+        assert(size <= m_data.size());
+        if (pVertexData) memcpy(m_data.data(), pVertexData, size);
+        oRenderer->renderStates.vertexBuffer.forceDirty();
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
+    }
+
+    void VertexBufferNull::setSubData(const void* pVertexData, uint32_t offset, uint32_t size)
+    {
+        if (m_isDynamic) OLogE("Cannot update part of a dynamic vertex buffer");
+        assert(!m_isDynamic && offset + size <= m_data.size());
+        if (m_isDynamic) return;
+
+        memcpy(m_data.data() + offset, pVertexData, size);
+        oRenderer->renderStates.vertexBuffer.forceDirty();
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
+    }
+
+    void* VertexBufferNull::map()
+    {
+        if (!m_isDynamic) OLogE("Cannot map static vertex buffer");
+        assert(m_isDynamic);
+        return m_data.data();
+    }
+
+    void VertexBufferNull::unmap(uint32_t size)
+    {
+        if (!m_isDynamic) OLogE("Cannot map static vertex buffer");
+        assert(m_isDynamic);
+        oRenderer->renderStates.vertexBuffer.forceDirty();
+        oRenderer->addStat(FrameStats::Counter::UploadedBytes, size);
+    }
+
+    uint32_t VertexBufferNull::size()
+    {
+        return static_cast<uint32_t>(m_data.size());
+    }
+}
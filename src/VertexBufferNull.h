@@ -0,0 +1,38 @@
+#ifndef VERTEXBUFFERNULL_H_INCLUDED
+#define VERTEXBUFFERNULL_H_INCLUDED
+
+// Onut
+#include <onut/VertexBuffer.h>
+
+// STL
+#include <vector>
+
+// Forward
+#include <onut/ForwardDeclaration.h>
+OForwardDeclare(VertexBufferNull)
+
+namespace onut
+{
+    class VertexBufferNull final : public VertexBuffer
+    {
+    public:
+        VertexBufferNull();
+        ~VertexBufferNull();
+
+        void setData(const void* pVertexData, uint32_t size) override;
+        void setSubData(const void* pVertexData, uint32_t offset, uint32_t size) override;
+        void* map() override;
+        void unmap(uint32_t size) override;
+        uint32_t size() override;
+
+        const uint8_t* getData() const { return m_data.data(); }
+
+    private:
+        friend class VertexBuffer;
+
+        bool m_isDynamic = false;
+        std::vector<uint8_t> m_data;
+    };
+};
+
+#endif
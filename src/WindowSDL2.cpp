@@ -27,6 +27,12 @@ namespace onut
 
     WindowSDL2::WindowSDL2()
     {
+#if defined(ONUT_USE_NULL_RENDERER)
+        // Headless, we only need events
+        SDL_Init(SDL_INIT_EVENTS);
+        return;
+#endif
+
         // Init SDL
         auto ret = SDL_Init(SDL_INIT_VIDEO);
         if (ret < 0)
@@ -107,7 +113,9 @@ namespace onut
 
     bool WindowSDL2::pollEvents()
     {
+#if !defined(ONUT_USE_NULL_RENDERER)
         if (!m_pWindow) return false;
+#endif
 
         oInput->setStateValue(OMouseZ, 0);
         oInput->setStateValue(OMouseW, 0);
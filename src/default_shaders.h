@@ -39,6 +39,88 @@ static const char* SHADER_SRC_2D_PS = ""
     "}\n"
 "";
 
+static const char* SHADER_SRC_2D_MULTI_TEXTURE_VS = ""
+    "input float2 inPosition;\n"
+    "input float2 inTexCoord;\n"
+    "input float4 inColor;\n"
+    "input float inTexIndex;\n"
+    "\n"
+    "output float2 outTexCoord;\n"
+    "output float4 outColor;\n"
+    "output float outTexIndex;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    oPosition = mul(float4(inPosition.xy, 0.0, 1.0), oViewProjection);\n"
+    "    outTexCoord = inTexCoord;\n"
+    "    outColor = inColor;\n"
+    "    outTexIndex = inTexIndex;\n"
+    "}\n"
+"";
+
+static const char* SHADER_SRC_2D_MULTI_TEXTURE_PS = ""
+    "Texture0 tex0;\n"
+    "Texture1 tex1;\n"
+    "Texture2 tex2;\n"
+    "Texture3 tex3;\n"
+    "Texture4 tex4;\n"
+    "Texture5 tex5;\n"
+    "Texture6 tex6;\n"
+    "Texture7 tex7;\n"
+    "\n"
+    "input float2 inTexCoord;\n"
+    "input float4 inColor;\n"
+    "input float inTexIndex;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    float4 diffuse = tex0(inTexCoord);\n"
+    "    if (inTexIndex > 6.5) diffuse = tex7(inTexCoord);\n"
+    "    else if (inTexIndex > 5.5) diffuse = tex6(inTexCoord);\n"
+    "    else if (inTexIndex > 4.5) diffuse = tex5(inTexCoord);\n"
+    "    else if (inTexIndex > 3.5) diffuse = tex4(inTexCoord);\n"
+    "    else if (inTexIndex > 2.5) diffuse = tex3(inTexCoord);\n"
+    "    else if (inTexIndex > 1.5) diffuse = tex2(inTexCoord);\n"
+    "    else if (inTexIndex > 0.5) diffuse = tex1(inTexCoord);\n"
+    "    oColor = diffuse * inColor;\n"
+    "}\n"
+"";
+
+static const char* SHADER_SRC_2D_PACKED_COLOR_VS = ""
+    "input float2 inPosition;\n"
+    "input float2 inTexCoord;\n"
+    "input ubyte4 inColor;\n"
+    "\n"
+    "output float2 outTexCoord;\n"
+    "output float4 outColor;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    oPosition = mul(float4(inPosition.xy, 0.0, 1.0), oViewProjection);\n"
+    "    outTexCoord = inTexCoord;\n"
+    "    outColor = inColor;\n"
+    "}\n"
+"";
+
+static const char* SHADER_SRC_2D_MULTI_TEXTURE_PACKED_COLOR_VS = ""
+    "input float2 inPosition;\n"
+    "input float2 inTexCoord;\n"
+    "input ubyte4 inColor;\n"
+    "input float inTexIndex;\n"
+    "\n"
+    "output float2 outTexCoord;\n"
+    "output float4 outColor;\n"
+    "output float outTexIndex;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    oPosition = mul(float4(inPosition.xy, 0.0, 1.0), oViewProjection);\n"
+    "    outTexCoord = inTexCoord;\n"
+    "    outColor = inColor;\n"
+    "    outTexIndex = inTexIndex;\n"
+    "}\n"
+"";
+
 static const char* SHADER_SRC_3D_PNCT_VS = ""
     "extern float3 sunDir;\n"
     "extern float3 sunColor;\n"
@@ -20,6 +20,7 @@
 #include <onut/SpriteBatch.h>
 #include <onut/Strings.h>
 #include <onut/Texture.h>
+#include <onut/TextureAtlas.h>
 #include <onut/ThreadPool.h>
 #include <onut/Timing.h>
 #include <onut/UIContext.h>
@@ -57,12 +58,9 @@ static OVertexBufferRef g_pImguiVB;
 
 Point *g_fakeHigherRes = nullptr;
 
-struct ImguiVertex
-{
-    Vector2 pos;
-    Vector2 tex;
-    Color color;
-};
+// Same layout as ImDrawVert, vertices are copied as is
+using ImguiVertex = OSpriteBatch::SVertexP2T2C4ub;
+static_assert(sizeof(ImguiVertex) == sizeof(ImDrawVert), "ImDrawVert layout changed");
 
 std::atomic<bool> g_bIsRunning;
             
@@ -211,6 +209,9 @@ namespace onut
 
         oSettings->shutdownUserSettings();
 
+        // Join the workers first, jobs still running may use the other services
+        oThreadPool = nullptr;
+
         g_pImguiVB = nullptr;
         g_pImguiIB = nullptr;
         g_pImguiFontTexture = nullptr;
@@ -232,13 +233,14 @@ namespace onut
         oRenderer = nullptr;
         oWindow = nullptr;
         oSettings = nullptr;
-        oThreadPool = nullptr;
         oTiming = nullptr;
     }
 
     void drawImgui()
     {
+        auto previousStatsSource = oRenderer->setStatsSource(FrameStats::Source::Imgui);
         oRenderer->setupFor2D();
+        oRenderer->renderStates.vertexShader = oRenderer->get2DPackedColorVS();
         oRenderer->renderStates.blendMode.push(OBlendAlpha);
         oRenderer->renderStates.scissorEnabled.push(true);
         oRenderer->renderStates.primitiveMode = OPrimitiveTriangleList;
@@ -268,22 +270,8 @@ namespace onut
             {
                 g_pImguiVB = OVertexBuffer::createDynamic(vertCount * sizeof(ImguiVertex));
             }
-            auto pVertexData = (ImguiVertex*)g_pImguiVB->map();
-            auto pImguiVertexData = pCmdList->VtxBuffer.Data;
-            for (int v = 0; v < vertCount; ++v)
-            {
-                pVertexData->pos.x = pImguiVertexData->pos.x;
-                pVertexData->pos.y = pImguiVertexData->pos.y;
-                pVertexData->tex.x = pImguiVertexData->uv.x;
-                pVertexData->tex.y = pImguiVertexData->uv.y;
-                pVertexData->color.r = (float)((pImguiVertexData->col) & 0xff) / 255.0f;
-                pVertexData->color.g = (float)((pImguiVertexData->col >> 8) & 0xff) / 255.0f;
-                pVertexData->color.b = (float)((pImguiVertexData->col >> 16) & 0xff) / 255.0f;
-                pVertexData->color.a = (float)((pImguiVertexData->col >> 24) & 0xff) / 255.0f;
-
-                ++pVertexData;
-                ++pImguiVertexData;
-            }
+            auto pVertexData = g_pImguiVB->map();
+            memcpy(pVertexData, pCmdList->VtxBuffer.Data, vertCount * sizeof(ImguiVertex));
             g_pImguiVB->unmap(vertCount * sizeof(ImguiVertex));
 
             oRenderer->renderStates.indexBuffer = g_pImguiIB;
@@ -313,6 +301,30 @@ namespace onut
 
         oRenderer->renderStates.scissorEnabled.pop();
         oRenderer->renderStates.blendMode.pop();
+        oRenderer->setStatsSource(previousStatsSource);
+    }
+
+    void drawRenderStats(const OFontRef& pFont, float y)
+    {
+        const auto& stats = oRenderer->getFrameStats();
+        auto lineHeight = pFont->measure("A").y;
+        std::string line;
+        for (int c = 0; c < (int)FrameStats::Counter::COUNT; ++c)
+        {
+            auto counter = (FrameStats::Counter)c;
+            line += std::string(FrameStats::getCounterName(counter)) + ": " + std::to_string(stats.get(counter)) + "  ";
+        }
+        pFont->draw(line, {0, y});
+        for (int s = 0; s < (int)FrameStats::Source::COUNT; ++s)
+        {
+            auto source = (FrameStats::Source)s;
+            if (!stats.get(source, FrameStats::Counter::DrawCalls)) continue;
+            y += lineHeight;
+            pFont->draw(std::string(FrameStats::getSourceName(source)) +
+                        ": draws " + std::to_string(stats.get(source, FrameStats::Counter::DrawCalls)) +
+                        ", vertices " + std::to_string(stats.get(source, FrameStats::Counter::Vertices)) +
+                        ", textures " + std::to_string(stats.get(source, FrameStats::Counter::TextureBinds)), {0, y});
+        }
     }
 
     // Start the engine
@@ -468,6 +480,10 @@ namespace onut
             {
                 oRenderer->clear(Color::Black);
             }
+            if (oContentManager->getTextureAtlas())
+            {
+                oContentManager->getTextureAtlas()->upload();
+            }
             oRenderer->renderStates.renderTargets[0] = g_pMainRenderTarget;
             oRenderer->beginFrame();
             onut::js::render();
@@ -553,6 +569,15 @@ namespace onut
                 }
             }
 
+            if (oSettings->getShowRenderStats())
+            {
+                auto pFont = OGetFont("font.fnt");
+                if (pFont)
+                {
+                    drawRenderStats(pFont, oSettings->getShowFPS() ? pFont->measure("A").y : 0.0f);
+                }
+            }
+
             oRenderer->endFrame();
 
             // This will ensure the resolution in update calls will match the main render target size